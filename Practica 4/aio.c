@@ -0,0 +1,589 @@
+/**
+ * @file aio.c
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Implementación de la entrada y salida asíncrona. El fichero se reparte en
+ * AIO_DEPTH bloques de AIO_CHUNK bytes que se usan en turno: en lectura cada
+ * bloque consumido se vuelve a pedir para la siguiente posición del fichero,
+ * y en escritura cada bloque lleno se envía y no se reutiliza hasta que su
+ * escritura ha terminado. Se usan directamente las llamadas al sistema de
+ * io_uring, sin liburing.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "aio.h"
+
+
+/* Estado de un bloque */
+typedef enum {
+    BLOQUE_LIBRE,
+    BLOQUE_PEDIDO,
+    BLOQUE_HECHO
+} EstadoBloque;
+
+
+/* Bloque del fichero: su posición, los bytes pedidos y el resultado de la
+   petición (bytes transferidos o -errno) */
+typedef struct {
+    char *buffer;
+    off_t offset;
+    size_t length;
+    ssize_t result;
+    EstadoBloque estado;
+} Bloque;
+
+
+/* Fichero asíncrono. current es el bloque que se está consumiendo o llenando,
+   used los bytes consumidos o llenados de él y next la siguiente posición del
+   fichero que se pide */
+typedef struct {
+    int fd;
+    Bool write;
+    pid_t owner;
+    Bloque blocks[AIO_DEPTH];
+    int current;
+    size_t used;
+    off_t next;
+    Bool eof;
+    /* Anillos de io_uring, o -1 en ring si se usan hilos */
+    int ring;
+    void *sq_map;
+    size_t sq_size;
+    void *cq_map;
+    size_t cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    /* Grupo de hilos y cola de bloques pedidos */
+    pthread_t threads[AIO_THREADS];
+    int n_threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t pedido;
+    pthread_cond_t hecho;
+    int cola[AIO_DEPTH];
+    int primero;
+    int n_cola;
+    Bool cerrando;
+} Aio;
+
+
+/**
+ * Prepara los anillos de io_uring del fichero.
+ *
+ * @param aio  Fichero asíncrono.
+ * @return  OK si el núcleo admite io_uring, ERROR en caso contrario.
+ */
+static Status abrir_anillo(Aio *aio) {
+    struct io_uring_params p;
+
+    memset(&p, 0, sizeof(p));
+    aio->ring = syscall(__NR_io_uring_setup, AIO_DEPTH, &p);
+    if (aio->ring == -1)
+        return ERROR;
+
+    /* Con IORING_FEAT_SINGLE_MMAP los dos anillos comparten proyección */
+    aio->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    aio->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        aio->sq_size = aio->cq_size = (aio->sq_size > aio->cq_size) ? aio->sq_size : aio->cq_size;
+    aio->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    aio->sq_map = mmap(NULL, aio->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, \
+                       aio->ring, IORING_OFF_SQ_RING);
+    if (aio->sq_map == MAP_FAILED) {
+        close(aio->ring);
+        aio->ring = -1;
+        return ERROR;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        aio->cq_map = aio->sq_map;
+    else {
+        aio->cq_map = mmap(NULL, aio->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, \
+                           aio->ring, IORING_OFF_CQ_RING);
+    }
+    aio->sqes = mmap(NULL, aio->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, \
+                     aio->ring, IORING_OFF_SQES);
+    if (aio->cq_map == MAP_FAILED || aio->sqes == MAP_FAILED) {
+        if (aio->sqes != MAP_FAILED)
+            munmap(aio->sqes, aio->sqes_size);
+        if (aio->cq_map != MAP_FAILED && aio->cq_map != aio->sq_map)
+            munmap(aio->cq_map, aio->cq_size);
+        munmap(aio->sq_map, aio->sq_size);
+        close(aio->ring);
+        aio->ring = -1;
+        return ERROR;
+    }
+
+    aio->sq_tail = (unsigned *)((char *)aio->sq_map + p.sq_off.tail);
+    aio->sq_mask = (unsigned *)((char *)aio->sq_map + p.sq_off.ring_mask);
+    aio->sq_array = (unsigned *)((char *)aio->sq_map + p.sq_off.array);
+    aio->cq_head = (unsigned *)((char *)aio->cq_map + p.cq_off.head);
+    aio->cq_tail = (unsigned *)((char *)aio->cq_map + p.cq_off.tail);
+    aio->cq_mask = (unsigned *)((char *)aio->cq_map + p.cq_off.ring_mask);
+    aio->cqes = (struct io_uring_cqe *)((char *)aio->cq_map + p.cq_off.cqes);
+
+    return OK;
+}
+
+
+/**
+ * Libera los anillos de io_uring del fichero.
+ *
+ * @param aio  Fichero asíncrono.
+ */
+static void cerrar_anillo(Aio *aio) {
+    munmap(aio->sqes, aio->sqes_size);
+    if (aio->cq_map != aio->sq_map)
+        munmap(aio->cq_map, aio->cq_size);
+    munmap(aio->sq_map, aio->sq_size);
+    close(aio->ring);
+    aio->ring = -1;
+}
+
+
+/**
+ * Rutina de los hilos: resuelven los bloques pedidos en orden de llegada
+ * hasta que se cierra el fichero y la cola queda vacía.
+ *
+ * @param arg  Fichero asíncrono (Aio).
+ * @return  NULL.
+ */
+static void *resolver_bloques(void *arg) {
+    Aio *aio = (Aio *)arg;
+    Bloque *bloque;
+    ssize_t n;
+    int b;
+
+    pthread_mutex_lock(&aio->mutex);
+    while (TRUE) {
+        while (aio->n_cola == 0 && !aio->cerrando)
+            pthread_cond_wait(&aio->pedido, &aio->mutex);
+        if (aio->n_cola == 0)
+            break;
+        b = aio->cola[aio->primero];
+        aio->primero = (aio->primero + 1) % AIO_DEPTH;
+        aio->n_cola--;
+        bloque = &aio->blocks[b];
+        pthread_mutex_unlock(&aio->mutex);
+
+        if (aio->write)
+            n = pwrite(aio->fd, bloque->buffer, bloque->length, bloque->offset);
+        else
+            n = pread(aio->fd, bloque->buffer, bloque->length, bloque->offset);
+
+        pthread_mutex_lock(&aio->mutex);
+        bloque->result = (n == -1) ? -errno : n;
+        bloque->estado = BLOQUE_HECHO;
+        pthread_cond_broadcast(&aio->hecho);
+    }
+    pthread_mutex_unlock(&aio->mutex);
+
+    return NULL;
+}
+
+
+/**
+ * Arranca el grupo de hilos del fichero. Los hilos bloquean todas las señales
+ * para que siempre las atienda el hilo principal.
+ *
+ * @param aio  Fichero asíncrono.
+ * @return  OK si ha arrancado al menos un hilo, ERROR en caso contrario.
+ */
+static Status abrir_hilos(Aio *aio) {
+    sigset_t todas, anterior;
+
+    pthread_mutex_init(&aio->mutex, NULL);
+    pthread_cond_init(&aio->pedido, NULL);
+    pthread_cond_init(&aio->hecho, NULL);
+
+    sigfillset(&todas);
+    pthread_sigmask(SIG_SETMASK, &todas, &anterior);
+    for (aio->n_threads = 0; aio->n_threads < AIO_THREADS; aio->n_threads++) {
+        if (pthread_create(&aio->threads[aio->n_threads], NULL, resolver_bloques, aio) != 0)
+            break;
+    }
+    pthread_sigmask(SIG_SETMASK, &anterior, NULL);
+
+    return (aio->n_threads > 0) ? OK : ERROR;
+}
+
+
+/**
+ * Detiene el grupo de hilos del fichero, una vez resueltos todos sus bloques.
+ *
+ * @param aio  Fichero asíncrono.
+ */
+static void cerrar_hilos(Aio *aio) {
+    int t;
+
+    pthread_mutex_lock(&aio->mutex);
+    aio->cerrando = TRUE;
+    pthread_cond_broadcast(&aio->pedido);
+    pthread_mutex_unlock(&aio->mutex);
+    for (t = 0; t < aio->n_threads; t++)
+        pthread_join(aio->threads[t], NULL);
+
+    pthread_mutex_destroy(&aio->mutex);
+    pthread_cond_destroy(&aio->pedido);
+    pthread_cond_destroy(&aio->hecho);
+}
+
+
+/**
+ * Pide la lectura o escritura de un bloque.
+ *
+ * @param aio     Fichero asíncrono.
+ * @param b       Bloque.
+ * @param offset  Posición del fichero.
+ * @param length  Bytes que se leen o escriben.
+ */
+static void pedir(Aio *aio, int b, off_t offset, size_t length) {
+    Bloque *bloque = &aio->blocks[b];
+    struct io_uring_sqe *sqe;
+    unsigned tail, index;
+
+    bloque->offset = offset;
+    bloque->length = length;
+    bloque->estado = BLOQUE_PEDIDO;
+
+    if (aio->ring == -1) {
+        pthread_mutex_lock(&aio->mutex);
+        aio->cola[(aio->primero + aio->n_cola) % AIO_DEPTH] = b;
+        aio->n_cola++;
+        pthread_cond_signal(&aio->pedido);
+        pthread_mutex_unlock(&aio->mutex);
+        return;
+    }
+
+    /* Nunca hay más de AIO_DEPTH bloques pedidos, así que siempre hay sitio
+       en el anillo de envío */
+    tail = *aio->sq_tail;
+    index = tail & *aio->sq_mask;
+    sqe = &aio->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = aio->write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = aio->fd;
+    sqe->addr = (unsigned long)bloque->buffer;
+    sqe->len = length;
+    sqe->off = offset;
+    sqe->user_data = b;
+    aio->sq_array[index] = index;
+    __atomic_store_n(aio->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    while (syscall(__NR_io_uring_enter, aio->ring, 1, 0, 0, NULL, 0) == -1) {
+        if (errno != EINTR && errno != EAGAIN) {
+            bloque->result = -errno;
+            bloque->estado = BLOQUE_HECHO;
+            return;
+        }
+    }
+}
+
+
+/**
+ * Espera a que termine la petición de un bloque, recogiendo de paso las de
+ * los demás que ya hayan terminado.
+ *
+ * @param aio  Fichero asíncrono.
+ * @param b    Bloque.
+ */
+static void esperar(Aio *aio, int b) {
+    Bloque *bloque = &aio->blocks[b];
+    struct io_uring_cqe *cqe;
+    unsigned head, tail;
+
+    if (aio->ring == -1) {
+        pthread_mutex_lock(&aio->mutex);
+        while (bloque->estado == BLOQUE_PEDIDO)
+            pthread_cond_wait(&aio->hecho, &aio->mutex);
+        pthread_mutex_unlock(&aio->mutex);
+        return;
+    }
+
+    while (bloque->estado == BLOQUE_PEDIDO) {
+        head = *aio->cq_head;
+        tail = __atomic_load_n(aio->cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (syscall(__NR_io_uring_enter, aio->ring, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) == -1 && \
+                errno != EINTR) {
+                bloque->result = -errno;
+                bloque->estado = BLOQUE_HECHO;
+            }
+            continue;
+        }
+        for (; head != tail; head++) {
+            cqe = &aio->cqes[head & *aio->cq_mask];
+            aio->blocks[cqe->user_data].result = cqe->res;
+            aio->blocks[cqe->user_data].estado = BLOQUE_HECHO;
+        }
+        __atomic_store_n(aio->cq_head, head, __ATOMIC_RELEASE);
+    }
+}
+
+
+/**
+ * Lee del fichero, para stdio. Al terminar de consumir un bloque se vuelve a
+ * pedir para la siguiente posición y se pasa al siguiente; si la lectura fue
+ * corta, se pide el resto en el mismo bloque para no desordenar el fichero.
+ *
+ * @param cookie  Fichero asíncrono (Aio).
+ * @param buf     Destino.
+ * @param size    Bytes pedidos.
+ * @return  Bytes leídos, 0 al final del fichero o -1 si hay un error.
+ */
+static ssize_t leer(void *cookie, char *buf, size_t size) {
+    Aio *aio = (Aio *)cookie;
+    Bloque *bloque;
+    size_t n;
+
+    while (!aio->eof) {
+        bloque = &aio->blocks[aio->current];
+        esperar(aio, aio->current);
+        if (bloque->result < 0) {
+            errno = -bloque->result;
+            return -1;
+        }
+        if (bloque->result == 0) {
+            aio->eof = TRUE;
+            break;
+        }
+        if (aio->used < (size_t)bloque->result) {
+            n = bloque->result - aio->used;
+            n = (n < size) ? n : size;
+            memcpy(buf, bloque->buffer + aio->used, n);
+            aio->used += n;
+            return n;
+        }
+
+        aio->used = 0;
+        if ((size_t)bloque->result < bloque->length) {
+            pedir(aio, aio->current, bloque->offset + bloque->result, bloque->length - bloque->result);
+            continue;
+        }
+        pedir(aio, aio->current, aio->next, AIO_CHUNK);
+        aio->next += AIO_CHUNK;
+        aio->current = (aio->current + 1) % AIO_DEPTH;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Espera a que termine la escritura de un bloque y escribe lo que haya
+ * quedado pendiente si fue corta.
+ *
+ * @param aio  Fichero asíncrono.
+ * @param b    Bloque.
+ * @return  OK si el bloque está escrito, ERROR en caso contrario.
+ */
+static Status completar_escritura(Aio *aio, int b) {
+    Bloque *bloque = &aio->blocks[b];
+    size_t escritos;
+    ssize_t n;
+
+    if (bloque->estado == BLOQUE_LIBRE)
+        return OK;
+
+    esperar(aio, b);
+    bloque->estado = BLOQUE_LIBRE;
+    if (bloque->result < 0) {
+        errno = -bloque->result;
+        return ERROR;
+    }
+    for (escritos = bloque->result; escritos < bloque->length; escritos += n) {
+        n = pwrite(aio->fd, bloque->buffer + escritos, bloque->length - escritos, bloque->offset + escritos);
+        if (n <= 0)
+            return ERROR;
+    }
+
+    return OK;
+}
+
+
+/**
+ * Escribe en el fichero, para stdio. Los datos se copian en el bloque actual
+ * y cada bloque lleno se envía; antes de volver a llenar un bloque se espera
+ * a que haya terminado su escritura anterior.
+ *
+ * @param cookie  Fichero asíncrono (Aio).
+ * @param buf     Datos.
+ * @param size    Número de bytes.
+ * @return  size si se han aceptado los datos, -1 si hay un error.
+ */
+static ssize_t escribir(void *cookie, const char *buf, size_t size) {
+    Aio *aio = (Aio *)cookie;
+    size_t total, n;
+
+    for (total = 0; total < size; total += n) {
+        if (aio->used == 0 && completar_escritura(aio, aio->current) == ERROR)
+            return -1;
+
+        n = AIO_CHUNK - aio->used;
+        n = (n < size - total) ? n : size - total;
+        memcpy(aio->blocks[aio->current].buffer + aio->used, buf + total, n);
+        aio->used += n;
+
+        if (aio->used == AIO_CHUNK) {
+            pedir(aio, aio->current, aio->next, AIO_CHUNK);
+            aio->next += AIO_CHUNK;
+            aio->current = (aio->current + 1) % AIO_DEPTH;
+            aio->used = 0;
+        }
+    }
+
+    return size;
+}
+
+
+/**
+ * Libera la memoria de un fichero asíncrono.
+ *
+ * @param aio  Fichero asíncrono.
+ */
+static void liberar(Aio *aio) {
+    int b;
+
+    for (b = 0; b < AIO_DEPTH; b++)
+        free(aio->blocks[b].buffer);
+    free(aio);
+}
+
+
+/**
+ * Cierra el fichero, para stdio: envía el último bloque a medio llenar y
+ * espera a todas las peticiones antes de liberar los bloques. En un proceso
+ * hijo las peticiones son del padre y solo se libera la memoria.
+ *
+ * @param cookie  Fichero asíncrono (Aio).
+ * @return  0 si todo se ha leído o escrito correctamente, -1 en caso
+ *          contrario.
+ */
+static int cerrar(void *cookie) {
+    Aio *aio = (Aio *)cookie;
+    Status estado = OK;
+    int b;
+
+    if (aio->owner != getpid()) {
+        if (aio->ring != -1)
+            cerrar_anillo(aio);
+        close(aio->fd);
+        liberar(aio);
+        return 0;
+    }
+
+    if (aio->write && aio->used > 0) {
+        pedir(aio, aio->current, aio->next, aio->used);
+        aio->next += aio->used;
+    }
+    for (b = 0; b < AIO_DEPTH; b++) {
+        if (aio->write) {
+            if (completar_escritura(aio, b) == ERROR)
+                estado = ERROR;
+        }
+        else if (aio->blocks[b].estado == BLOQUE_PEDIDO)
+            esperar(aio, b);
+    }
+
+    if (aio->ring != -1)
+        cerrar_anillo(aio);
+    else
+        cerrar_hilos(aio);
+    if (close(aio->fd) == -1)
+        estado = ERROR;
+    liberar(aio);
+
+    return (estado == OK) ? 0 : -1;
+}
+
+
+FILE *aio_fopen(char *file_name, char *mode) {
+    cookie_io_functions_t funciones = {leer, escribir, NULL, cerrar};
+    struct stat st;
+    FILE *file;
+    Aio *aio;
+    int b, fd;
+
+    if ((!(file_name)) || (!(mode)) || (strcmp(mode, "r") && strcmp(mode, "w"))) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (!strcmp(mode, "w"))
+        fd = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    else
+        fd = open(file_name, O_RDONLY);
+    if (fd == -1)
+        return NULL;
+
+    /* Las posiciones solo tienen sentido en los ficheros regulares */
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return fdopen(fd, mode);
+
+    if ((aio = calloc(1, sizeof(Aio))) == NULL) {
+        close(fd);
+        return NULL;
+    }
+    aio->fd = fd;
+    aio->write = (mode[0] == 'w');
+    aio->owner = getpid();
+    for (b = 0; b < AIO_DEPTH; b++) {
+        if ((aio->blocks[b].buffer = malloc(AIO_CHUNK)) == NULL) {
+            close(fd);
+            liberar(aio);
+            return NULL;
+        }
+    }
+
+    if (abrir_anillo(aio) == ERROR && abrir_hilos(aio) == ERROR) {
+        close(fd);
+        liberar(aio);
+        errno = EAGAIN;
+        return NULL;
+    }
+
+    if ((file = fopencookie(aio, mode, funciones)) == NULL) {
+        if (aio->ring != -1)
+            cerrar_anillo(aio);
+        else
+            cerrar_hilos(aio);
+        close(fd);
+        liberar(aio);
+        return NULL;
+    }
+
+    /* Se piden de entrada los primeros bloques del fichero */
+    if (aio->write)
+        setvbuf(file, NULL, _IONBF, 0);
+    else {
+        for (b = 0; b < AIO_DEPTH; b++) {
+            pedir(aio, b, aio->next, AIO_CHUNK);
+            aio->next += AIO_CHUNK;
+        }
+    }
+
+    return file;
+}
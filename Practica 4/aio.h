@@ -0,0 +1,44 @@
+/**
+ * @file aio.h
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Entrada y salida asíncrona por bloques grandes. Un fichero abierto para
+ * lectura mantiene pedidos los AIO_DEPTH bloques siguientes mientras se
+ * procesa el actual, y uno abierto para escritura envía cada bloque en cuanto
+ * se llena y sigue llenando el siguiente. Las peticiones se hacen con
+ * io_uring y, si el núcleo no lo permite, con un grupo de hilos. El fichero
+ * se maneja como un FILE normal de stdio.
+ */
+
+#ifndef _AIO_H
+#define _AIO_H
+
+#include <stdio.h>
+#include "global.h"
+
+/* Constantes */
+#define AIO_DEPTH 4
+#define AIO_CHUNK (1 << 16)
+#define AIO_THREADS 2
+
+
+/**
+ * Abre un fichero con entrada y salida asíncrona. Los ficheros que no son
+ * regulares (tuberías, terminales) no admiten lecturas adelantadas y se
+ * abren con stdio sin más.
+ *
+ * La escritura no pasa por el buffer de stdio: los procesos creados con el
+ * fichero abierto no escriben nada en él al terminar. Al cerrarlo en otro
+ * proceso que el que lo abrió solo se libera su memoria.
+ *
+ * @param file_name  Fichero.
+ * @param mode       "r" para leer o "w" para escribir.
+ * @return  El fichero abierto, o NULL con errno indicando el error.
+ */
+FILE *aio_fopen(char *file_name, char *mode);
+
+#endif
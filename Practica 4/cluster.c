@@ -0,0 +1,431 @@
+/**
+ * @file cluster.c
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Implementación del protocolo entre el coordinador y los nodos y de la
+ * ordenación local de un nodo. Cada petición se ordena por niveles: en cada
+ * nivel se crean hasta n_processes hijos que resuelven las partes del nivel
+ * sobre una estructura Sort compartida, y el nodo espera a todos antes de
+ * pasar al siguiente.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "cluster.h"
+#include "sort.h"
+#include "utils.h"
+
+
+/* Indica al nodo que deje de aceptar peticiones */
+static volatile sig_atomic_t parar = 0;
+
+
+/**
+ * Manejador de SIGINT y SIGTERM del nodo.
+ *
+ * @param sig  Señal recibida.
+ */
+static void manejador_parar(int sig) {
+    parar = 1;
+}
+
+
+/**
+ * Escribe un buffer completo en un socket.
+ *
+ * @param fd      Socket conectado.
+ * @param buffer  Datos.
+ * @param size    Número de bytes.
+ * @return  OK si se ha escrito entero, ERROR en caso contrario.
+ */
+static Status escribir_todo(int fd, const void *buffer, size_t size) {
+    const char *p = buffer;
+    ssize_t n;
+
+    while (size > 0) {
+        n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            return ERROR;
+        }
+        p += n;
+        size -= n;
+    }
+
+    return OK;
+}
+
+
+/**
+ * Lee un buffer completo de un socket.
+ *
+ * @param fd      Socket conectado.
+ * @param buffer  Destino.
+ * @param size    Número de bytes.
+ * @return  OK si se ha leído entero, ERROR si hay un error o se cierra la
+ *          conexión antes.
+ */
+static Status leer_todo(int fd, void *buffer, size_t size) {
+    char *p = buffer;
+    ssize_t n;
+
+    while (size > 0) {
+        n = recv(fd, p, size, 0);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return ERROR;
+        p += n;
+        size -= n;
+    }
+
+    return OK;
+}
+
+
+Status cluster_send_ints(int fd, int *data, int n_elements) {
+    uint32_t bloque[CLUSTER_BLOCK];
+    int i, k, n;
+
+    for (i = 0; i < n_elements; i += n) {
+        n = MIN(CLUSTER_BLOCK, n_elements - i);
+        for (k = 0; k < n; k++)
+            bloque[k] = htonl((uint32_t)data[i + k]);
+        if (escribir_todo(fd, bloque, n * sizeof(uint32_t)) == ERROR)
+            return ERROR;
+    }
+
+    return OK;
+}
+
+
+Status cluster_recv_ints(int fd, int *data, int n_elements) {
+    int i;
+
+    if (leer_todo(fd, data, n_elements * sizeof(int)) == ERROR)
+        return ERROR;
+    for (i = 0; i < n_elements; i++)
+        data[i] = (int)ntohl((uint32_t)data[i]);
+
+    return OK;
+}
+
+
+Status cluster_send_request(int fd, ClusterRequest *request) {
+    uint32_t cabecera[4];
+
+    cabecera[0] = htonl(request->magic);
+    cabecera[1] = htonl((uint32_t)request->n_elements);
+    cabecera[2] = htonl((uint32_t)request->n_levels);
+    cabecera[3] = htonl((uint32_t)request->delay);
+    request->output[CLUSTER_MAX_PATH - 1] = '\0';
+
+    if (escribir_todo(fd, cabecera, sizeof(cabecera)) == ERROR || \
+        escribir_todo(fd, request->output, CLUSTER_MAX_PATH) == ERROR)
+        return ERROR;
+
+    return OK;
+}
+
+
+/**
+ * Recibe una petición del coordinador.
+ *
+ * @param fd       Socket conectado.
+ * @param request  Donde se guarda, en el orden de bytes de la máquina.
+ * @return  OK si se ha recibido una petición válida, ERROR en caso contrario.
+ */
+static Status recibir_peticion(int fd, ClusterRequest *request) {
+    uint32_t cabecera[4];
+
+    if (leer_todo(fd, cabecera, sizeof(cabecera)) == ERROR || \
+        leer_todo(fd, request->output, CLUSTER_MAX_PATH) == ERROR)
+        return ERROR;
+
+    request->magic = ntohl(cabecera[0]);
+    request->n_elements = (int32_t)ntohl(cabecera[1]);
+    request->n_levels = (int32_t)ntohl(cabecera[2]);
+    request->delay = (int32_t)ntohl(cabecera[3]);
+    request->output[CLUSTER_MAX_PATH - 1] = '\0';
+
+    return (request->magic == CLUSTER_MAGIC) ? OK : ERROR;
+}
+
+
+/**
+ * Envía la respuesta de un nodo al coordinador.
+ *
+ * @param fd     Socket conectado.
+ * @param reply  Respuesta, en el orden de bytes de la máquina.
+ * @return  OK si se ha enviado, ERROR en caso contrario.
+ */
+static Status enviar_respuesta(int fd, ClusterReply *reply) {
+    uint32_t campos[4];
+
+    campos[0] = htonl((uint32_t)reply->status);
+    campos[1] = htonl((uint32_t)reply->n_elements);
+    campos[2] = htonl((uint32_t)((uint64_t)reply->elapsed_ns >> 32));
+    campos[3] = htonl((uint32_t)reply->elapsed_ns);
+
+    return escribir_todo(fd, campos, sizeof(campos));
+}
+
+
+Status cluster_recv_reply(int fd, ClusterReply *reply) {
+    uint32_t campos[4];
+
+    if (leer_todo(fd, campos, sizeof(campos)) == ERROR)
+        return ERROR;
+
+    reply->status = (int32_t)ntohl(campos[0]);
+    reply->n_elements = (int32_t)ntohl(campos[1]);
+    reply->elapsed_ns = (int64_t)(((uint64_t)ntohl(campos[2]) << 32) | ntohl(campos[3]));
+
+    return OK;
+}
+
+
+Status cluster_sort(int *data, int n_elements, int n_levels, int n_processes, int delay) {
+    Status estado = OK;
+    Sort *sort;
+    int level, part, n_parts, n_hijos, p, status;
+    pid_t pid;
+
+    if ((!(data)) || (n_elements < 0) || (n_elements > MAX_DATA)) {
+        return ERROR;
+    }
+
+    sort = mmap(NULL, sizeof(Sort), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (sort == MAP_FAILED) {
+        perror("mmap");
+        return ERROR;
+    }
+    if (init_sort_data(data, n_elements, sort, n_levels, n_processes, delay) == ERROR) {
+        munmap(sort, sizeof(Sort));
+        return ERROR;
+    }
+
+    /* Las partes de un nivel son independientes; cada hijo resuelve una de
+       cada n_hijos */
+    for (level = 0; level < sort->n_levels && estado == OK; level++) {
+        n_parts = get_number_parts(level, sort->n_levels);
+        n_hijos = MIN(sort->n_processes, n_parts);
+        for (p = 0; p < n_hijos; p++) {
+            if ((pid = fork()) == -1) {
+                perror("fork");
+                estado = ERROR;
+                n_hijos = p;
+                break;
+            }
+            if (!pid) {
+                for (part = p; part < n_parts; part += n_hijos) {
+                    if (solve_task(sort, level, part) == ERROR)
+                        _exit(EXIT_FAILURE);
+                }
+                _exit(EXIT_SUCCESS);
+            }
+        }
+
+        while (n_hijos > 0) {
+            if (wait(&status) == -1) {
+                if (errno == EINTR)
+                    continue;
+                perror("wait");
+                estado = ERROR;
+                break;
+            }
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+                estado = ERROR;
+            n_hijos--;
+        }
+    }
+
+    memcpy(data, sort->data, n_elements * sizeof(int));
+    munmap(sort, sizeof(Sort));
+
+    return estado;
+}
+
+
+/**
+ * Atiende una petición: recibe los elementos, los ordena y devuelve el
+ * resultado por la conexión o lo escribe en el fichero pedido.
+ *
+ * @param fd           Socket conectado con el coordinador.
+ * @param n_processes  Número de procesos con los que se ordena.
+ */
+static void atender(int fd, int n_processes) {
+    struct timespec ini, fin;
+    ClusterRequest request;
+    ClusterReply reply;
+    int *data;
+
+    if (recibir_peticion(fd, &request) == ERROR) {
+        fprintf(stderr, "sort_node: bad request\n");
+        return;
+    }
+
+    memset(&reply, 0, sizeof(reply));
+    if ((request.n_elements < 0) || (request.n_elements > MAX_DATA) || \
+        ((data = malloc(MAX(1, request.n_elements) * sizeof(int))) == NULL)) {
+        fprintf(stderr, "sort_node: can not sort %d elements\n", request.n_elements);
+        reply.status = ERROR;
+        enviar_respuesta(fd, &reply);
+        return;
+    }
+    if (cluster_recv_ints(fd, data, request.n_elements) == ERROR) {
+        fprintf(stderr, "sort_node: connection lost\n");
+        free(data);
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ini);
+    reply.status = cluster_sort(data, request.n_elements, request.n_levels, n_processes, request.delay);
+    if (reply.status == OK && request.output[0] != '\0')
+        reply.status = write_vector(request.output, data, request.n_elements);
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+    reply.n_elements = request.n_elements;
+    reply.elapsed_ns = (fin.tv_sec - ini.tv_sec) * 1000000000L + (fin.tv_nsec - ini.tv_nsec);
+
+    printf("Sorted %d elements in %.3f ms%s%s\n", reply.n_elements, reply.elapsed_ns / 1e6, \
+           (request.output[0] != '\0') ? " into " : "", request.output);
+    fflush(stdout);
+
+    if (enviar_respuesta(fd, &reply) == ERROR || \
+        (reply.status == OK && request.output[0] == '\0' && \
+         cluster_send_ints(fd, data, reply.n_elements) == ERROR))
+        fprintf(stderr, "sort_node: connection lost\n");
+
+    free(data);
+}
+
+
+Status cluster_serve(int listener, int n_processes) {
+    struct sigaction act;
+    int fd;
+
+    /* Sin SA_RESTART, accept termina con EINTR al llegar la señal */
+    sigemptyset(&(act.sa_mask));
+    act.sa_flags = 0;
+    act.sa_handler = manejador_parar;
+    if (sigaction(SIGINT, &act, NULL) < 0 || sigaction(SIGTERM, &act, NULL) < 0) {
+        perror("sigaction");
+        return ERROR;
+    }
+
+    while (!parar) {
+        fd = accept(listener, NULL, NULL);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror("accept");
+            return ERROR;
+        }
+        /* Un coordinador que deja de enviar no bloquea al nodo */
+        if (cluster_timeout(fd, CLUSTER_TIMEOUT) == OK)
+            atender(fd, n_processes);
+        close(fd);
+    }
+
+    return OK;
+}
+
+
+int cluster_listen(char *host, int port) {
+    struct addrinfo hints, *direcciones, *d;
+    char puerto[16];
+    int fd = -1, uno = 1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    snprintf(puerto, sizeof(puerto), "%d", port);
+    if (getaddrinfo(host, puerto, &hints, &direcciones) != 0) {
+        fprintf(stderr, "%s: unknown address\n", host ? host : "*");
+        return -1;
+    }
+
+    for (d = direcciones; d != NULL; d = d->ai_next) {
+        if ((fd = socket(d->ai_family, d->ai_socktype, d->ai_protocol)) == -1)
+            continue;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &uno, sizeof(uno));
+        if (bind(fd, d->ai_addr, d->ai_addrlen) == 0 && listen(fd, CLUSTER_MAX_NODES) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(direcciones);
+
+    return fd;
+}
+
+
+Status cluster_timeout(int fd, int seconds) {
+    struct timeval limite;
+
+    limite.tv_sec = seconds;
+    limite.tv_usec = 0;
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite)) == -1 || \
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &limite, sizeof(limite)) == -1) {
+        perror("setsockopt");
+        return ERROR;
+    }
+
+    return OK;
+}
+
+
+int cluster_connect(char *address, int timeout) {
+    struct addrinfo hints, *direcciones, *d;
+    char host[CLUSTER_MAX_PATH];
+    char *puerto;
+    int fd = -1;
+
+    /* El puerto va tras el último ':' */
+    snprintf(host, sizeof(host), "%s", address);
+    if ((puerto = strrchr(host, ':')) == NULL) {
+        fprintf(stderr, "%s: expected HOST:PORT\n", address);
+        return -1;
+    }
+    *puerto++ = '\0';
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, puerto, &hints, &direcciones) != 0) {
+        fprintf(stderr, "%s: unknown address\n", address);
+        return -1;
+    }
+
+    for (d = direcciones; d != NULL; d = d->ai_next) {
+        if ((fd = socket(d->ai_family, d->ai_socktype, d->ai_protocol)) == -1)
+            continue;
+        if (cluster_timeout(fd, timeout) == OK && connect(fd, d->ai_addr, d->ai_addrlen) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(direcciones);
+
+    return fd;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file cluster.h
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Ordenación repartida entre varias máquinas por TCP. El coordinador
+ * (sort_cluster) toma una muestra de la entrada, elige las claves que la
+ * dividen en tantos rangos como nodos hay y envía a cada nodo (sort_node) los
+ * elementos de su rango. Cada nodo los ordena con el árbol de tareas de sort
+ * repartido entre varios procesos y devuelve el resultado por la misma
+ * conexión o lo escribe en un fichero de un almacenamiento compartido; como
+ * los rangos están en orden, el resultado es la concatenación de los de los
+ * nodos. Las esperas en los sockets tienen un límite, para que un nodo caído
+ * no bloquee al coordinador ni un coordinador caído a un nodo.
+ * Todos los enteros viajan en el orden de bytes de la red.
+ */
+
+#ifndef _CLUSTER_H
+#define _CLUSTER_H
+
+#include <stdint.h>
+#include "global.h"
+
+/* Constantes */
+#define CLUSTER_MAGIC 0x534f5254
+#define CLUSTER_PORT 5500
+#define CLUSTER_MAX_NODES 64
+#define CLUSTER_OVERSAMPLE 64
+#define CLUSTER_MAX_PATH 256
+#define CLUSTER_BLOCK 4096
+#define CLUSTER_TIMEOUT 60
+
+
+/* Petición del coordinador a un nodo. Con output vacío el resultado se
+   devuelve por la conexión; si no, el nodo lo escribe en ese fichero */
+typedef struct {
+    uint32_t magic;
+    int32_t n_elements;
+    int32_t n_levels;
+    int32_t delay;
+    char output[CLUSTER_MAX_PATH];
+} ClusterRequest;
+
+
+/* Respuesta de un nodo, seguida de los n_elements elementos ordenados si se
+   devuelven por la conexión */
+typedef struct {
+    int32_t status;
+    int32_t n_elements;
+    int64_t elapsed_ns;
+} ClusterReply;
+
+
+/**
+ * Envía enteros por un socket, por bloques de CLUSTER_BLOCK.
+ *
+ * @param fd          Socket conectado.
+ * @param data        Enteros.
+ * @param n_elements  Número de enteros.
+ * @return  OK si se han enviado todos, ERROR en caso contrario.
+ */
+Status cluster_send_ints(int fd, int *data, int n_elements);
+
+
+/**
+ * Recibe enteros de un socket.
+ *
+ * @param fd          Socket conectado.
+ * @param data        Destino.
+ * @param n_elements  Número de enteros.
+ * @return  OK si se han recibido todos, ERROR en caso contrario.
+ */
+Status cluster_recv_ints(int fd, int *data, int n_elements);
+
+
+/**
+ * Envía una petición a un nodo.
+ *
+ * @param fd       Socket conectado.
+ * @param request  Petición, en el orden de bytes de la máquina.
+ * @return  OK si se ha enviado, ERROR en caso contrario.
+ */
+Status cluster_send_request(int fd, ClusterRequest *request);
+
+
+/**
+ * Recibe la respuesta de un nodo.
+ *
+ * @param fd     Socket conectado.
+ * @param reply  Donde se guarda, en el orden de bytes de la máquina.
+ * @return  OK si se ha recibido, ERROR en caso contrario.
+ */
+Status cluster_recv_reply(int fd, ClusterReply *reply);
+
+
+/**
+ * Ordena un vector con el árbol de tareas de sort: los datos se copian en una
+ * estructura Sort compartida y en cada nivel varios procesos resuelven sus
+ * partes a la vez.
+ *
+ * @param data         Vector, que se ordena en el sitio (como mucho MAX_DATA
+ *                     elementos).
+ * @param n_elements   Número de elementos.
+ * @param n_levels     Número de niveles.
+ * @param n_processes  Número de procesos.
+ * @param delay        Retardo en ns.
+ * @return  OK si se ha ordenado, ERROR en caso contrario.
+ */
+Status cluster_sort(int *data, int n_elements, int n_levels, int n_processes, int delay);
+
+
+/**
+ * Atiende peticiones de ordenación, una tras otra, hasta que llega SIGINT o
+ * SIGTERM.
+ *
+ * @param listener     Socket de escucha.
+ * @param n_processes  Número de procesos con los que se ordena cada petición.
+ * @return  OK si ha terminado por una señal, ERROR en caso contrario.
+ */
+Status cluster_serve(int listener, int n_processes);
+
+
+/**
+ * Crea un socket de escucha TCP.
+ *
+ * @param host  Dirección local, NULL para todas.
+ * @param port  Puerto, 0 para que lo elija el sistema.
+ * @return  El socket, o -1 si hay un error.
+ */
+int cluster_listen(char *host, int port);
+
+
+/**
+ * Limita lo que esperan la conexión, los envíos y las recepciones de un
+ * socket; al agotarse fallan con EAGAIN o EWOULDBLOCK (EINPROGRESS en la
+ * conexión).
+ *
+ * @param fd       Socket.
+ * @param seconds  Segundos, 0 para esperar sin límite.
+ * @return  OK si se ha establecido, ERROR en caso contrario.
+ */
+Status cluster_timeout(int fd, int seconds);
+
+
+/**
+ * Se conecta a un nodo.
+ *
+ * @param address  Dirección del nodo, HOST:PUERTO.
+ * @param timeout  Segundos que se espera a cada operación del socket, 0 para
+ *                 esperar sin límite.
+ * @return  El socket conectado, o -1 si hay un error.
+ */
+int cluster_connect(char *address, int timeout);
+
+#endif
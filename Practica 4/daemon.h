@@ -0,0 +1,71 @@
+/**
+ * @file daemon.h
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Definiciones compartidas entre el servicio de ordenación persistente
+ * (sort_daemon) y sus clientes (sort_client): nombres de los recursos IPC y
+ * formato de las peticiones y respuestas que viajan por las colas de mensajes.
+ */
+
+#ifndef _DAEMON_H
+#define _DAEMON_H
+
+#include <sys/types.h>
+#include "global.h"
+
+/* Constantes */
+#define DAEMON_MQ_NAME "/mq_sort_daemon"
+#define DAEMON_TASK_MQ_NAME "/mq_sort_daemon_tasks"
+#define DAEMON_DONE_MQ_NAME "/mq_sort_daemon_done"
+#define DAEMON_SHM_NAME "/shm_sort_daemon"
+#define DAEMON_SEM_NAME "sem_sort_daemon"
+#define REPLY_MQ_FORMAT "/mq_sort_reply_%ld"
+
+#define SHM_PREFIX "shm:"
+#define MAX_PATH 256
+#define MAX_MQ_NAME 64
+#define MAX_JOBS 8
+#define MAX_PRIORITY 10
+
+
+/* Origen de los datos de una petición */
+typedef enum {
+    SOURCE_FILE,
+    SOURCE_SHM
+} Source;
+
+
+/* Petición de ordenación enviada por un cliente al servicio */
+typedef struct {
+    pid_t client;
+    Source source;
+    char input[MAX_PATH];
+    char output[MAX_PATH];
+    char reply[MAX_MQ_NAME];
+    int n_levels;
+    int delay;
+    int priority;
+} Request;
+
+
+/* Respuesta enviada por el servicio a la cola del cliente al terminar */
+typedef struct {
+    Status status;
+    int n_elements;
+    int n_levels;
+    long elapsed_ns;
+} Reply;
+
+
+/* Formato de los segmentos de memoria compartida usados como entrada: el
+   número de elementos seguido de los datos, que se ordenan en el sitio */
+typedef struct {
+    int n_elements;
+    int data[];
+} ShmInput;
+
+#endif
@@ -0,0 +1,491 @@
+/**
+ * @file gen_data.c
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Generador de ficheros de datos para las pruebas de carga. Escribe el número
+ * de elementos seguido de las claves, en texto (el formato de Data/) o en
+ * binario (enteros nativos), con la distribución indicada. El vector se
+ * divide en bloques de tamaño fijo, cada uno con su propio generador derivado
+ * de la semilla, por lo que el resultado no depende del número de hilos.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "global.h"
+#include "utils.h"
+
+
+/* Constantes */
+#define BLOCK (1 << 20)
+#define MAX_TEXT 12
+#define MAX_THREADS 64
+
+
+/* Distribuciones de las claves */
+typedef enum {
+    UNIFORM,
+    GAUSSIAN,
+    ZIPF,
+    SORTED,
+    REVERSE,
+    SAWTOOTH,
+    DUPLICATES,
+    ADVERSARIAL
+} Distribution;
+
+
+/* Parámetros de la generación, compartidos por todos los hilos */
+typedef struct {
+    Distribution distribution;
+    long n_elements;
+    long max;
+    uint64_t seed;
+    double param;
+    Bool binary;
+    int *adversarial;
+    double zipf_x1, zipf_n, zipf_s;
+} Config;
+
+
+/* Trabajo de un hilo en una ronda: un bloque y el buffer donde se escribe */
+typedef struct {
+    Config *config;
+    long block;
+    int *keys;
+    char *text;
+    size_t size;
+} Work;
+
+
+/* Nombres de las distribuciones, en el orden de Distribution */
+static char *nombres[] = {
+    "uniform", "gaussian", "zipf", "sorted", "reverse", "sawtooth", \
+    "duplicates", "adversarial", NULL
+};
+
+
+/**
+ * Generador splitmix64. Cada llamada avanza el estado y devuelve 64 bits.
+ *
+ * @param state Estado del generador.
+ * @return  El siguiente número de la secuencia.
+ */
+static uint64_t siguiente(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+
+/**
+ * Devuelve un número real uniforme en (0, 1).
+ *
+ * @param state Estado del generador.
+ * @return  El número generado.
+ */
+static double uniforme(uint64_t *state) {
+    return ((siguiente(state) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+
+/* Funciones auxiliares del muestreo de Zipf por rechazo-inversión
+   (Hörmann y Derflinger), estables cuando el exponente es cercano a 1 */
+static double zipf_helper1(double x) {
+    return (fabs(x) > 1e-8) ? log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+}
+
+static double zipf_helper2(double x) {
+    return (fabs(x) > 1e-8) ? expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+}
+
+static double zipf_h(double s, double x) {
+    return exp(-s * log(x));
+}
+
+static double zipf_integral(double s, double x) {
+    double logx = log(x);
+    return zipf_helper2((1 - s) * logx) * logx;
+}
+
+static double zipf_inverse(double s, double x) {
+    double t = x * (1 - s);
+    if (t < -1)
+        t = -1;
+    return exp(zipf_helper1(t) * x);
+}
+
+
+/**
+ * Prepara las constantes del muestreo de Zipf sobre config->max claves.
+ *
+ * @param config    Parámetros de la generación.
+ */
+static void zipf_init(Config *config) {
+    double s = config->param;
+
+    config->zipf_x1 = zipf_integral(s, 1.5) - 1;
+    config->zipf_n = zipf_integral(s, config->max + 0.5);
+    config->zipf_s = 2 - zipf_inverse(s, zipf_integral(s, 2.5) - zipf_h(s, 2));
+}
+
+
+/**
+ * Devuelve una clave de la distribución de Zipf, siendo la 0 la más frecuente.
+ *
+ * @param config    Parámetros de la generación.
+ * @param state     Estado del generador.
+ * @return  La clave generada.
+ */
+static long zipf(Config *config, uint64_t *state) {
+    double s = config->param;
+    double u, x;
+    long k;
+
+    while (1) {
+        u = config->zipf_n + uniforme(state) * (config->zipf_x1 - config->zipf_n);
+        x = zipf_inverse(s, u);
+        k = (long)(x + 0.5);
+        if (k < 1)
+            k = 1;
+        else if (k > config->max)
+            k = config->max;
+        if (k - x <= config->zipf_s || u >= zipf_integral(s, k + 0.5) - zipf_h(s, k))
+            return k - 1;
+    }
+}
+
+
+/**
+ * Construye una permutación en la que el pivote central de quickselect y de
+ * quicksort (como en select_k) es siempre el menor del rango, de forma que
+ * cada partición solo descarta un elemento. Se obtiene simulando las
+ * particiones sobre las posiciones, en tiempo lineal.
+ *
+ * @param n_elements    Número de elementos.
+ * @return  La permutación, NULL en caso de error.
+ */
+static int *adversario(long n_elements) {
+    int *quien, *valor;
+    long t, m;
+    int id;
+
+    quien = malloc(n_elements * sizeof(int));
+    valor = malloc(n_elements * sizeof(int));
+    if (quien == NULL || valor == NULL) {
+        free(quien);
+        free(valor);
+        return NULL;
+    }
+
+    for (t = 0; t < n_elements; t++)
+        quien[t] = t;
+
+    /* En el paso t el rango es [t, n - 1]: el pivote pasa al final, el
+       primero ocupa su lugar y el pivote queda en la posición t */
+    for (t = 0; t < n_elements; t++) {
+        m = t + (n_elements - 1 - t) / 2;
+        id = quien[m];
+        valor[id] = t;
+        quien[m] = quien[n_elements - 1];
+        quien[n_elements - 1] = quien[t];
+        quien[t] = id;
+    }
+
+    free(quien);
+    return valor;
+}
+
+
+/**
+ * Genera la clave de la posición index.
+ *
+ * @param config    Parámetros de la generación.
+ * @param state     Estado del generador del bloque.
+ * @param index     Posición de la clave.
+ * @return  La clave generada.
+ */
+static long clave(Config *config, uint64_t *state, long index) {
+    long n = config->n_elements, max = config->max;
+    long periodo, distintos;
+    double g;
+
+    switch (config->distribution) {
+        case GAUSSIAN:
+            /* Box-Muller, centrada en max / 2 con desviación max / 8 */
+            g = sqrt(-2 * log(uniforme(state))) * cos(2 * M_PI * uniforme(state));
+            g = max / 2.0 + g * max / 8.0;
+            return (g < 0) ? 0 : (g >= max) ? max - 1 : (long)g;
+        case ZIPF:
+            return zipf(config, state);
+        case SORTED:
+            return (long)((double)index * max / n);
+        case REVERSE:
+            return (long)((double)(n - 1 - index) * max / n);
+        case SAWTOOTH:
+            periodo = MAX(1, (n + (long)config->param - 1) / (long)config->param);
+            return (long)((double)(index % periodo) * max / periodo);
+        case DUPLICATES:
+            distintos = (long)config->param;
+            return (long)((double)(siguiente(state) % distintos) * max / distintos);
+        case ADVERSARIAL:
+            return config->adversarial[index];
+        case UNIFORM:
+        default:
+            return siguiente(state) % max;
+    }
+}
+
+
+/**
+ * Rutina de los hilos: genera un bloque y, en modo texto, le da formato.
+ *
+ * @param arg   Trabajo del hilo.
+ * @return  NULL.
+ */
+static void *generar(void *arg) {
+    Work *work = arg;
+    Config *config = work->config;
+    long ini = work->block * BLOCK;
+    long n = MIN(BLOCK, config->n_elements - ini);
+    uint64_t state = config->seed ^ (0x9e3779b97f4a7c15ULL * (work->block + 1));
+    char *p = work->text;
+    long k;
+
+    siguiente(&state);
+    for (k = 0; k < n; k++)
+        work->keys[k] = clave(config, &state, ini + k);
+
+    if (config->binary) {
+        work->size = n * sizeof(int);
+        return NULL;
+    }
+
+    /* Las claves no son negativas, así que se evita el coste de sprintf */
+    for (k = 0; k < n; k++) {
+        unsigned int v = work->keys[k];
+        char digits[MAX_TEXT];
+        int d = 0;
+        do {
+            digits[d++] = '0' + v % 10;
+            v /= 10;
+        } while (v);
+        while (d)
+            *p++ = digits[--d];
+        *p++ = '\n';
+    }
+    work->size = p - work->text;
+
+    return NULL;
+}
+
+
+/**
+ * Imprime la forma de uso del programa.
+ *
+ * @param prog  Nombre del programa.
+ */
+static void uso(char *prog) {
+    fprintf(stderr, "Usage: %s [OPTIONS] <N_ELEMENTS> <OUTPUT>\n", prog);
+    fprintf(stderr, "    <N_ELEMENTS> :          Number of keys\n");
+    fprintf(stderr, "    <OUTPUT> :              Output file, - for the standard output\n");
+    fprintf(stderr, "    -d, --distribution D :  uniform (default), gaussian, zipf, sorted, reverse,\n");
+    fprintf(stderr, "                            sawtooth, duplicates or adversarial\n");
+    fprintf(stderr, "    -p, --param P :         Zipf exponent (1.0), sawtooth teeth (16) or\n");
+    fprintf(stderr, "                            number of distinct duplicated keys (16)\n");
+    fprintf(stderr, "    -m, --max M :           Keys in [0, M), N_ELEMENTS by default\n");
+    fprintf(stderr, "    -s, --seed S :          Seed, 1 by default\n");
+    fprintf(stderr, "    -b, --binary :          Native integers instead of text\n");
+    fprintf(stderr, "    -t, --threads T :       Number of threads, one per CPU by default\n");
+}
+
+
+/**
+ * Función main. Será la rutina princpal que se ejecutará al comienzo del
+ * programa.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param argc  Número de argumentos de entrada del programa.
+ * @param argv  Puntero a los string de los correspondientes argumentos de
+ *              entrada.
+ * @return  EXIT_SUCCESS si el fichero se ha generado correctamente.
+ *          EXIT_FAILURE en caso contrario.
+ */
+int main(int argc, char **argv) {
+
+    /* Variables locales */
+    struct option opciones[] = {
+        {"distribution", required_argument, NULL, 'd'},
+        {"param", required_argument, NULL, 'p'},
+        {"max", required_argument, NULL, 'm'},
+        {"seed", required_argument, NULL, 's'},
+        {"binary", no_argument, NULL, 'b'},
+        {"threads", required_argument, NULL, 't'},
+        {NULL, 0, NULL, 0}
+    };
+    Config config;
+    Work works[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    long n_blocks, block;
+    int n_threads, opt, k, n;
+    int cabecera;
+    Status status = OK;
+    FILE *output;
+
+    memset(&config, 0, sizeof(config));
+    config.distribution = UNIFORM;
+    config.seed = 1;
+    config.param = -1;
+    n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* Comprobamos los arguentos de entrada */
+    while ((opt = getopt_long(argc, argv, "d:p:m:s:bt:", opciones, NULL)) != -1) {
+        switch (opt) {
+            case 'd':
+                for (k = 0; nombres[k] != NULL && strcmp(nombres[k], optarg); k++);
+                if (nombres[k] == NULL) {
+                    uso(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                config.distribution = k;
+                break;
+            case 'p':
+                config.param = atof(optarg);
+                break;
+            case 'm':
+                config.max = atol(optarg);
+                break;
+            case 's':
+                config.seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'b':
+                config.binary = TRUE;
+                break;
+            case 't':
+                n_threads = atoi(optarg);
+                break;
+            default:
+                uso(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (argc - optind != 2) {
+        uso(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    config.n_elements = atol(argv[optind]);
+    if (config.n_elements <= 0 || config.n_elements > INT32_MAX) {
+        fprintf(stderr, "N_ELEMENTS must be between 1 and %d\n", INT32_MAX);
+        exit(EXIT_FAILURE);
+    }
+    if (config.max <= 0)
+        config.max = config.n_elements;
+    if (config.max > (long)INT32_MAX + 1)
+        config.max = (long)INT32_MAX + 1;
+    /* Los dientes y las claves distintas se cuentan, y con menos de uno la
+       clave se calcula módulo 0 */
+    if ((config.distribution == SAWTOOTH || config.distribution == DUPLICATES) && \
+        config.param != -1 && (config.param < 1 || config.param != floor(config.param))) {
+        fprintf(stderr, "--param must be a whole number of at least 1 for %s\n", nombres[config.distribution]);
+        uso(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (config.param <= 0)
+        config.param = (config.distribution == ZIPF) ? 1.0 : 16;
+    n_threads = MAX(1, MIN(n_threads, MAX_THREADS));
+
+    if (config.distribution == ZIPF)
+        zipf_init(&config);
+
+    /* La permutación adversaria depende de todas las posiciones, por lo que
+       se construye entera antes de escribirla */
+    if (config.distribution == ADVERSARIAL) {
+        config.adversarial = adversario(config.n_elements);
+        if (config.adversarial == NULL) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!strcmp(argv[optind + 1], "-"))
+        output = stdout;
+    else if ((output = fopen(argv[optind + 1], config.binary ? "wb" : "w")) == NULL) {
+        perror("fopen");
+        free(config.adversarial);
+        exit(EXIT_FAILURE);
+    }
+
+    for (k = 0; k < n_threads; k++) {
+        works[k].config = &config;
+        works[k].keys = malloc(BLOCK * sizeof(int));
+        works[k].text = config.binary ? NULL : malloc(BLOCK * MAX_TEXT);
+        if (works[k].keys == NULL || (!config.binary && works[k].text == NULL)) {
+            perror("malloc");
+            n_threads = k + 1;
+            status = ERROR;
+            break;
+        }
+    }
+
+    /* Cabecera */
+    cabecera = config.n_elements;
+    if (status == OK) {
+        if (config.binary)
+            fwrite(&cabecera, sizeof(int), 1, output);
+        else
+            fprintf(output, "%d\n", cabecera);
+    }
+
+    /* En cada ronda cada hilo genera un bloque y después se escriben en orden */
+    n_blocks = (config.n_elements + BLOCK - 1) / BLOCK;
+    for (block = 0; status == OK && block < n_blocks; block += n) {
+        n = MIN(n_threads, n_blocks - block);
+        for (k = 0; k < n; k++) {
+            works[k].block = block + k;
+            if (pthread_create(&threads[k], NULL, generar, &works[k]) != 0) {
+                generar(&works[k]);
+                threads[k] = 0;
+            }
+        }
+        for (k = 0; k < n; k++) {
+            if (threads[k] != 0)
+                pthread_join(threads[k], NULL);
+        }
+        for (k = 0; k < n && status == OK; k++) {
+            if (fwrite(config.binary ? (char *)works[k].keys : works[k].text, 1, \
+                       works[k].size, output) != works[k].size) {
+                perror("fwrite");
+                status = ERROR;
+            }
+        }
+    }
+
+    for (k = 0; k < n_threads; k++) {
+        free(works[k].keys);
+        free(works[k].text);
+    }
+    free(config.adversarial);
+    if (fclose(output) == EOF) {
+        perror("fclose");
+        status = ERROR;
+    }
+
+    exit(status == OK ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -20,39 +20,200 @@
  * están realizando (si están realizando alguna), y el incio y final de la parte.
  * Al terminar el padre enviará la señal SIGTERM a todos sus hijos liberando los
  * recursos y saliendo de forma ordenada.
+ * Con la opción --stream el padre no espera a leer todo el fichero: cada bloque
+ * del nivel 0 se envía en cuanto se ha leído, y las mezclas se envían en cuanto
+ * sus dos mitades están terminadas, solapando la lectura con la ordenación. El
+ * fichero "-" es la entrada estándar.
+ * Con las opciones --top-k y --select no se ordena todo el vector: cada bloque
+ * se queda solo con sus K menores elementos mediante quickselect y cada mezcla
+ * con los K menores de sus dos mitades, de modo que al final se obtienen los K
+ * menores elementos ordenados o el elemento N-ésimo.
+ * Con la opción --natural se detectan antes las secuencias ya ordenadas de los
+ * datos (invirtiendo las descendentes), las partes del nivel 0 se ajustan a
+ * ellas y las mezclas saltan los tramos que ya están en su sitio, de modo que
+ * los datos casi ordenados se resuelven en un tiempo casi lineal.
+ * Si un trabajador muere mientras resuelve una tarea, el padre lo detecta con
+ * SIGCHLD, restaura los datos de la tarea desde la copia que el trabajador
+ * guardó antes de empezar, la vuelve a enviar y crea un trabajador nuevo. Lo
+ * mismo ocurre con el ilustrador. Los trabajadores reciben y reclaman cada
+ * mensaje con un cerrojo robusto cogido, por lo que el padre también
+ * recupera el cerrojo y los mensajes que un trabajador se lleve al morir.
+ * Con la opción --checkpoint la estructura compartida se proyecta desde un
+ * fichero en disco en lugar de memoria compartida. Cada vez que se completa un
+ * nivel se vuelca con msync y se anotan sus tareas en un diario, de modo que si
+ * el programa se interrumpe puede continuarse con --resume desde el último
+ * estado consistente en lugar de volver a empezar. Las copias de las tareas
+ * llegan al disco antes de marcarse como guardadas, y la marca antes de que
+ * se modifiquen los datos.
+ * Con la opción --publish la estructura compartida se crea dentro de un
+ * segmento con nombre precedido de una cabecera (número de elementos, tipo,
+ * suma de comprobación y si está ordenado). Al terminar el segmento se recorta
+ * para que solo contenga el resultado, pasa a ser de solo lectura y otros
+ * procesos pueden usar el resultado sin copiarlo; se elimina cuando se libera
+ * su última referencia (ver sort_result).
+ * Con la opción --group se obtiene un histograma ordenado: cada bloque agrupa
+ * sus elementos iguales en pares (elemento, apariciones) y cada mezcla suma
+ * los grupos iguales de sus dos mitades, por lo que los datos se reducen al
+ * subir por el árbol.
+ * Con la opción --fuse solo mezclan uno de cada L niveles, y cada mezcla junta
+ * de una vez las 2^L partes de debajo con un árbol de perdedores, adelantando
+ * la lectura de cada parte. Los datos se leen y escriben una vez por cada L
+ * niveles en lugar de una vez por nivel; las tareas de los niveles intermedios
+ * no hacen nada.
+ * Con N_PROCESSES igual a 0 se crean tantos trabajadores como procesadores
+ * haya disponibles según la máscara de afinidad y la cuota del cgroup. En
+ * cualquier caso solo están activos tantos trabajadores como tareas enviadas
+ * pendientes; los demás esperan en un futex hasta que un nivel vuelve a tener
+ * más tareas.
+ * Durante la ordenación se mantienen unos contadores de progreso en el
+ * segmento METRICS_SHM_NAME seguido del pid (tareas por nivel, bytes
+ * mezclados, tareas en la cola y tiempo ocupado de cada trabajador), que
+ * muestra el programa sort_stat. Con la opción --metrics se escriben además en
+ * un fichero en el formato de texto de Prometheus.
+ * Las tareas se envían con la prioridad de la cola de mensajes que les
+ * corresponde por el camino crítico: su coste estimado más el de las mezclas
+ * que dependen de ellas. Así las partes más grandes y las mezclas de las que
+ * depende la mezcla final se resuelven primero.
+ * Las mezclas dejan los elementos iguales en el orden en el que estaban. Con
+ * la opción --argsort cada elemento lleva además consigo su posición en el
+ * fichero, y el resultado es la permutación que ordena los datos, con la que
+ * pueden reordenarse otras columnas sin mover registros completos en cada
+ * mezcla.
+ * Con la opción --text el fichero se ordena por líneas. Se proyecta en memoria
+ * y varios hilos obtienen el comienzo de cada línea y un prefijo entero de su
+ * clave (los cuatro primeros bytes, o la parte entera con --numeric), que se
+ * ordenan con su número de línea igual que con --argsort. Al terminar, el
+ * padre desempata por la clave completa las líneas con el mismo prefijo y las
+ * escribe desde la proyección, sin haberlas copiado en ninguna mezcla. Con
+ * --key y --delimiter la clave es solo uno de los campos de la línea.
+ * Las claves de bytes se ordenan completas en los trabajadores, que heredan
+ * la proyección: el padre reparte las líneas por sus dos primeros bytes y
+ * ajusta las partes del nivel 0 a esos grupos, cada bloque se ordena por
+ * radix leyendo 8 bytes de las claves por dígito y guarda el prefijo común de
+ * cada línea con la anterior, y cada mezcla usa esos prefijos para comparar
+ * las claves solo desde el primer byte en el que pueden diferir.
+ * Con la opción --merge FILE es una lista separada por comas de ficheros o
+ * segmentos publicados (shm:NOMBRE) ya ordenados, que se leen uno tras otro
+ * proyectándolos en memoria. Cada uno es una parte del nivel 0, que no se
+ * ordena, y los niveles necesarios para mezclarlos (N_LEVELS se ignora) se
+ * resuelven en los trabajadores; con --fuse cada mezcla junta varias entradas
+ * a la vez. Con --output el resultado se escribe secuencialmente en un
+ * fichero.
+ * Con las opciones --union, --intersect, --except y --join se opera FILE, ya
+ * ordenado, con otra entrada ordenada (fichero o shm:NOMBRE). El padre elige
+ * las claves que dividen ambas entradas en tantos rangos como partes tiene el
+ * nivel 0, cada trabajador aplica la operación a su rango de las dos a la vez
+ * y las mezclas solo juntan los resultados. Las operaciones de conjuntos dan
+ * cada clave una vez; el join da pares (clave, número de parejas de
+ * elementos iguales). El resultado se escribe con --output o se publica con
+ * --publish.
+ * Con la opción --speculate el padre vigila las tareas en curso y, cuando una
+ * lleva más del doble de la mediana de las terminadas de su nivel, envía una
+ * copia de respaldo a un trabajador libre. La copia se resuelve en memoria
+ * privada desde los datos que guardó el trabajador original; la primera en
+ * terminar se queda con la tarea y la otra se mata, de modo que un trabajador
+ * lento no retrasa todo el nivel.
+ * Con la opción --compress cada tarea, salvo las del último nivel, deja su
+ * secuencia ordenada comprimida al principio de su rango: por bloques de
+ * PACK_BLOCK claves, la primera y las diferencias con ella empaquetadas con
+ * los bits justos. Las mezclas copian solo las posiciones ocupadas de sus dos
+ * mitades y las decodifican bloque a bloque según avanzan, por lo que cada
+ * nivel mueve menos bytes. Mientras tanto el ilustrador muestra los datos
+ * comprimidos.
+ * Con la opción --verify se calcula al cargar la entrada un hash de
+ * multiconjunto (la suma de un hash de cada elemento, que no depende del
+ * orden). Al terminar, los trabajadores comprueban en paralelo que cada rango
+ * del resultado está ordenado, también en la frontera con el anterior, y
+ * calculan el hash de sus elementos; si no está ordenado o la suma no coincide
+ * con la de la entrada, el resultado no se publica ni se escribe (lo escrito
+ * en --output durante la última mezcla se elimina) y el programa termina con
+ * error. Con --text los trabajadores verifican los prefijos de las claves, y
+ * el padre comprueba después el orden de las líneas por su clave completa.
+ * La entrada se lee con E/S asíncrona (io_uring, o un grupo de hilos si el
+ * núcleo no lo permite): mientras el padre convierte un bloque del fichero ya
+ * están pedidos los siguientes, y en modo stream los trabajadores ordenan los
+ * anteriores a la vez. Con --output el padre escribe el resultado mientras se
+ * resuelve la última mezcla: la mezcla publica cuántos elementos del principio
+ * ya están en su sitio y el padre los va escribiendo por bloques asíncronos,
+ * de modo que al terminar la mezcla solo queda el final por escribir.
+ * Las tareas del nivel 0 se envían por lotes de partes consecutivas en un solo
+ * mensaje, y el trabajador avisa al padre una vez por lote. El tamaño del lote
+ * se calcula con lo que han tardado las hojas ya terminadas, para que cada
+ * envío lleve al menos OBJETIVO_LOTE ns de trabajo, sin dejar trabajadores
+ * sin lote; así el coste de repartir las hojas no crece con el número de
+ * niveles aunque los bloques sean muy pequeños.
  */
 
+#define _GNU_SOURCE
+
 #include <errno.h>
 #include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <linux/futex.h>
 #include <mqueue.h>
-#include <semaphore.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include "aio.h"
 #include "global.h"
+#include "metrics.h"
+#include "result.h"
 #include "sort.h"
+#include "text.h"
 #include "utils.h"
 
 
 /* Constantes */
-#define SEM_NAME "sem_proyecto"
 #define SHM_NAME "/shm_proyecto"
 #define MQ_NAME "/mq_proyecto"
+#define JOURNAL_SUFFIX ".journal"
+#define NIVEL_CARGA -1
+#define L2_DEFECTO (256 * 1024)
+#define PREFIJO_SHM "shm:"
+#define SEPARADOR_ENTRADAS ","
+#define CGROUP_CPU_MAX "/sys/fs/cgroup/cpu.max"
+#define CGROUP_CFS_QUOTA "/sys/fs/cgroup/cpu/cpu.cfs_quota_us"
+#define CGROUP_CFS_PERIOD "/sys/fs/cgroup/cpu/cpu.cfs_period_us"
+#define FACTOR_REZAGADA 2
+#define MINIMO_REZAGADA 10000000L
+#define PERIODO_SALIDA 1000000L
+#define MAX_MENSAJES 10
+#define BLOQUE_SALIDA (AIO_CHUNK / MAX_LINE_INT)
+#define OBJETIVO_LOTE 2000000L
+#define EN_CURSO(estado) ((estado) == SENT || (estado) == PROCESSING)
 
 #define READ 0
 #define WRITE 1
 
 
-/* Estructura utilizada para enviar mensajes en la cola */
+/* Tipos de mensaje de la cola: una tarea, la copia de respaldo de una tarea
+   rezagada o la verificación de un rango del resultado */
+typedef enum {
+    MENSAJE_TAREA,
+    MENSAJE_RESPALDO,
+    MENSAJE_VERIFICACION
+} TipoMensaje;
+
+
+/* Estructura utilizada para enviar mensajes en la cola. Una tarea del nivel 0
+   puede llevar un lote de n_parts partes consecutivas a partir de n_part */
 typedef struct {
     int n_level;
     int n_part;
+    int n_parts;
+    TipoMensaje tipo;
 } Message;
 
 
@@ -66,18 +227,39 @@ typedef struct {
 
 
 /* Variables globales que serán utilizadas por otras rutinas además del main */
-sem_t *sem = NULL;
+pthread_mutex_t *cerrojo = NULL;
 int i, j, n_processes;
 int flag;
 char buffer[20];
 char ilustracion[2048];
 mqd_t queue = -1;
+mqd_t queue_envio = -1;
+sigset_t setsuspend;
 int fd1[MAX_PARTS][2];
 int fd2[MAX_PARTS][2];
 Message message;
 Pipe pipemsg;
 pid_t *cpid = NULL;
 Sort *sort = NULL;
+FILE *input = NULL;
+int n_leidos = 0;
+char *checkpoint = NULL;
+char journal_name[MAX_STRING];
+FILE *journal = NULL;
+char *publicar = NULL;
+Result *resultado = NULL;
+Metrics *metricas = NULL;
+char *fichero_metricas = NULL;
+long ultimo_volcado = 0;
+Text texto;
+Bool especular = FALSE;
+Sort *copia = NULL;
+FILE *escritor = NULL;
+int escritos = 0;
+volatile sig_atomic_t terminando = 0;
+Message *en_envio = NULL;
+volatile sig_atomic_t terminados = 0;
+volatile sig_atomic_t reenviar = 0;
 
 
 /**
@@ -91,20 +273,299 @@ Sort *sort = NULL;
  * @date 29-04-2020
  */
 void freeAll() {
+    char nombre_metricas[METRICS_MAX_NAME];
+
     if (cpid != NULL)
         free(cpid);
-    if (sort != NULL) {
+    if (copia != NULL)
+        free(copia);
+    if (resultado != NULL) {
+        /* Una vez publicado, el segmento lo elimina su última referencia.
+           Antes, solo el padre lo elimina: los hijos terminan antes de que
+           se publique */
+        if (resultado->magic != RESULT_MAGIC && getpid() == sort->ppid)
+            shm_unlink(publicar);
+        munmap(resultado, RESULT_HEADER_SIZE + sizeof(*sort));
+    }
+    else if (sort != NULL) {
         munmap(sort, sizeof(*sort));
-        shm_unlink(SHM_NAME);
+        if (checkpoint == NULL)
+            shm_unlink(SHM_NAME);
+    }
+    if (metricas != NULL) {
+        /* Los contadores los elimina el proceso principal al terminar */
+        if (getpid() == metricas->ppid) {
+            metrics_name(metricas->ppid, nombre_metricas, sizeof(nombre_metricas));
+            shm_unlink(nombre_metricas);
+        }
+        munmap(metricas, sizeof(*metricas));
     }
+    if (journal != NULL)
+        fclose(journal);
+    if (queue_envio > -1)
+        mq_close(queue_envio);
     if (queue > -1) {
         mq_close(queue);
         mq_unlink(MQ_NAME);
     }
-    if (sem != NULL) {
-        sem_close(sem);
-        sem_unlink(SEM_NAME);
+    if (cerrojo != NULL)
+        munmap(cerrojo, sizeof(*cerrojo));
+    if (input != NULL && input != stdin)
+        fclose(input);
+    if (escritor != NULL)
+        fclose(escritor);
+    text_close(&texto);
+}
+
+
+/**
+ * Coge el cerrojo de la estructura compartida. Si el proceso que lo tenía ha
+ * muerto con él, lo recupera en lugar de quedarse esperando: el cerrojo solo
+ * protege marcas de estado, que el padre corrige al recoger al muerto.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void bloquear() {
+    if (pthread_mutex_lock(cerrojo) == EOWNERDEAD)
+        pthread_mutex_consistent(cerrojo);
+}
+
+
+/**
+ * Suelta el cerrojo de la estructura compartida.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void desbloquear() {
+    pthread_mutex_unlock(cerrojo);
+}
+
+
+/**
+ * Escribe los contadores en formato de Prometheus en el fichero indicado con
+ * --metrics, como mucho una vez por segundo salvo que se fuerce. Se escribe
+ * en un fichero temporal que después se renombra, para que quien lo lea nunca
+ * vea un volcado a medias.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param forzar    TRUE para escribirlos aunque no haya pasado un segundo.
+ */
+void volcar_metricas(Bool forzar) {
+    char temporal[MAX_STRING];
+    FILE *f;
+    long ahora;
+
+    if (fichero_metricas == NULL || metricas == NULL)
+        return;
+
+    ahora = metrics_now();
+    if (!forzar && ahora - ultimo_volcado < 1000000000L)
+        return;
+    ultimo_volcado = ahora;
+
+    snprintf(temporal, sizeof(temporal), "%s.tmp", fichero_metricas);
+    if ((f = fopen(temporal, "w")) == NULL) {
+        perror("fopen metrics");
+        return;
+    }
+    metrics_prometheus(f, metricas);
+    fclose(f);
+    if (rename(temporal, fichero_metricas) == -1)
+        perror("rename metrics");
+}
+
+
+/**
+ * Cuenta desde cero las tareas pendientes, las que están en la cola, las
+ * hojas sin enviar y el tiempo de las hojas terminadas. Se llama al empezar y
+ * cuando los estados cambian fuera de cambiar_estado y cambiar_tarea, al
+ * restaurar las tareas de un trabajador muerto. Se llama con el cerrojo
+ * cogido o antes de crear los trabajadores.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void contar_tareas() {
+    Task *tarea;
+    int level, part;
+
+    sort->pending = sort->queued = 0;
+    sort->leaves_left = sort->leaves_timed = 0;
+    sort->leaves_ns = 0;
+    for (level = 0; level < sort->n_levels; level++) {
+        for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+            tarea = &sort->tasks[level][part];
+            if (tarea->completed == SENT)
+                sort->queued++;
+            sort->pending += EN_CURSO(tarea->completed) + EN_CURSO(tarea->backup);
+            if (level == 0 && tarea->completed == INCOMPLETE)
+                sort->leaves_left++;
+            else if (level == 0 && tarea->completed == COMPLETED && tarea->elapsed > 0) {
+                sort->leaves_timed++;
+                sort->leaves_ns += tarea->elapsed;
+            }
+        }
+    }
+    for (part = 0; part < get_number_checks(sort); part++)
+        sort->pending += EN_CURSO(sort->checks[part].completed);
+}
+
+
+/**
+ * Cambia el estado de una copia de respaldo o de una verificación, llevando
+ * la cuenta de las tareas pendientes. Se llama con el cerrojo cogido.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param estado  Estado a cambiar.
+ * @param nuevo   Nuevo estado.
+ */
+void cambiar_estado(Completed *estado, Completed nuevo) {
+    sort->pending += EN_CURSO(nuevo) - EN_CURSO(*estado);
+    *estado = nuevo;
+}
+
+
+/**
+ * Cambia el estado de una tarea, llevando la cuenta de las pendientes, de
+ * las que están en la cola y, en el nivel 0, de las hojas sin enviar y del
+ * tiempo de las terminadas, que debe estar ya anotado. Se llama con el
+ * cerrojo cogido.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param level  Nivel de la tarea.
+ * @param part   Parte de la tarea dentro del nivel.
+ * @param nuevo  Nuevo estado.
+ */
+void cambiar_tarea(int level, int part, Completed nuevo) {
+    Task *tarea = &sort->tasks[level][part];
+    int signo;
+
+    sort->queued += (nuevo == SENT) - (tarea->completed == SENT);
+    if (level == 0) {
+        sort->leaves_left += (nuevo == INCOMPLETE) - (tarea->completed == INCOMPLETE);
+        if ((nuevo == COMPLETED) != (tarea->completed == COMPLETED) && tarea->elapsed > 0) {
+            signo = (nuevo == COMPLETED) ? 1 : -1;
+            sort->leaves_timed += signo;
+            sort->leaves_ns += signo * tarea->elapsed;
+        }
+    }
+    cambiar_estado(&tarea->completed, nuevo);
+}
+
+
+/**
+ * Ajusta el número de trabajadores activos al de tareas enviadas pendientes
+ * de terminar, despertando a los que estén aparcados si hacen falta más. Se
+ * llama con el cerrojo cogido.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void ajustar_trabajadores() {
+    int activos;
+
+    activos = MAX(1, MIN(n_processes, sort->pending));
+    if (metricas != NULL) {
+        metricas->queued = sort->queued;
+        metricas->active = activos;
+    }
+    if (activos > __atomic_load_n(&sort->active, __ATOMIC_SEQ_CST)) {
+        __atomic_store_n(&sort->active, activos, __ATOMIC_SEQ_CST);
+        syscall(SYS_futex, &sort->active, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+    else {
+        __atomic_store_n(&sort->active, activos, __ATOMIC_SEQ_CST);
+    }
+}
+
+
+/**
+ * Espera en el futex del número de trabajadores activos mientras el índice
+ * del trabajador no entre en él. Las señales (la alarma del ilustrador)
+ * interrumpen la espera, que se reanuda tras atenderlas.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param indice  Índice del trabajador.
+ */
+void aparcar(int indice) {
+    int activos;
+
+    while (indice >= (activos = __atomic_load_n(&sort->active, __ATOMIC_SEQ_CST)))
+        syscall(SYS_futex, &sort->active, FUTEX_WAIT, activos, NULL, NULL, 0);
+}
+
+
+/**
+ * Calcula el número de procesadores disponibles: los de la máscara de
+ * afinidad, limitados por la cuota de CPU del cgroup (v2 o v1) si la hay.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @return  El número de procesadores disponibles, al menos 1.
+ */
+int cpus_disponibles() {
+    cpu_set_t cpus;
+    char cuota[32];
+    long quota = -1, period = 0;
+    int n;
+    FILE *f;
+
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0)
+        n = CPU_COUNT(&cpus);
+    else
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* cgroup v2: "max PERIOD" o "QUOTA PERIOD" */
+    if ((f = fopen(CGROUP_CPU_MAX, "r")) != NULL) {
+        if (fscanf(f, "%31s %ld", cuota, &period) == 2 && strcmp(cuota, "max"))
+            quota = atol(cuota);
+        fclose(f);
+    }
+    /* cgroup v1: la cuota es -1 si no hay límite */
+    else if ((f = fopen(CGROUP_CFS_QUOTA, "r")) != NULL) {
+        if (fscanf(f, "%ld", &quota) != 1)
+            quota = -1;
+        fclose(f);
+        if ((f = fopen(CGROUP_CFS_PERIOD, "r")) != NULL) {
+            if (fscanf(f, "%ld", &period) != 1)
+                period = 0;
+            fclose(f);
+        }
     }
+
+    if (quota > 0 && period > 0)
+        n = MIN(n, (quota + period - 1) / period);
+
+    return MAX(1, n);
 }
 
 
@@ -139,15 +600,18 @@ void manejador_SIGTERM(int sig) {
  * @param sig   Número de señal asociada a SIGUSR1.
  */
 void manejador_SIGUSR1(int sig) {
-    sem_wait(sem);
+    int k;
+
+    bloquear();
     flag = 1;
-    for(j = 0; j < get_number_parts(i, sort->n_levels); j++) {
-        if(sort->tasks[i][j].completed != COMPLETED) {
+    for(k = 0; i < sort->n_levels && k < get_number_parts(i, sort->n_levels); k++) {
+        if(sort->tasks[i][k].completed != COMPLETED) {
             flag = 0;
             break;
         }
     }
-    sem_post(sem);
+    ajustar_trabajadores();
+    desbloquear();
 }
 
 
@@ -164,6 +628,7 @@ void manejador_SIGUSR1(int sig) {
  * @param sig   Número de señal asociada a SIGINT.
  */
 void manejador_SIGINT(int sig) {
+    terminando = 1;
     for (i = 0; i < n_processes+1; i++) {
         if (kill(cpid[i], SIGTERM) == -1) {
             perror("kill");
@@ -176,7 +641,10 @@ void manejador_SIGINT(int sig) {
         wait(NULL);
     }
 
-    munmap(sort, sizeof(*sort));
+    /* El punto de control queda en disco para poder continuar */
+    if (checkpoint != NULL)
+        msync(sort, sizeof(*sort), MS_SYNC);
+
     freeAll();
     exit(EXIT_SUCCESS);
 }
@@ -198,6 +666,10 @@ void manejador_SIGINT(int sig) {
  */
 void manejador_SIGALRM(int sig) {
 
+    /* Al padre la alarma solo le despierta para vigilar las tareas rezagadas */
+    if (sort != NULL && getpid() == sort->ppid)
+        return;
+
     /* Preparamos el envío del mensaje */
     pipemsg.pid = getpid();
     pipemsg.n_level = message.n_level;
@@ -227,336 +699,2289 @@ void manejador_SIGALRM(int sig) {
 
 
 /**
- * Función main. Será la rutina princpal que se ejecutará al comienzo del
- * programa.
+ * Imprime la forma de uso del programa.
  *
  * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
  * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
  * @group 2202
- * @date 29-04-2020
+ * @date 19-10-2026
  *
- * @param argc  Número de argumentos de entrada del programa.
- * @param argv  Puntero a los string de los correspondientes argumentos de
- *              entrada.
- * @return  EXIT_SUCCESS si el programa ha finalizado correctamente.
- *          EXIT_FAILURE en caso contrario.
+ * @param prog  Nombre del programa.
  */
-int main(int argc, char **argv) {
+void uso(char *prog) {
+    fprintf(stderr, "Usage: %s [OPTIONS] <FILE> <N_LEVELS> <N_PROCESSES> [<DELAY>]\n", prog);
+    fprintf(stderr, "       %s -c F -R [--verify] [<N_PROCESSES> [<DELAY>]]\n", prog);
+    fprintf(stderr, "    <FILE> :        Data file, - for the standard input\n");
+    fprintf(stderr, "    <N_LEVELS> :    Number of levels (1 - %d)\n", MAX_LEVELS);
+    fprintf(stderr, "    <N_PROCESSES> : Number of processes (1 - %d), 0 for the available CPUs\n", MAX_PARTS);
+    fprintf(stderr, "    [<DELAY>] :     Delay (ms)\n");
+    fprintf(stderr, "    -s, --stream :  Sort the blocks while the data is being read\n");
+    fprintf(stderr, "    -k, --top-k K : Only find the K smallest elements\n");
+    fprintf(stderr, "    -n, --select N: Only find the element at position N (from 0)\n");
+    fprintf(stderr, "    -r, --natural : Merge the runs already sorted in the data\n");
+    fprintf(stderr, "    -c, --checkpoint F : Keep the sorting state in file F\n");
+    fprintf(stderr, "    -R, --resume :  Continue from the checkpoint F, with the data, levels and options it was started with\n");
+    fprintf(stderr, "    -p, --publish NAME : Leave the result in the read-only shared memory segment NAME\n");
+    fprintf(stderr, "    -g, --group :   Count the occurrences of each element (sorted histogram)\n");
+    fprintf(stderr, "    -f, --fuse L :  Merge L levels at once (1 - %d), 0 to fit the L2 cache\n", MAX_FUSE);
+    fprintf(stderr, "    -M, --metrics F : Write the progress counters to F in Prometheus text format\n");
+    fprintf(stderr, "    -a, --argsort : Output the positions of the data in sorted order (stable)\n");
+    fprintf(stderr, "    -t, --text :    Sort the lines of a text file into --output\n");
+    fprintf(stderr, "    -K, --key N :   Sort the lines by their field N (from 1), 0 for the whole line\n");
+    fprintf(stderr, "    -d, --delimiter C : Fields are separated by C instead of blanks\n");
+    fprintf(stderr, "    -N, --numeric : Compare the keys of the lines as numbers\n");
+    fprintf(stderr, "    -o, --output F : Write the sorted data (or lines) to F while the last merge runs\n");
+    fprintf(stderr, "    -m, --merge :   Merge the sorted inputs FILE,FILE,... (files or shm:NAME)\n");
+    fprintf(stderr, "    -U, --union B : Keys in the sorted FILE or in the sorted input B (file or shm:NAME)\n");
+    fprintf(stderr, "    -I, --intersect B : Keys in both FILE and B\n");
+    fprintf(stderr, "    -E, --except B : Keys in FILE and not in B\n");
+    fprintf(stderr, "    -J, --join B :  Keys in both FILE and B, with the number of pairs of equal elements\n");
+    fprintf(stderr, "    -B, --speculate : Run a backup copy of the tasks much slower than the rest of their level\n");
+    fprintf(stderr, "    -z, --compress : Keep the sorted runs compressed between levels\n");
+    fprintf(stderr, "    -V, --verify :  Check that the result is a sorted permutation of the input\n");
+}
 
-    /* Variables locales */
-    struct mq_attr attributes = {
-        .mq_flags = 0,
-        .mq_maxmsg = 10,
-        .mq_curmsgs = 0,
-        .mq_msgsize = sizeof(Message)
-    };
-    struct sigaction act;
-    sigset_t set;
-    sigset_t setsuspend;
-    int n_levels, delay;
-    int fd_shm;
-    pid_t pid;
-    pid_t ppid;
 
-    /* Comprobamos los arguentos de entrada e inicializamos algunos valores */
-    if (argc < 4) {
-        fprintf(stderr, "Usage: %s <FILE> <N_LEVELS> <N_PROCESSES> [<DELAY>]\n", argv[0]);
-        fprintf(stderr, "    <FILE> :        Data file\n");
-        fprintf(stderr, "    <N_LEVELS> :    Number of levels (1 - %d)\n", MAX_LEVELS);
-        fprintf(stderr, "    <N_PROCESSES> : Number of processes (1 - %d)\n", MAX_PARTS);
-        fprintf(stderr, "    [<DELAY>] :     Delay (ms)\n");
-        exit(EXIT_FAILURE);
-    }
+/**
+ * Compara dos tareas para ordenarlas de mayor a menor prioridad con qsort. A
+ * igual prioridad van en orden de nivel y de parte, de modo que las hojas
+ * consecutivas quedan seguidas y pueden enviarse en un mismo lote.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param a Primera tarea (Message).
+ * @param b Segunda tarea (Message).
+ * @return  Negativo si a va antes que b, positivo si va después, 0 si da igual.
+ */
+int comparar_prioridad(const void *a, const void *b) {
+    const Message *ta = a, *tb = b;
+
+    if (sort->tasks[ta->n_level][ta->n_part].priority != \
+        sort->tasks[tb->n_level][tb->n_part].priority)
+        return sort->tasks[tb->n_level][tb->n_part].priority - \
+               sort->tasks[ta->n_level][ta->n_part].priority;
+    if (ta->n_level != tb->n_level)
+        return ta->n_level - tb->n_level;
+    return ta->n_part - tb->n_part;
+}
 
-    n_levels = atoi(argv[2]);
-    if (n_levels > 10)
-        n_levels = 10;
-    n_processes = atoi(argv[3]);
-    if (n_processes > 512)
-        n_processes = 512;
-    if (argc > 4) {
-        delay = 1e6 * atoi(argv[4]);
-    }
-    else {
-        delay = 1e8;
-    }
 
-    cpid = malloc((n_processes+1)*sizeof(pid_t));
-    if (cpid == NULL) {
-        perror("malloc");
-        freeAll();
-        exit(EXIT_FAILURE);
-    }
+/**
+ * Termina los procesos hijos y el programa tras un error del padre.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void abortar() {
+    int k;
 
-    message.n_level = -1;
-    message.n_part = -1;
+    terminando = 1;
+    for (k = 0; k < n_processes+1; k++)
+        kill(cpid[k], SIGTERM);
+    for (k = 0; k < n_processes+1; k++)
+        wait(NULL);
 
-    /* Creamos las tuberías */
-    for (i = 0; i < n_processes; i++) {
-        if (pipe(fd1[i]) == -1) {
-            perror("pipe");
-            freeAll();
-            exit(EXIT_FAILURE);
+    freeAll();
+    exit(EXIT_FAILURE);
+}
+
+
+/**
+ * Reclama para el trabajador el mensaje recibido: marca como PROCESSING las
+ * partes del lote o el rango a verificar, guardando qué proceso los resuelve,
+ * o la copia de respaldo si el original sigue en curso. Se llama con el
+ * cerrojo cogido.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @return  TRUE si hay que resolver el mensaje, FALSE si ya no hace falta.
+ */
+Bool reclamar_mensaje() {
+    Task *tarea;
+    int part;
+
+    if (message.tipo == MENSAJE_RESPALDO) {
+        /* La copia solo se resuelve si el original sigue en curso */
+        tarea = &sort->tasks[message.n_level][message.n_part];
+        if (tarea->completed != PROCESSING || tarea->backup != SENT || copia == NULL) {
+            if (tarea->backup == SENT)
+                cambiar_estado(&tarea->backup, INCOMPLETE);
+            return FALSE;
         }
-        if (pipe(fd2[i]) == -1) {
-            perror("pipe");
-            freeAll();
-            exit(EXIT_FAILURE);
+        cambiar_estado(&tarea->backup, PROCESSING);
+        tarea->backup_owner = getpid();
+    }
+    else if (message.tipo == MENSAJE_VERIFICACION) {
+        cambiar_estado(&sort->checks[message.n_part].completed, PROCESSING);
+        sort->checks[message.n_part].owner = getpid();
+    }
+    else {
+        for (part = message.n_part; part < message.n_part + message.n_parts; part++) {
+            cambiar_tarea(message.n_level, part, PROCESSING);
+            sort->tasks[message.n_level][part].owner = getpid();
+            sort->tasks[message.n_level][part].saved = FALSE;
         }
     }
 
-    /* Creamos las máscaras necesarias y los manejadores */
-    sigemptyset(&(act.sa_mask));
-    act.sa_flags = 0;
-    act.sa_handler = manejador_SIGTERM;
-    if (sigaction(SIGTERM, &act, NULL) < 0) {
-        perror("sigaction");
-        freeAll();
-        exit(EXIT_FAILURE);
-    }
-    act.sa_handler = manejador_SIGUSR1;
-    if (sigaction(SIGUSR1, &act, NULL) < 0) {
-        perror("sigaction");
-        freeAll();
-        exit(EXIT_FAILURE);
+    return TRUE;
+}
+
+
+/**
+ * Resuelve la copia de respaldo de una tarea rezagada, ya reclamada, en una
+ * estructura privada, a partir de la copia que guardó de sus datos el
+ * trabajador original. Si termina antes que él, escribe el resultado sobre la copia
+ * guardada y lo mata; el padre instala el resultado al recogerlo, igual que
+ * cuando restaura la tarea de un trabajador muerto. Si el original termina
+ * antes, el padre mata a este trabajador.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void resolver_copia() {
+    Task *tarea = &sort->tasks[message.n_level][message.n_part];
+    Status estado;
+    long inicio;
+
+    inicio = metrics_now();
+    estado = speculate_task(sort, message.n_level, message.n_part, copia);
+
+    /* La primera copia en terminar se queda con la tarea */
+    bloquear();
+    if (estado == OK && tarea->completed == PROCESSING && \
+        tarea->backup == PROCESSING && tarea->backup_owner == getpid()) {
+        commit_speculation(sort, message.n_level, message.n_part, copia);
+        cambiar_estado(&tarea->backup, COMPLETED);
+        persist_task(sort, message.n_level, message.n_part);
+        metrics_task_done(metricas, message.n_level, tarea->end - tarea->ini, \
+                          i, metrics_now() - inicio);
+        if (metricas != NULL)
+            __atomic_add_fetch(&metricas->backups_won, 1, __ATOMIC_RELAXED);
+        kill(tarea->owner, SIGKILL);
     }
-    act.sa_handler = manejador_SIGALRM;
-    if (sigaction(SIGALRM, &act, NULL) < 0) {
-        perror("sigaction");
-        freeAll();
-        exit(EXIT_FAILURE);
+    else if (tarea->backup_owner == getpid()) {
+        cambiar_estado(&tarea->backup, INCOMPLETE);
+        tarea->backup_owner = 0;
     }
+    desbloquear();
+}
 
-    sigemptyset(&set);
-    sigaddset(&set, SIGUSR1);
-    if (sigprocmask(SIG_BLOCK, &set, NULL) == -1) {
-        perror("sigprocmask");
-        freeAll();
-        exit(EXIT_FAILURE);
-    }
 
-    sigfillset(&setsuspend);
-    sigdelset(&setsuspend, SIGUSR1);
+/**
+ * Verifica un rango del resultado, ya marcado como en curso al recibirlo,
+ * lo marca como completado igual que las tareas y avisa al padre.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void comprobar_parte() {
+    Check *comprobacion = &sort->checks[message.n_part];
 
-    /* Creamos el semáforo */
-    if ((sem = sem_open(SEM_NAME, O_CREAT | O_EXCL, S_IRUSR | S_IWUSR, 1)) == SEM_FAILED) {
-        perror("sem_open");
-        freeAll();
-        exit(EXIT_FAILURE);
-    }
+    verify_part(sort, message.n_part);
 
-    /* Inicializamos la memoria compartida */
-    fd_shm = shm_open(SHM_NAME, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
-    if (fd_shm == -1) {
-        perror("shm_open");
-        freeAll();
-        exit(EXIT_FAILURE);
-    }
+    bloquear();
+    cambiar_estado(&comprobacion->completed, COMPLETED);
+    desbloquear();
 
-    if (ftruncate(fd_shm, sizeof(Sort)) == -1) {
-        perror("ftruncate");
+    if (kill(sort->ppid, SIGUSR1) == -1) {
+        perror("kill");
         freeAll();
         exit(EXIT_FAILURE);
     }
+}
 
-    sort = mmap(NULL, sizeof(*sort), PROT_READ | PROT_WRITE, MAP_SHARED, fd_shm, 0);
 
-    if (sort == MAP_FAILED) {
-        perror("map failed");
+/**
+ * Código del trabajador. Se ejecutará hasta la llegada de la señal SIGTERM,
+ * resolviendo las tareas que reciba de la cola de mensajes, una a una o por
+ * lotes de hojas consecutivas, y avisando al padre una vez por mensaje. Antes
+ * de resolver una tarea guarda una copia de sus datos para que pueda repetirse
+ * si el trabajador muere a mitad.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void trabajador() {
+    struct sigaction act;
+    struct pollfd espera;
+    long inicio, duraciones[MAX_PARTS];
+    int k, primera;
+    Bool reclamado;
+
+    /* Ignoramos la señal SIGINT, cerramos los descriptores de fichero de
+       las tuberías que no vayamos a utilizar y establecemos la primera
+       alarma */
+    sigemptyset(&(act.sa_mask));
+    act.sa_flags = 0;
+    act.sa_handler = SIG_IGN;
+    if (sigaction(SIGINT, &act, NULL) < 0) {
+        perror("sigaction");
         freeAll();
         exit(EXIT_FAILURE);
     }
 
-    if (init_sort(argv[1], sort, n_levels, n_processes, delay) == ERROR) {
-        perror("init_sort");
-        freeAll();
+    close(fd1[i][READ]);
+    close(fd2[i][WRITE]);
+
+    message.n_level = -1;
+    message.n_part = -1;
+    message.n_parts = 0;
+    alarm(1);
+
+    espera.fd = queue;
+    espera.events = POLLIN;
+    if (especular && (copia = malloc(sizeof(Sort))) == NULL)
+        perror("malloc");
+
+    /* El bucle se ejecutará hasta la llegada de la señal SIGTERM */
+    while(1) {
+
+        /* Si hay menos tareas pendientes que trabajadores, los sobrantes
+           esperan en el futex sin competir por la cola */
+        aparcar(i);
+
+        /* Esperamos a que haya mensajes en la cola */
+        if (poll(&espera, 1, -1) == -1 && errno != EINTR) {
+            perror("poll");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+
+        /* Recibimos el mensaje y lo reclamamos con el cerrojo cogido, de
+           modo que un mensaje enviado sigue en la cola hasta que tiene
+           dueño. Si otro trabajador se nos adelanta volvemos a esperar */
+        bloquear();
+        if (mq_receive(queue, (char*)&message, sizeof(message), NULL) == -1) {
+            desbloquear();
+            if (errno != EAGAIN && errno != EINTR) {
+                perror("mq_receive");
+                freeAll();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+        reclamado = reclamar_mensaje();
+        desbloquear();
+
+        if (!reclamado)
+            continue;
+        if (message.tipo == MENSAJE_RESPALDO) {
+            resolver_copia();
+            continue;
+        }
+        if (message.tipo == MENSAJE_VERIFICACION) {
+            comprobar_parte();
+            continue;
+        }
+
+        primera = message.n_part;
+        for (k = 0; k < message.n_parts; k++) {
+            message.n_part = primera + k;
+
+            /* Guardamos la copia de los datos y resolvemos la parte */
+            inicio = metrics_now();
+            snapshot_task(sort, message.n_level, message.n_part);
+
+            /* Con la ejecución especulativa la tarea puede tener una copia de
+               respaldo desde que sus datos están guardados */
+            if (especular) {
+                bloquear();
+                sort->tasks[message.n_level][message.n_part].start = inicio;
+                desbloquear();
+            }
+            /* Un error de la tarea se repetiría al reenviarla */
+            if (solve_task(sort, message.n_level, message.n_part) == ERROR) {
+                fprintf(stderr, "Level %d, part %d failed\n", message.n_level, message.n_part);
+                freeAll();
+                exit(EXIT_FAILURE);
+            }
+            metrics_task_done(metricas, message.n_level, \
+                              sort->tasks[message.n_level][message.n_part].end - \
+                              sort->tasks[message.n_level][message.n_part].ini, \
+                              i, metrics_now() - inicio);
+            duraciones[k] = metrics_now() - inicio;
+
+            /* Con la ejecución especulativa cada parte se confirma al
+               terminar, para que pueda cancelarse su copia de respaldo */
+            if (especular) {
+                bloquear();
+                sort->tasks[message.n_level][message.n_part].elapsed = duraciones[k];
+                cambiar_tarea(message.n_level, message.n_part, COMPLETED);
+                desbloquear();
+            }
+        }
+
+        /* Marcamos las partes como COMPLETED asegurando la exclusión mutua.
+           Si el trabajador muere antes, las ya resueltas se restauran y se
+           repiten igual que las demás */
+        if (!especular) {
+            bloquear();
+            for (k = 0; k < message.n_parts; k++) {
+                sort->tasks[message.n_level][primera + k].elapsed = duraciones[k];
+                cambiar_tarea(message.n_level, primera + k, COMPLETED);
+            }
+            desbloquear();
+        }
+
+        /* Avisamos una sola vez por lote al padre de que debe revisar si se
+           han completado las tareas del nivel */
+        if (kill(sort->ppid, SIGUSR1) == -1) {
+            perror("kill");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+
+/**
+ * Muestra el vector que se está ordenando. Los prefijos de las claves de
+ * texto no caben en un diagrama de barras, por lo que se escriben como
+ * números.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void mostrar_vector() {
+    if (texto.keys != NULL)
+        print_vector(sort->data, sort->n_elements);
+    else
+        plot_vector(sort->data, sort->n_elements);
+}
+
+
+/**
+ * Código del ilustrador. Se ejecutará hasta la llegada de la señal SIGTERM,
+ * imprimiendo el vector y el estado de los trabajadores cada vez que todos
+ * ellos se lo notifiquen.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param sustituto TRUE si sustituye a un ilustrador que ha muerto.
+ */
+void ilustrador(Bool sustituto) {
+    struct sigaction act;
+
+    /* Ignoramos la señal SIGINT, cerramos los descriptores de fichero de
+       las tuberías que no vayamos a utilizar y pintamos el vector inicial */
+    sigemptyset(&(act.sa_mask));
+    act.sa_flags = 0;
+    act.sa_handler = SIG_IGN;
+    if (sigaction(SIGINT, &act, NULL) < 0) {
+        perror("sigaction");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < n_processes; i++) {
+        close(fd1[i][WRITE]);
+        close(fd2[i][READ]);
+    }
+
+    /* Un sustituto no sabe qué estados leyó el ilustrador anterior, así que
+       libera a los trabajadores que pudieran estar esperando su respuesta */
+    if (sustituto) {
+        for(i = 0; i < n_processes; i++) {
+            strncpy(buffer, "Continue", sizeof("Continue"));
+            if (write(fd2[i][WRITE], buffer, strlen(buffer) + 1) == -1) {
+                perror("write2");
+                freeAll();
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    mostrar_vector();
+    printf("\nStarting algorithm with %d levels and %d processes...\n", sort->n_levels, sort->n_processes);
+
+    /* El bucle se ejecutará hasta la llegada de la señal SIGTERM */
+    while(1) {
+        sprintf(ilustracion, "\n     %-10s%-10s     %-10s%-10s%-10s%-10s\n\n",
+                "PID", "STATUS", "LEVEL", "PART", "INI", "END");
+
+        /* Leemos todos los estados de los trabajadores preparando la impresión */
+        for(i = 0; i < n_processes; i++) {
+            if (read(fd1[i][READ], &pipemsg, sizeof(pipemsg)) == -1) {
+                perror("read");
+                freeAll();
+                exit(EXIT_FAILURE);
+            }
+            if (pipemsg.completed == PROCESSING)
+                sprintf(ilustracion + strlen(ilustracion), "     %-10ld%-10s     %-10d%-10d%-10d%-10d\n",
+                        (long)pipemsg.pid, "PROCESSING", pipemsg.n_level, pipemsg.n_part,
+                        sort->tasks[pipemsg.n_level][pipemsg.n_part].ini, sort->tasks[pipemsg.n_level][pipemsg.n_part].end);
+            else {
+                if (pipemsg.completed == INCOMPLETE)
+                    strncpy(buffer, "INCOMPLETE", sizeof("INCOMPLETE"));
+                else if (pipemsg.completed == COMPLETED)
+                    strncpy(buffer, "COMPLETED", sizeof("COMPLETED"));
+                else if (pipemsg.completed == SENT)
+                    strncpy(buffer, "SENT", sizeof("SENT"));
+                sprintf(ilustracion + strlen(ilustracion), "     %-10ld%-10s     %-10s%-10s%-10s%-10s\n",
+                        (long)pipemsg.pid, buffer, "-", "-", "-", "-");
+            }
+        }
+
+        /* Imprimimos el vector por pantalla junto con el estado de todos los
+           trabajadores */
+        mostrar_vector();
+        fprintf(stdout, "%s", ilustracion);
+        fflush(stdout);
+
+        /* Avisamos a todos los trabajadores de que pueden continuar con su
+           ejecución */
+        for(i = 0; i < n_processes; i++) {
+            strncpy(buffer, "Continue", sizeof("Continue"));
+            if (write(fd2[i][WRITE], buffer, strlen(buffer) + 1) == -1) {
+                perror("write2");
+                freeAll();
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+}
+
+
+/**
+ * Rutina manejadora de la señal SIGCHLD. Solo anota que algún hijo ha
+ * terminado; el padre lo recoge con recoger_hijos al despertar.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param sig   Número de señal asociada a SIGCHLD.
+ */
+void manejador_SIGCHLD(int sig) {
+    terminados = 1;
+}
+
+
+/**
+ * Busca en una lista de mensajes uno que lleve una tarea, su copia de
+ * respaldo o una verificación.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param mensajes    Mensajes.
+ * @param n_mensajes  Número de mensajes.
+ * @param tipo        Tipo de mensaje buscado.
+ * @param level       Nivel de la tarea.
+ * @param part        Parte de la tarea o rango verificado.
+ * @return  TRUE si alguno de los mensajes la lleva, FALSE en caso contrario.
+ */
+Bool buscar_mensaje(Message *mensajes, int n_mensajes, TipoMensaje tipo, int level, int part) {
+    int k;
+
+    for (k = 0; k < n_mensajes; k++) {
+        if (mensajes[k].tipo != tipo)
+            continue;
+        if (tipo == MENSAJE_VERIFICACION && mensajes[k].n_part == part)
+            return TRUE;
+        if (tipo != MENSAJE_VERIFICACION && mensajes[k].n_level == level && \
+            mensajes[k].n_part <= part && part < mensajes[k].n_part + mensajes[k].n_parts)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+
+/**
+ * Comprueba, tras la muerte de un trabajador, que toda tarea, copia de
+ * respaldo o verificación enviada y sin dueño sigue en la cola o es la que
+ * el padre está enviando. Un trabajador que muere entre recibir un mensaje y
+ * reclamarlo se lo lleva consigo; lo que falta vuelve a quedar pendiente. La
+ * cola se vacía y se vuelve a llenar con los mismos mensajes. Se llama con el
+ * cerrojo cogido, por lo que ningún trabajador está reclamando mientras.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void reconciliar_cola() {
+    Message mensajes[MAX_MENSAJES + 1];
+    unsigned int prioridades[MAX_MENSAJES];
+    Task *tarea;
+    int k, n_mensajes, level, part;
+
+    for (n_mensajes = 0; n_mensajes < MAX_MENSAJES; n_mensajes++) {
+        if (mq_receive(queue, (char*)&mensajes[n_mensajes], sizeof(Message), \
+                       &prioridades[n_mensajes]) == -1)
+            break;
+    }
+    for (k = 0; k < n_mensajes; k++) {
+        if (mq_send(queue_envio, (char*)&mensajes[k], sizeof(Message), prioridades[k]) == -1)
+            perror("mq_send");
+    }
+    if (en_envio != NULL)
+        mensajes[n_mensajes++] = *en_envio;
+
+    for (level = 0; level < sort->n_levels; level++) {
+        for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+            tarea = &sort->tasks[level][part];
+            if (tarea->completed == SENT && \
+                !buscar_mensaje(mensajes, n_mensajes, MENSAJE_TAREA, level, part)) {
+                cambiar_tarea(level, part, INCOMPLETE);
+                reenviar = 1;
+            }
+            if (tarea->backup == SENT && \
+                !buscar_mensaje(mensajes, n_mensajes, MENSAJE_RESPALDO, level, part))
+                cambiar_estado(&tarea->backup, INCOMPLETE);
+        }
+    }
+    for (part = 0; part < get_number_checks(sort); part++) {
+        if (sort->checks[part].completed == SENT && \
+            !buscar_mensaje(mensajes, n_mensajes, MENSAJE_VERIFICACION, -1, part)) {
+            cambiar_estado(&sort->checks[part].completed, INCOMPLETE);
+            reenviar = 1;
+        }
+    }
+}
+
+
+/**
+ * Recoge los hijos que hayan terminado y, si no estamos terminando, restaura
+ * las tareas que estuvieran resolviendo, marca que deben reenviarse, junto
+ * con las que se hayan perdido con ellos, y crea un proceso que los
+ * sustituya. Se llama desde el flujo normal del padre al despertar, nunca
+ * desde un manejador.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void recoger_hijos() {
+    sigset_t mask;
+    pid_t muerto, pid;
+    int k, level, part, status;
+    Bool confirmadas = FALSE;
+
+    if (!terminados)
+        return;
+    terminados = 0;
+
+    while ((muerto = waitpid(-1, &status, WNOHANG)) > 0) {
+        if (terminando)
+            continue;
+
+        for (k = 0; k < n_processes+1 && cpid[k] != muerto; k++);
+        if (k == n_processes+1)
+            continue;
+
+        /* Un trabajador que termina por sí mismo con error no se sustituye:
+           su tarea volvería a fallar */
+        if (k < n_processes && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_FAILURE) {
+            abortar();
+        }
+
+        /* Las tareas del trabajador muerto vuelven a estar pendientes, salvo
+           si lo ha matado una copia de respaldo que ya había terminado: su
+           resultado está en la copia guardada y al restaurarla se completa */
+        if (k < n_processes) {
+            bloquear();
+            for (level = 0; level < sort->n_levels; level++) {
+                for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+                    if (sort->tasks[level][part].completed == PROCESSING && \
+                        sort->tasks[level][part].owner == muerto) {
+                        if (sort->tasks[level][part].backup == COMPLETED) {
+                            restore_task(sort, level, part);
+                            sort->tasks[level][part].completed = COMPLETED;
+                            confirmadas = TRUE;
+                        }
+                        else {
+                            restore_task(sort, level, part);
+                            reenviar = 1;
+                        }
+                    }
+                    else if (sort->tasks[level][part].backup == PROCESSING && \
+                             sort->tasks[level][part].backup_owner == muerto) {
+                        sort->tasks[level][part].backup = INCOMPLETE;
+                        sort->tasks[level][part].backup_owner = 0;
+                    }
+                }
+            }
+            for (part = 0; part < get_number_checks(sort); part++) {
+                if (sort->checks[part].completed == PROCESSING && \
+                    sort->checks[part].owner == muerto) {
+                    sort->checks[part].completed = INCOMPLETE;
+                    reenviar = 1;
+                }
+            }
+            reconciliar_cola();
+            /* restore_task cambia los estados por su cuenta */
+            contar_tareas();
+            ajustar_trabajadores();
+            desbloquear();
+        }
+
+        /* Creamos el sustituto con la máscara que tenían los originales */
+        if ((pid = fork()) == -1) {
+            perror("fork");
+            continue;
+        }
+        if (!pid) {
+            sigemptyset(&mask);
+            sigaddset(&mask, SIGUSR1);
+            sigaddset(&mask, SIGCHLD);
+            sigprocmask(SIG_SETMASK, &mask, NULL);
+            i = k;
+            if (k < n_processes)
+                trabajador();
+            else
+                ilustrador(TRUE);
+        }
+        cpid[k] = pid;
+    }
+
+    /* Las tareas confirmadas pueden completar el nivel */
+    if (confirmadas)
+        manejador_SIGUSR1(SIGUSR1);
+}
+
+
+/**
+ * Envía un mensaje a los trabajadores a través de la cola de mensajes. Si la
+ * cola está llena espera a que los trabajadores avancen, lo que también
+ * permite sustituir a los que hayan muerto; mientras tanto el mensaje cuenta
+ * como si ya estuviera en la cola.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param mensaje   Mensaje a enviar.
+ * @param prioridad Prioridad del mensaje en la cola.
+ */
+void enviar_mensaje(Message *mensaje, unsigned int prioridad) {
+    en_envio = mensaje;
+    while (mq_send(queue_envio, (char*)mensaje, sizeof(*mensaje), prioridad) == -1) {
+        if (errno == EAGAIN) {
+            sigsuspend(&setsuspend);
+            recoger_hijos();
+        }
+        else if (errno != EINTR) {
+            perror("mq_send");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+    }
+    en_envio = NULL;
+}
+
+
+/**
+ * Calcula cuántas hojas consecutivas se envían en un mismo mensaje a partir
+ * de lo que han tardado las ya terminadas, de forma que cada envío lleve al
+ * menos OBJETIVO_LOTE ns de trabajo y su coste sea despreciable frente a él.
+ * Mientras no hay medidas las hojas se envían de una en una, y nunca se
+ * agrupan tantas que queden trabajadores sin lote. Se llama con el cerrojo
+ * cogido.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @return  Número máximo de hojas del lote.
+ */
+int tamano_lote() {
+    if (sort->leaves_timed == 0)
+        return 1;
+
+    return MAX(1, MIN(OBJETIVO_LOTE * sort->leaves_timed / sort->leaves_ns, \
+                      sort->leaves_left / n_processes));
+}
+
+
+/**
+ * Marca una tarea como enviada asegurando la exclusión mutua y la envía a los
+ * trabajadores a través de la cola de mensajes. Una hoja se envía junto con
+ * las siguientes que estén listas, hasta el tamaño que indique tamano_lote,
+ * y con la prioridad de la mayor del lote. Si se pide, un lote que no está
+ * completo porque faltan bloques por leer no se envía todavía. El padre envía
+ * por un descriptor no bloqueante propio, ya que el modo no bloqueante se
+ * comparte entre procesos tras fork.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param level    Nivel de la tarea.
+ * @param part     Parte de la tarea dentro del nivel.
+ * @param esperar  TRUE para no enviar un lote incompleto que acaba en el
+ *                 último bloque leído.
+ */
+void enviar_tarea(int level, int part, Bool esperar) {
+    Message tarea;
+    int k, lote, prioridad = 0;
+
+    tarea.n_level = level;
+    tarea.n_part = part;
+    tarea.n_parts = 1;
+    tarea.tipo = MENSAJE_TAREA;
+    bloquear();
+    if (level == 0) {
+        lote = tamano_lote();
+        while (tarea.n_parts < lote && part + tarea.n_parts < n_leidos && \
+               check_task_ready(sort, 0, part + tarea.n_parts))
+            tarea.n_parts++;
+        if (esperar && tarea.n_parts < lote && part + tarea.n_parts == n_leidos) {
+            desbloquear();
+            return;
+        }
+    }
+    for (k = part; k < part + tarea.n_parts; k++) {
+        cambiar_tarea(level, k, SENT);
+        prioridad = MAX(prioridad, sort->tasks[level][k].priority);
+    }
+    ajustar_trabajadores();
+    desbloquear();
+
+    enviar_mensaje(&tarea, prioridad);
+}
+
+
+/**
+ * Envía todas las tareas que están listas. Las tareas del nivel 0 solo lo
+ * están una vez leídos sus datos, lo que se controla con n_leidos; mientras
+ * quedan bloques por leer se esperan hasta completar su lote.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void enviar_listas() {
+    Message listas[MAX_PARTS];
+    int level, part, n_listas, k;
+
+    /* Recogemos las tareas listas con una sola sección crítica */
+    n_listas = 0;
+    bloquear();
+    for (level = sort->n_levels - 1; level >= 0; level--) {
+        for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+            if (level == 0 && part >= n_leidos)
+                break;
+            if (n_listas < MAX_PARTS && check_task_ready(sort, level, part)) {
+                listas[n_listas].n_level = level;
+                listas[n_listas].n_part = part;
+                n_listas++;
+            }
+        }
+    }
+    desbloquear();
+
+    /* Las hojas que ya han ido en el lote de otra se saltan */
+    qsort(listas, n_listas, sizeof(Message), comparar_prioridad);
+    for (k = 0; k < n_listas; k++) {
+        if (sort->tasks[listas[k].n_level][listas[k].n_part].completed == INCOMPLETE)
+            enviar_tarea(listas[k].n_level, listas[k].n_part, \
+                         n_leidos < get_number_parts(0, sort->n_levels));
+    }
+}
+
+
+/**
+ * Envía las tareas pendientes de un nivel de mayor a menor prioridad, de forma
+ * que las del camino crítico se resuelven antes. Las hojas van por lotes.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param level Nivel a enviar.
+ */
+void enviar_nivel(int level) {
+    Message pendientes[MAX_PARTS];
+    int part, n_pendientes;
+
+    n_pendientes = 0;
+    for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+        if (sort->tasks[level][part].completed == INCOMPLETE) {
+            pendientes[n_pendientes].n_level = level;
+            pendientes[n_pendientes].n_part = part;
+            n_pendientes++;
+        }
+    }
+
+    /* Las hojas que ya han ido en el lote de otra se saltan */
+    qsort(pendientes, n_pendientes, sizeof(Message), comparar_prioridad);
+    for (part = 0; part < n_pendientes; part++) {
+        if (sort->tasks[level][pendientes[part].n_part].completed == INCOMPLETE)
+            enviar_tarea(pendientes[part].n_level, pendientes[part].n_part, FALSE);
+    }
+}
+
+
+/**
+ * Reenvía las tareas de un nivel que han vuelto a quedar pendientes por la
+ * muerte del trabajador que las resolvía.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param level Nivel en curso.
+ */
+void reenviar_nivel(int level) {
+    reenviar = 0;
+    enviar_nivel(level);
+}
+
+
+/**
+ * Compara dos duraciones de menor a mayor con qsort.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param a Primera duración (long).
+ * @param b Segunda duración (long).
+ * @return  Negativo si a es menor que b, positivo si es mayor, 0 si son iguales.
+ */
+int comparar_duracion(const void *a, const void *b) {
+    long da = *(const long *)a, db = *(const long *)b;
+
+    return (da > db) - (da < db);
+}
+
+
+/**
+ * Busca las tareas rezagadas y envía una copia de respaldo de cada una si hay
+ * trabajadores libres. Una tarea está rezagada cuando lleva en curso más de
+ * FACTOR_REZAGADA veces la mediana de las tareas terminadas de su nivel, que
+ * solo se tiene en cuenta cuando ha terminado al menos la mitad del nivel.
+ * También cancela las copias cuyo original ya ha terminado y programa una
+ * alarma para cuando la siguiente tarea en curso vaya a quedarse rezagada.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void vigilar_rezagadas() {
+    struct itimerval alarma;
+    Message respaldo;
+    Task *tarea;
+    long duraciones[MAX_PARTS];
+    long ahora, limite, espera, proxima = 0;
+    int level, part, n_hechas, ocupados = 0;
+
+    memset(&alarma, 0, sizeof(alarma));
+    respaldo.n_parts = 1;
+    respaldo.tipo = MENSAJE_RESPALDO;
+    ahora = metrics_now();
+
+    bloquear();
+    for (level = 0; level < sort->n_levels; level++) {
+        for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+            tarea = &sort->tasks[level][part];
+            if (tarea->completed == COMPLETED && tarea->backup == PROCESSING) {
+                kill(tarea->backup_owner, SIGKILL);
+                cambiar_estado(&tarea->backup, INCOMPLETE);
+                tarea->backup_owner = 0;
+            }
+            if (tarea->completed == SENT || tarea->completed == PROCESSING)
+                ocupados++;
+            if (tarea->backup == SENT || tarea->backup == PROCESSING)
+                ocupados++;
+        }
+    }
+
+    for (level = 0; level < sort->n_levels; level++) {
+        n_hechas = 0;
+        for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+            if (sort->tasks[level][part].completed == COMPLETED && \
+                sort->tasks[level][part].elapsed > 0)
+                duraciones[n_hechas++] = sort->tasks[level][part].elapsed;
+        }
+        if (n_hechas == 0 || 2 * n_hechas < get_number_parts(level, sort->n_levels))
+            continue;
+
+        qsort(duraciones, n_hechas, sizeof(long), comparar_duracion);
+        limite = MAX(FACTOR_REZAGADA * duraciones[n_hechas / 2], MINIMO_REZAGADA);
+
+        for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+            tarea = &sort->tasks[level][part];
+            if (tarea->completed != PROCESSING || tarea->start == 0 || \
+                !tarea->saved || tarea->backup != INCOMPLETE)
+                continue;
+
+            if (ahora - tarea->start < limite) {
+                if (proxima == 0 || tarea->start + limite < proxima)
+                    proxima = tarea->start + limite;
+            }
+            else if (ocupados < n_processes) {
+                respaldo.n_level = level;
+                respaldo.n_part = part;
+                if (mq_send(queue_envio, (char*)&respaldo, sizeof(respaldo), tarea->priority) == 0) {
+                    cambiar_estado(&tarea->backup, SENT);
+                    ocupados++;
+                    if (metricas != NULL)
+                        metricas->backups_sent++;
+                }
+            }
+        }
+    }
+    ajustar_trabajadores();
+    desbloquear();
+
+    /* La espera se redondea hacia arriba a microsegundos antes de separar
+       los segundos, para que tv_usec no llegue a 1000000 */
+    if (proxima > 0) {
+        espera = (proxima - ahora) / 1000 + 1;
+        alarma.it_value.tv_sec = espera / 1000000L;
+        alarma.it_value.tv_usec = espera % 1000000L;
+    }
+    setitimer(ITIMER_REAL, &alarma, NULL);
+}
+
+
+/**
+ * Verifica el resultado en los trabajadores: cada uno comprueba que un rango
+ * está ordenado, también respecto al último elemento del rango anterior, y
+ * calcula el hash de sus elementos. La suma de los hashes debe coincidir con
+ * la de la entrada, calculada al cargarla, ya que no depende del orden. Las
+ * comprobaciones de los trabajadores que mueran se vuelven a enviar.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @return  OK si el resultado es una permutación ordenada de la entrada,
+ *          ERROR en caso contrario.
+ */
+Status verificar_resultado() {
+    Message comprobacion;
+    unsigned long long hash;
+    long inicio;
+    int part, n_checks, n_hechas, desordenada;
+
+    inicio = metrics_now();
+    n_checks = get_number_checks(sort);
+    comprobacion.n_level = -1;
+    comprobacion.n_parts = 1;
+    comprobacion.tipo = MENSAJE_VERIFICACION;
+
+    bloquear();
+    for (part = 0; part < n_checks; part++)
+        cambiar_estado(&sort->checks[part].completed, INCOMPLETE);
+    desbloquear();
+
+    reenviar = 1;
+    do {
+        /* Enviamos las comprobaciones pendientes */
+        if (reenviar) {
+            reenviar = 0;
+            for (part = 0; part < n_checks; part++) {
+                if (sort->checks[part].completed != INCOMPLETE)
+                    continue;
+                bloquear();
+                cambiar_estado(&sort->checks[part].completed, SENT);
+                ajustar_trabajadores();
+                desbloquear();
+                comprobacion.n_part = part;
+                enviar_mensaje(&comprobacion, 0);
+            }
+        }
+
+        bloquear();
+        for (n_hechas = 0; n_hechas < n_checks && \
+             sort->checks[n_hechas].completed == COMPLETED; n_hechas++);
+        desbloquear();
+        if (n_hechas < n_checks) {
+            sigsuspend(&setsuspend);
+            recoger_hijos();
+        }
+    } while (n_hechas < n_checks);
+
+    hash = 0;
+    desordenada = -1;
+    for (part = 0; part < n_checks; part++) {
+        hash += sort->checks[part].hash;
+        if (desordenada < 0 && !sort->checks[part].sorted)
+            desordenada = part;
+    }
+
+    if (desordenada >= 0) {
+        fprintf(stderr, "Verification failed: range %d of %d is not sorted\n", desordenada, n_checks);
+        return ERROR;
+    }
+    if (hash != sort->checksum) {
+        fprintf(stderr, "Verification failed: the result is not a permutation of the input " \
+                "(hash %016llx, expected %016llx)\n", hash, sort->checksum);
+        return ERROR;
+    }
+
+    printf("\nVerified: sorted permutation of the input (hash %016llx) in %.3f ms\n", \
+           hash, (metrics_now() - inicio) / 1e6);
+    return OK;
+}
+
+
+/**
+ * Proyecta la estructura compartida desde el fichero de punto de control y
+ * abre su diario. Al continuar, las tareas que no figuran en el diario se
+ * restauran desde su copia y se marcan como pendientes.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param resume    TRUE para continuar desde un punto de control existente.
+ * @return  OK si todo ha ido bien, ERROR en caso contrario.
+ */
+Status abrir_checkpoint(Bool resume) {
+    static Bool anotada[MAX_LEVELS][MAX_PARTS];
+    Bool cargado = FALSE;
+    struct stat st;
+    int fd, level, part;
+
+    snprintf(journal_name, sizeof(journal_name), "%s%s", checkpoint, JOURNAL_SUFFIX);
+
+    fd = open(checkpoint, resume ? O_RDWR : (O_RDWR | O_CREAT | O_TRUNC), S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        perror("open checkpoint");
+        return ERROR;
+    }
+    if (resume && (fstat(fd, &st) == -1 || st.st_size != sizeof(Sort))) {
+        fprintf(stderr, "%s: not a checkpoint of this program\n", checkpoint);
+        close(fd);
+        return ERROR;
+    }
+    if (!resume && ftruncate(fd, sizeof(Sort)) == -1) {
+        perror("ftruncate");
+        close(fd);
+        return ERROR;
+    }
+
+    sort = mmap(NULL, sizeof(*sort), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (sort == MAP_FAILED) {
+        sort = NULL;
+        perror("map failed");
+        return ERROR;
+    }
+
+    if (!resume) {
+        journal = fopen(journal_name, "w");
+        if (journal == NULL) {
+            perror("fopen journal");
+            return ERROR;
+        }
+        return OK;
+    }
+
+    /* Solo las tareas anotadas en el diario se consideran terminadas */
+    journal = fopen(journal_name, "a+");
+    if (journal == NULL) {
+        perror("fopen journal");
+        return ERROR;
+    }
+    memset(anotada, 0, sizeof(anotada));
+    rewind(journal);
+    while (fscanf(journal, "%d %d", &level, &part) == 2) {
+        if (level >= 0 && level < sort->n_levels && \
+            part >= 0 && part < get_number_parts(level, sort->n_levels))
+            anotada[level][part] = TRUE;
+        else if (level == NIVEL_CARGA)
+            cargado = TRUE;
+    }
+
+    /* Sin la marca de carga los datos pueden no haber llegado al fichero */
+    if (!cargado) {
+        fprintf(stderr, "%s: interrupted before the data was loaded\n", checkpoint);
+        return ERROR;
+    }
+
+    for (level = 0; level < sort->n_levels; level++) {
+        for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+            if (anotada[level][part])
+                sort->tasks[level][part].completed = COMPLETED;
+            /* El resultado de una copia de respaldo ya terminada está en la
+               copia guardada */
+            else if (sort->tasks[level][part].completed == PROCESSING && \
+                     sort->tasks[level][part].backup == COMPLETED) {
+                restore_task(sort, level, part);
+                sort->tasks[level][part].completed = COMPLETED;
+            }
+            else if (sort->tasks[level][part].completed != INCOMPLETE)
+                restore_task(sort, level, part);
+        }
+    }
+    sort->ppid = getpid();
+
+    return OK;
+}
+
+
+/**
+ * Escribe en --output los elementos que ya están en su sitio: durante la
+ * última mezcla, los del principio que ha publicado; al terminar, todos. Los
+ * elementos se formatean por bloques de BLOQUE_SALIDA en un buffer, que se
+ * escribe de una vez. Los bloques llenos se envían al disco sin esperar a que
+ * se escriban.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param final  TRUE si el resultado ya está completo.
+ */
+void volcar_salida(Bool final) {
+    char buffer[BLOQUE_SALIDA * MAX_LINE_INT];
+    size_t size;
+    int hasta, n;
+
+    if (escritor == NULL)
+        return;
+
+    hasta = final ? sort->n_elements : __atomic_load_n(&sort->merged, __ATOMIC_ACQUIRE);
+    for (; escritos < hasta; escritos += n) {
+        n = MIN(BLOQUE_SALIDA, hasta - escritos);
+        size = format_lines(buffer, sort->data + escritos, n);
+        fwrite(buffer, 1, size, escritor);
+    }
+}
+
+
+/**
+ * Espera a la siguiente señal y recoge los hijos que hayan terminado.
+ * Mientras se resuelve la última mezcla con
+ * --output, la espera se corta cada PERIODO_SALIDA ns para escribir lo que ya
+ * está mezclado.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void esperar_senal() {
+    struct timespec periodo = {0, PERIODO_SALIDA};
+    int ultimo = sort->n_levels - 1;
+
+    /* La última mezcla puede empezar en cuanto están sus dos mitades */
+    if (escritor == NULL || ultimo < 1 || sort->tasks[ultimo][0].mid == NO_MID || \
+        sort->tasks[ultimo][0].completed == COMPLETED || \
+        sort->tasks[ultimo - 1][0].completed != COMPLETED || \
+        sort->tasks[ultimo - 1][1].completed != COMPLETED) {
+        sigsuspend(&setsuspend);
+        recoger_hijos();
+        return;
+    }
+
+    ppoll(NULL, 0, &periodo, &setsuspend);
+    recoger_hijos();
+    volcar_salida(FALSE);
+}
+
+
+/**
+ * Vuelca a disco la estructura compartida y anota en el diario las tareas de
+ * un nivel completado. El diario solo se escribe después del volcado, por lo
+ * que todo lo anotado está ya en el fichero.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param level Nivel completado.
+ */
+void guardar_nivel(int level) {
+    int part;
+
+    if (checkpoint == NULL)
+        return;
+
+    if (msync(sort, sizeof(*sort), MS_SYNC) == -1) {
+        perror("msync");
+        return;
+    }
+
+    for (part = 0; part < get_number_parts(level, sort->n_levels); part++)
+        fprintf(journal, "%d %d\n", level, part);
+    fflush(journal);
+    fsync(fileno(journal));
+}
+
+
+/**
+ * Vuelca a disco la estructura compartida con los datos ya cargados y lo anota
+ * en el diario, antes de que empiece a resolverse ninguna tarea.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @return  OK si todo ha ido bien, ERROR en caso contrario.
+ */
+Status guardar_carga() {
+    if (msync(sort, sizeof(*sort), MS_SYNC) == -1) {
+        perror("msync");
+        return ERROR;
+    }
+
+    fprintf(journal, "%d %d\n", NIVEL_CARGA, 0);
+    if (fflush(journal) == EOF || fsync(fileno(journal)) == -1) {
+        perror("fsync journal");
+        return ERROR;
+    }
+
+    return OK;
+}
+
+
+/**
+ * Comprueba si todas las tareas de un nivel están completadas.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param level Nivel a comprobar.
+ * @return  TRUE si el nivel está completado, FALSE en caso contrario.
+ */
+Bool nivel_completo(int level) {
+    int part;
+
+    for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+        if (sort->tasks[level][part].completed != COMPLETED)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/**
+ * Calcula cuántos niveles se pueden fusionar en una mezcla según el tamaño de
+ * la caché L2: cada secuencia de la mezcla debe poder tener al menos una
+ * página en la mitad de la caché mientras se adelanta su lectura.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @return  El número de niveles a fusionar.
+ */
+int niveles_cache() {
+    long l2, vias;
+    int niveles = 0;
+
+    l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2 <= 0)
+        l2 = L2_DEFECTO;
+
+    vias = l2 / 2 / sysconf(_SC_PAGESIZE);
+    while (niveles < MAX_FUSE && (2L << niveles) <= vias)
+        niveles++;
+
+    return MAX(1, niveles);
+}
+
+
+/**
+ * Publica el histograma del modo de agregación como pares (elemento, número
+ * de apariciones).
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param n_grupos  Número de grupos del histograma.
+ * @return  OK si se ha publicado correctamente, ERROR en caso contrario.
+ */
+Status publicar_histograma(int n_grupos) {
+    Status estado;
+    int *pares;
+    int k;
+
+    pares = malloc(2 * MAX(1, n_grupos) * sizeof(int));
+    if (pares == NULL) {
+        perror("malloc");
+        return ERROR;
+    }
+    for (k = 0; k < n_grupos; k++) {
+        pares[2 * k] = sort->data[k];
+        pares[2 * k + 1] = sort->counts[k];
+    }
+    estado = result_publish(publicar, RESULT_HISTOGRAM, pares, n_grupos);
+    free(pares);
+
+    return estado;
+}
+
+
+/**
+ * Escribe los pares (elemento, número) del histograma o del join en un
+ * fichero: el número de pares y después un par por línea.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param fichero  Fichero de salida.
+ * @param n_pares  Número de pares.
+ * @return  OK si se ha escrito correctamente, ERROR en caso contrario.
+ */
+Status escribir_pares(char *fichero, int n_pares) {
+    FILE *f;
+    int k;
+
+    if ((f = fopen(fichero, "w")) == NULL) {
+        perror("fopen");
+        return ERROR;
+    }
+    setvbuf(f, NULL, _IOFBF, WRITE_BUFFER);
+
+    fprintf(f, "%d\n", n_pares);
+    for (k = 0; k < n_pares; k++)
+        fprintf(f, "%d %d\n", sort->data[k], sort->counts[k]);
+
+    if (fclose(f) == EOF) {
+        perror("fclose");
+        return ERROR;
+    }
+
+    return OK;
+}
+
+
+/**
+ * Lee las entradas ya ordenadas del modo de mezcla una tras otra en los datos
+ * de la estructura compartida. Si no caben todas, falla.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param lista   Entradas separadas por comas: ficheros o segmentos con el
+ *                prefijo PREFIJO_SHM.
+ * @param bounds  Donde se guarda el comienzo de cada entrada y el final de la
+ *                última (MAX_PARTS + 1 posiciones).
+ * @param n_runs  Donde se guarda el número de entradas.
+ * @return  OK si se han leído correctamente, ERROR en caso contrario.
+ */
+Status cargar_entradas(char *lista, int *bounds, int *n_runs) {
+    Result *entrada;
+    size_t size;
+    char *copia, *nombre, *resto;
+    int n, total = 0;
+    Status estado = OK;
+
+    if ((copia = strdup(lista)) == NULL) {
+        perror("strdup");
+        return ERROR;
+    }
+
+    *n_runs = 0;
+    bounds[0] = 0;
+    for (nombre = strtok_r(copia, SEPARADOR_ENTRADAS, &resto); nombre != NULL && estado == OK; \
+         nombre = strtok_r(NULL, SEPARADOR_ENTRADAS, &resto)) {
+        if (*n_runs == MAX_PARTS) {
+            fprintf(stderr, "At most %d inputs can be merged\n", MAX_PARTS);
+            estado = ERROR;
+        }
+        /* Los resultados publicados se copian sin convertirlos */
+        else if (!strncmp(nombre, PREFIJO_SHM, strlen(PREFIJO_SHM))) {
+            nombre += strlen(PREFIJO_SHM);
+            if ((entrada = result_attach(nombre, &size)) == NULL)
+                estado = ERROR;
+            else {
+                if (entrada->type != RESULT_INT) {
+                    fprintf(stderr, "%s: not a result of integers\n", nombre);
+                    estado = ERROR;
+                }
+                else if (entrada->n_elements > MAX_DATA - total) {
+                    fprintf(stderr, "%s: more than %d elements\n", nombre, MAX_DATA - total);
+                    estado = ERROR;
+                }
+                else {
+                    n = entrada->n_elements;
+                    memcpy(sort->data + total, result_data(entrada), n * sizeof(int));
+                }
+                result_detach(nombre, entrada, size, FALSE);
+            }
+        }
+        else if (read_run(nombre, sort->data + total, MAX_DATA - total, &n) == ERROR)
+            estado = ERROR;
+
+        if (estado == OK) {
+            total += n;
+            bounds[++(*n_runs)] = total;
+        }
+    }
+
+    if (estado == OK && *n_runs == 0) {
+        fprintf(stderr, "No inputs to merge\n");
+        estado = ERROR;
+    }
+
+    free(copia);
+    return estado;
+}
+
+
+/**
+ * Función main. Será la rutina princpal que se ejecutará al comienzo del
+ * programa.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 29-04-2020
+ *
+ * @param argc  Número de argumentos de entrada del programa.
+ * @param argv  Puntero a los string de los correspondientes argumentos de
+ *              entrada.
+ * @return  EXIT_SUCCESS si el programa ha finalizado correctamente.
+ *          EXIT_FAILURE en caso contrario.
+ */
+int main(int argc, char **argv) {
+
+    /* Variables locales */
+    struct mq_attr attributes = {
+        .mq_flags = 0,
+        .mq_maxmsg = MAX_MENSAJES,
+        .mq_curmsgs = 0,
+        .mq_msgsize = sizeof(Message)
+    };
+    struct sigaction act;
+    pthread_mutexattr_t atributos_cerrojo;
+    sigset_t set;
+    struct option opciones[] = {
+        {"stream", no_argument, NULL, 's'},
+        {"top-k", required_argument, NULL, 'k'},
+        {"select", required_argument, NULL, 'n'},
+        {"natural", no_argument, NULL, 'r'},
+        {"checkpoint", required_argument, NULL, 'c'},
+        {"resume", no_argument, NULL, 'R'},
+        {"publish", required_argument, NULL, 'p'},
+        {"group", no_argument, NULL, 'g'},
+        {"fuse", required_argument, NULL, 'f'},
+        {"metrics", required_argument, NULL, 'M'},
+        {"argsort", no_argument, NULL, 'a'},
+        {"text", no_argument, NULL, 't'},
+        {"key", required_argument, NULL, 'K'},
+        {"delimiter", required_argument, NULL, 'd'},
+        {"numeric", no_argument, NULL, 'N'},
+        {"output", required_argument, NULL, 'o'},
+        {"merge", no_argument, NULL, 'm'},
+        {"union", required_argument, NULL, 'U'},
+        {"intersect", required_argument, NULL, 'I'},
+        {"except", required_argument, NULL, 'E'},
+        {"join", required_argument, NULL, 'J'},
+        {"speculate", no_argument, NULL, 'B'},
+        {"compress", no_argument, NULL, 'z'},
+        {"verify", no_argument, NULL, 'V'},
+        {NULL, 0, NULL, 0}
+    };
+    int n_levels, delay;
+    int fd_shm, opt;
+    int stream = 0;
+    int top_k = 0;
+    int posicion = -1;
+    int natural = 0;
+    int resume = 0;
+    int agrupar = 0;
+    int fusionar = 0;
+    int argsort = 0;
+    int lineas = 0;
+    int campo = 0;
+    char delimitador = '\0';
+    Bool numerico = FALSE;
+    char *salida = NULL;
+    FILE *fichero_salida;
+    int mezclar = 0;
+    int comprimir = 0;
+    int verificar = 0;
+    Status verificacion = OK;
+    Status publicado = OK;
+    SetOperation operacion = SET_NONE;
+    char *segunda = NULL;
+    char *entradas;
+    int bounds[MAX_PARTS + 1];
+    int n_runs, n_publicados;
+    int primero;
+    int n_grupos = 0;
+    Status estado;
+    char *file_name;
+    pid_t pid;
+
+    /* Comprobamos los arguentos de entrada e inicializamos algunos valores */
+    while ((opt = getopt_long(argc, argv, "sk:n:rc:Rp:gf:M:atK:d:No:mU:I:E:J:BzV", opciones, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                stream = 1;
+                break;
+            case 'k':
+                top_k = atoi(optarg);
+                if (top_k <= 0) {
+                    uso(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'n':
+                posicion = atoi(optarg);
+                if (posicion < 0) {
+                    uso(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'r':
+                natural = 1;
+                break;
+            case 'c':
+                checkpoint = optarg;
+                break;
+            case 'R':
+                resume = 1;
+                break;
+            case 'p':
+                publicar = optarg;
+                if (publicar[0] != '/') {
+                    fprintf(stderr, "--publish: NAME must start with '/'\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'g':
+                agrupar = 1;
+                break;
+            case 'M':
+                fichero_metricas = optarg;
+                break;
+            case 'a':
+                argsort = 1;
+                break;
+            case 't':
+                lineas = 1;
+                break;
+            case 'K':
+                campo = atoi(optarg);
+                if (campo < 0) {
+                    uso(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'd':
+                if (strlen(optarg) != 1 || optarg[0] == '\n') {
+                    uso(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                delimitador = optarg[0];
+                break;
+            case 'N':
+                numerico = TRUE;
+                break;
+            case 'o':
+                salida = optarg;
+                break;
+            case 'm':
+                mezclar = 1;
+                break;
+            case 'U':
+            case 'I':
+            case 'E':
+            case 'J':
+                if (operacion != SET_NONE) {
+                    uso(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                operacion = (opt == 'U') ? SET_UNION : (opt == 'I') ? SET_INTERSECT : \
+                            (opt == 'E') ? SET_EXCEPT : SET_JOIN;
+                segunda = optarg;
+                break;
+            case 'B':
+                especular = TRUE;
+                break;
+            case 'z':
+                comprimir = 1;
+                break;
+            case 'V':
+                verificar = 1;
+                break;
+            case 'f':
+                fusionar = atoi(optarg);
+                if (fusionar < 0 || fusionar > MAX_FUSE) {
+                    uso(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                if (fusionar == 0)
+                    fusionar = niveles_cache();
+                break;
+            default:
+                uso(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    /* Al continuar solo se indican el número de procesos y el retardo */
+    if ((!resume && argc - optind < 3) || (resume && (checkpoint == NULL || argc - optind > 2))) {
+        uso(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    /* El problema y la forma de resolverlo están en el punto de control */
+    if (resume && (stream || top_k > 0 || posicion >= 0 || natural || agrupar || fusionar || \
+                   argsort || lineas || mezclar || comprimir || operacion != SET_NONE)) {
+        fprintf(stderr, "--resume can only be used with --checkpoint, --verify, --output, --publish, --metrics and --speculate\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Las consultas solo conservan los menores elementos de cada parte, que
+       no son sus grupos */
+    if (agrupar && (top_k > 0 || posicion >= 0)) {
+        fprintf(stderr, "--group can not be used with --top-k or --select\n");
+        exit(EXIT_FAILURE);
+    }
+    if (fusionar > 1 && (agrupar || top_k > 0 || posicion >= 0)) {
+        fprintf(stderr, "--fuse can not be used with --group, --top-k or --select\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Quickselect no conserva el orden de los iguales, los grupos no tienen
+       una posición y las secuencias descendentes se invierten sin ella */
+    if (argsort && (agrupar || top_k > 0 || posicion >= 0 || natural)) {
+        fprintf(stderr, "--argsort can not be used with --group, --top-k, --select or --natural\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Las líneas se leen de la proyección del fichero, que no se guarda en el
+       punto de control */
+    if (lineas && (agrupar || top_k > 0 || posicion >= 0 || natural || argsort || \
+                   stream || checkpoint != NULL)) {
+        fprintf(stderr, "--text can not be used with --group, --top-k, --select, --natural, --argsort, --stream or --checkpoint\n");
+        exit(EXIT_FAILURE);
+    }
+    /* La salida estándar es del ilustrador */
+    if (lineas && salida == NULL) {
+        fprintf(stderr, "--text needs --output\n");
+        exit(EXIT_FAILURE);
+    }
+    if (lineas && !numerico && fusionar > 1) {
+        fprintf(stderr, "--fuse can only be used with --numeric in --text mode\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!lineas && (campo > 0 || delimitador != '\0' || numerico)) {
+        fprintf(stderr, "--key, --delimiter and --numeric need --text\n");
         exit(EXIT_FAILURE);
     }
 
-    /* Creamos la cola de mensajes */
-    queue = mq_open(MQ_NAME, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR, &attributes);
-    if (queue == (mqd_t)-1) {
-        perror("mq_open");
+    /* Las entradas ya están ordenadas, por lo que no hay bloques que agrupar,
+       leer mientras se ordenan ni secuencias que buscar */
+    if (mezclar && (agrupar || argsort || lineas || stream || natural)) {
+        fprintf(stderr, "--merge can not be used with --group, --argsort, --text, --stream or --natural\n");
+        exit(EXIT_FAILURE);
+    }
+    if (operacion != SET_NONE && (mezclar || agrupar || argsort || lineas || stream || \
+                                  natural || top_k > 0 || posicion >= 0 || fusionar > 1)) {
+        fprintf(stderr, "--union, --intersect, --except and --join can not be used with other modes\n");
+        exit(EXIT_FAILURE);
+    }
+    /* Solo se escribe el vector ordenado completo */
+    if (salida != NULL && (agrupar || top_k > 0 || posicion >= 0 || argsort)) {
+        fprintf(stderr, "--output can not be used with --group, --top-k, --select or --argsort\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Solo se comprimen las secuencias de enteros de las mezclas normales */
+    if (comprimir && (agrupar || top_k > 0 || posicion >= 0 || natural || argsort || \
+                      lineas || fusionar > 1 || operacion != SET_NONE)) {
+        fprintf(stderr, "--compress can not be used with --group, --top-k, --select, --natural, --argsort, --text, --fuse or set operations\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Las consultas y las operaciones de conjuntos no dan una permutación de
+       la entrada */
+    if (verificar && (top_k > 0 || posicion >= 0 || operacion != SET_NONE)) {
+        fprintf(stderr, "--verify can not be used with --top-k, --select or set operations\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Las copias de respaldo solo pueden escribir el rango de su tarea */
+    if (especular && (agrupar || operacion != SET_NONE)) {
+        fprintf(stderr, "--speculate can not be used with --group or set operations\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Los datos de un stream no pueden volver a leerse al continuar */
+    if (checkpoint != NULL && stream) {
+        fprintf(stderr, "--checkpoint can not be used with --stream\n");
+        exit(EXIT_FAILURE);
+    }
+    argc -= optind - 1;
+    argv += optind - 1;
+
+    /* Al continuar, el fichero y los niveles son los del punto de control y
+       el retardo también, salvo que se indique otro */
+    if (resume) {
+        file_name = checkpoint;
+        n_levels = 0;
+        primero = 1;
+    }
+    else {
+        file_name = argv[1];
+        n_levels = atoi(argv[2]);
+        primero = 3;
+    }
+    if (n_levels > 10)
+        n_levels = 10;
+
+    /* Las dos entradas de una operación se leen como una lista separada por
+       comas */
+    if (operacion != SET_NONE && (strstr(file_name, SEPARADOR_ENTRADAS) != NULL || \
+                                  strstr(segunda, SEPARADOR_ENTRADAS) != NULL)) {
+        fprintf(stderr, "The inputs of a set operation can not contain '%s'\n", SEPARADOR_ENTRADAS);
+        exit(EXIT_FAILURE);
+    }
+    n_processes = (argc > primero) ? atoi(argv[primero]) : 0;
+    if (n_processes <= 0)
+        n_processes = cpus_disponibles();
+    if (n_processes > 512)
+        n_processes = 512;
+    if (argc > primero + 1) {
+        delay = 1e6 * atoi(argv[primero + 1]);
+    }
+    else {
+        delay = resume ? -1 : 1e8;
+    }
+
+    cpid = malloc((n_processes+1)*sizeof(pid_t));
+    if (cpid == NULL) {
+        perror("malloc");
         freeAll();
         exit(EXIT_FAILURE);
     }
 
-    /* Creamos los procesos trabajadores y el ilustrador */
-    ppid = getpid();
+    message.n_level = -1;
+    message.n_part = -1;
 
-    for (i = 0; i < n_processes+1; i++) {
-        if ((pid = fork()) == -1) {
-            perror("fork");
+    /* Creamos las tuberías */
+    for (i = 0; i < n_processes; i++) {
+        if (pipe(fd1[i]) == -1) {
+            perror("pipe");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+        if (pipe(fd2[i]) == -1) {
+            perror("pipe");
             freeAll();
             exit(EXIT_FAILURE);
         }
-        if (!pid)
-            break;
-        cpid[i] = pid;
     }
 
-    /* Código del trabajador */
-    if(i < n_processes && !pid) {
+    /* Creamos las máscaras necesarias y los manejadores */
+    sigemptyset(&(act.sa_mask));
+    act.sa_flags = 0;
+    act.sa_handler = manejador_SIGTERM;
+    if (sigaction(SIGTERM, &act, NULL) < 0) {
+        perror("sigaction");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+    act.sa_handler = manejador_SIGUSR1;
+    if (sigaction(SIGUSR1, &act, NULL) < 0) {
+        perror("sigaction");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+    act.sa_handler = manejador_SIGALRM;
+    if (sigaction(SIGALRM, &act, NULL) < 0) {
+        perror("sigaction");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
 
-        /* Ignoramos la señal SIGINT, cerramos los descriptores de fichero de
-           las tuberías que no vayamos a utilizar y establecemos la primera
-           alarma */
-        act.sa_handler = SIG_IGN;
-        if (sigaction(SIGINT, &act, NULL) < 0) {
-            perror("sigaction");
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    sigaddset(&set, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &set, NULL) == -1) {
+        perror("sigprocmask");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    sigfillset(&setsuspend);
+    sigdelset(&setsuspend, SIGUSR1);
+    sigdelset(&setsuspend, SIGCHLD);
+
+    /* Creamos el cerrojo en memoria compartida con los hijos. Es robusto,
+       de modo que un trabajador que muere con él no bloquea a los demás */
+    cerrojo = mmap(NULL, sizeof(*cerrojo), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (cerrojo == MAP_FAILED) {
+        cerrojo = NULL;
+        perror("mmap");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutexattr_init(&atributos_cerrojo);
+    pthread_mutexattr_setpshared(&atributos_cerrojo, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&atributos_cerrojo, PTHREAD_MUTEX_ROBUST);
+    if (pthread_mutex_init(cerrojo, &atributos_cerrojo) != 0) {
+        fprintf(stderr, "pthread_mutex_init failed\n");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutexattr_destroy(&atributos_cerrojo);
+
+    /* Inicializamos la memoria compartida, o el fichero de punto de control */
+    if (checkpoint != NULL) {
+        if (abrir_checkpoint(resume) == ERROR) {
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+    }
+    /* Al publicar, se ordena directamente en el segmento del resultado. El
+       histograma se publica como pares, por lo que se copia */
+    else if (publicar != NULL && !agrupar && operacion != SET_JOIN) {
+        if ((resultado = result_create(publicar, sizeof(Sort))) == NULL) {
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+        sort = result_payload(resultado);
+    }
+    else {
+        fd_shm = shm_open(SHM_NAME, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+        if (fd_shm == -1) {
+            perror("shm_open");
             freeAll();
             exit(EXIT_FAILURE);
         }
 
-        close(fd1[i][READ]);
-        close(fd2[i][WRITE]);
+        if (ftruncate(fd_shm, sizeof(Sort)) == -1) {
+            perror("ftruncate");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
 
-        alarm(1);
+        sort = mmap(NULL, sizeof(*sort), PROT_READ | PROT_WRITE, MAP_SHARED, fd_shm, 0);
 
-        /* El bucle se ejecutará hasta la llegada de la señal SIGTERM */
-        while(1) {
+        if (sort == MAP_FAILED) {
+            perror("map failed");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+    }
 
-            /* Leemos el mensaje de la cola asegurándonos de volver a hacerlo
-               si se recibe alguna interrupción de señal */
-            while (mq_receive(queue, (char*)&message, sizeof(message), NULL) == -1) {
-                if (errno != EINTR) {
-                    perror("mq_receive");
-                    freeAll();
-                    exit(EXIT_FAILURE);
-                }
-            }
+    /* En modo stream solo se lee la cabecera; los datos los leerá el padre
+       mientras los trabajadores ordenan. Al continuar, el problema ya está en
+       el punto de control */
+    if (resume) {
+        printf("Resuming %s: %d elements, %d levels\n", checkpoint, sort->n_elements, sort->n_levels);
+        sort->n_processes = n_processes;
+        if (delay >= 0)
+            sort->delay = delay;
+    }
+    else if (stream) {
+        if (!strcmp(file_name, "-"))
+            input = stdin;
+        else if ((input = aio_fopen(file_name, "r")) == NULL) {
+            perror("aio_fopen");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+        if (init_sort_stream(input, sort, n_levels, n_processes, delay) == ERROR) {
+            perror("init_sort_stream");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+    }
+    /* Las dos entradas de una operación se leen una tras otra y después se
+       reparten entre las partes del nivel 0 */
+    else if (operacion != SET_NONE) {
+        entradas = malloc(strlen(file_name) + strlen(segunda) + 2);
+        if (entradas == NULL) {
+            perror("malloc");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+        sprintf(entradas, "%s%s%s", file_name, SEPARADOR_ENTRADAS, segunda);
+        estado = cargar_entradas(entradas, bounds, &n_runs);
+        free(entradas);
+        if (estado == ERROR || n_runs != 2 || \
+            init_set_operation(sort, bounds[1], bounds[2] - bounds[1], operacion, n_levels, n_processes, delay) == ERROR) {
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+    }
+    /* En modo de mezcla las entradas son las partes del nivel 0 */
+    else if (mezclar) {
+        if (cargar_entradas(file_name, bounds, &n_runs) == ERROR || \
+            init_sort_runs(sort, bounds, n_runs, n_processes, delay) == ERROR) {
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+    }
+    /* En modo texto se ordenan los prefijos de las claves de las líneas, con
+       su número de línea */
+    else if (lineas) {
+        if (text_open(&texto, file_name, campo, delimitador, numerico, cpus_disponibles()) == ERROR || \
+            init_sort_data(texto.keys, texto.n_lines, sort, n_levels, n_processes, delay) == ERROR) {
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+        if (texto.n_lines > sort->n_elements) {
+            fprintf(stderr, "%s: more than %d lines\n", file_name, MAX_DATA);
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+        if (numerico)
+            init_stable(sort);
+        else if (init_strings(sort, text_key, &texto) == ERROR) {
+            perror("init_strings");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+    }
+    /* En los demás modos el fichero se lee entero, con los bloques siguientes
+       ya pedidos mientras se convierte cada uno */
+    else {
+        if ((input = aio_fopen(file_name, "r")) == NULL) {
+            perror("aio_fopen");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+        if (init_sort_stream(input, sort, n_levels, n_processes, delay) == ERROR || \
+            read_sort_data(input, sort, 0, sort->n_elements) == ERROR) {
+            perror("init_sort");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+        fclose(input);
+        input = NULL;
+    }
+
+    /* El elemento N-ésimo es el último de los N+1 menores */
+    if (posicion >= sort->n_elements) {
+        fprintf(stderr, "select: %d out of range (%d elements)\n", posicion, sort->n_elements);
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+    if (posicion >= 0)
+        top_k = posicion + 1;
+    if (resume)
+        top_k = sort->top_k;
+    if (top_k > 0)
+        sort->top_k = MIN(top_k, sort->n_elements);
+    if (agrupar)
+        sort->aggregate = TRUE;
+    if (fusionar > 1)
+        sort->fuse = fusionar;
+    if (argsort)
+        init_stable(sort);
+    if (comprimir)
+        sort->compress = TRUE;
+
+    /* El hash de la entrada se calcula al cargarla; en modo stream, según se
+       lee cada bloque. Al continuar se verifica si se verificaba al empezar */
+    if (resume && verificar && !sort->verify) {
+        fprintf(stderr, "%s was not started with --verify\n", checkpoint);
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+    if (resume)
+        verificar = sort->verify;
+    else if (verificar && !stream)
+        checksum_input(sort, 0, sort->n_elements);
+
+    /* Las secuencias solo pueden detectarse con todos los datos leídos; en
+       modo stream cada bloque mezcla las suyas */
+    if (natural && stream) {
+        sort->natural = TRUE;
+    }
+    else if (natural && init_natural_runs(sort, &n_runs) == ERROR) {
+        perror("init_natural_runs");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
 
-            /* Marcamos la parte como PROCESSING asegurando la exclusión mutua */
-            while(sem_wait(sem) == -1 && errno == EINTR);
-            sort->tasks[message.n_level][message.n_part].completed = PROCESSING;
-            sem_post(sem);
+    /* Las tareas se envían según lo que retrasan el final del algoritmo */
+    init_priorities(sort);
+
+    /* Los datos cargados llegan al disco antes que el estado de las tareas */
+    if (checkpoint != NULL && !resume) {
+        sort->durable = TRUE;
+        if (guardar_carga() == ERROR) {
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+    }
 
-            /* Resolvemos la parte asignada */
-            solve_task(sort, message.n_level, message.n_part);
+    /* Al principio solo hace falta un trabajador; el resto se despierta al
+       enviar las tareas */
+    sort->active = 1;
+    contar_tareas();
 
-            /* Marcamos la parte como COMPLETED asegurando la exclusión mutua */
-            while(sem_wait(sem) == -1 && errno == EINTR);
-            sort->tasks[message.n_level][message.n_part].completed = COMPLETED;
-            sem_post(sem);
+    /* Sin contadores la ordenación sigue adelante */
+    metricas = metrics_create(sort);
 
-            /* Avisamos al padre de que debe revisar si se han completado las
-               tareas del nivel */
-            if (kill(ppid, SIGUSR1) == -1) {
-                perror("kill");
-                freeAll();
-                exit(EXIT_FAILURE);
-            }
+    /* Creamos la cola de mensajes. Los trabajadores esperan con poll y
+       reciben sin bloquearse, con el cerrojo cogido */
+    queue = mq_open(MQ_NAME, O_CREAT | O_RDWR | O_NONBLOCK, S_IRUSR | S_IWUSR, &attributes);
+    if (queue == (mqd_t)-1) {
+        perror("mq_open");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    queue_envio = mq_open(MQ_NAME, O_WRONLY | O_NONBLOCK);
+    if (queue_envio == (mqd_t)-1) {
+        perror("mq_open");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    /* Creamos los procesos trabajadores y el ilustrador */
+    for (i = 0; i < n_processes+1; i++) {
+        if ((pid = fork()) == -1) {
+            perror("fork");
+            freeAll();
+            exit(EXIT_FAILURE);
         }
+        if (!pid)
+            break;
+        cpid[i] = pid;
+    }
+
+    /* Código del trabajador */
+    if(i < n_processes && !pid) {
+        trabajador();
     }
 
     /* Código del ilustrador */
     else if (!pid) {
+        ilustrador(FALSE);
+    }
 
-        /* Ignoramos la señal SIGINT, cerramos los descriptores de fichero de
-           las tuberías que no vayamos a utilizar y pintamos el vector inicial */
-        act.sa_handler = SIG_IGN;
+    /* Código del padre */
+    else {
+        /* Establecemos los manejadores de las señales SIGINT y SIGCHLD */
+        act.sa_handler = manejador_SIGINT;
         if (sigaction(SIGINT, &act, NULL) < 0) {
             perror("sigaction");
             freeAll();
             exit(EXIT_FAILURE);
         }
-
-        for (i = 0; i < n_processes; i++) {
-            close(fd1[i][WRITE]);
-            close(fd2[i][READ]);
+        act.sa_handler = manejador_SIGCHLD;
+        if (sigaction(SIGCHLD, &act, NULL) < 0) {
+            perror("sigaction");
+            freeAll();
+            exit(EXIT_FAILURE);
         }
 
-        plot_vector(sort->data, sort->n_elements);
-        printf("\nStarting algorithm with %d levels and %d processes...\n", sort->n_levels, sort->n_processes);
-
-        /* El bucle se ejecutará hasta la llegada de la señal SIGTERM */
-        while(1) {
-            sprintf(ilustracion, "\n     %-10s%-10s     %-10s%-10s%-10s%-10s\n\n",
-                    "PID", "STATUS", "LEVEL", "PART", "INI", "END");
-
-            /* Leemos todos los estados de los trabajadores preparando la impresión */
-            for(i = 0; i < n_processes; i++) {
-                if (read(fd1[i][READ], &pipemsg, sizeof(pipemsg)) == -1) {
-                    perror("read");
-                    freeAll();
-                    exit(EXIT_FAILURE);
-                }
-                if (pipemsg.completed == PROCESSING)
-                    sprintf(ilustracion + strlen(ilustracion), "     %-10ld%-10s     %-10d%-10d%-10d%-10d\n",
-                            (long)pipemsg.pid, "PROCESSING", pipemsg.n_level, pipemsg.n_part,
-                            sort->tasks[pipemsg.n_level][pipemsg.n_part].ini, sort->tasks[pipemsg.n_level][pipemsg.n_part].end);
-                else {
-                    if (pipemsg.completed == INCOMPLETE)
-                        strncpy(buffer, "INCOMPLETE", sizeof("INCOMPLETE"));
-                    else if (pipemsg.completed == COMPLETED)
-                        strncpy(buffer, "COMPLETED", sizeof("COMPLETED"));
-                    else if (pipemsg.completed == SENT)
-                        strncpy(buffer, "SENT", sizeof("SENT"));
-                    sprintf(ilustracion + strlen(ilustracion), "     %-10ld%-10s     %-10s%-10s%-10s%-10s\n",
-                            (long)pipemsg.pid, buffer, "-", "-", "-", "-");
-                }
+        /* Con la ejecución especulativa la alarma del padre le despierta
+           como las demás señales, solo durante sigsuspend */
+        if (especular) {
+            sigemptyset(&set);
+            sigaddset(&set, SIGALRM);
+            if (sigprocmask(SIG_BLOCK, &set, NULL) == -1) {
+                perror("sigprocmask");
+                abortar();
             }
+            sigdelset(&setsuspend, SIGALRM);
+        }
 
-            /* Imprimimos el vector por pantalla junto con el estado de todos los
-               trabajadores */
-            plot_vector(sort->data, sort->n_elements);
-            fprintf(stdout, "%s", ilustracion);
-            fflush(stdout);
-
-            /* Avisamos a todos los trabajadores de que pueden continuar con su
-               ejecución */
-            for(i = 0; i < n_processes; i++) {
-                strncpy(buffer, "Continue", sizeof("Continue"));
-                if (write(fd2[i][WRITE], buffer, strlen(buffer) + 1) == -1) {
-                    perror("write2");
-                    freeAll();
-                    exit(EXIT_FAILURE);
-                }
+        /* Con --output el vector se escribe según avanza la última mezcla */
+        if (salida != NULL && operacion == SET_NONE && !lineas) {
+            if ((escritor = aio_fopen(salida, "w")) == NULL) {
+                perror("aio_fopen");
+                abortar();
             }
+            sort->merged = 0;
+            fprintf(escritor, "%d\n", sort->n_elements);
         }
-    }
 
-    /* Código del padre */
-    else {
-        /* Establecemos el manejador de la señal SIGINT */
-        act.sa_handler = manejador_SIGINT;
-        if (sigaction(SIGINT, &act, NULL) < 0) {
-            perror("sigaction");
-            freeAll();
-            exit(EXIT_FAILURE);
+        /* En modo stream cada bloque se envía en cuanto se ha leído, junto
+           con las mezclas que hayan quedado listas mientras tanto */
+        if (stream) {
+            i = sort->n_levels - 1;
+            flag = 0;
+            for (j = 0; sort->n_levels > 0 && j < get_number_parts(0, sort->n_levels); j++) {
+                if (read_sort_data(input, sort, sort->tasks[0][j].ini, \
+                                   sort->tasks[0][j].end) == ERROR)
+                    abortar();
+                if (verificar)
+                    checksum_input(sort, sort->tasks[0][j].ini, sort->tasks[0][j].end);
+                n_leidos = j + 1;
+                enviar_listas();
+            }
+            if (sort->n_levels == 0 && \
+                read_sort_data(input, sort, 0, sort->n_elements) == ERROR)
+                abortar();
+            if (sort->n_levels == 0 && verificar)
+                checksum_input(sort, 0, sort->n_elements);
+            if (input != stdin)
+                fclose(input);
+            input = NULL;
+
+            /* Esperamos a las mezclas restantes, enviándolas según queden
+               listas, hasta que se complete la tarea del último nivel */
+            while (sort->n_levels > 0) {
+                enviar_listas();
+                if (flag == 1)
+                    break;
+                esperar_senal();
+                volcar_metricas(FALSE);
+                if (especular)
+                    vigilar_rezagadas();
+            }
         }
 
+        /* Fuera del modo stream todos los bloques están leídos desde el
+           principio, por lo que todas las hojas pueden ir en un lote. Sin
+           niveles no hay hojas */
+        if (!stream && sort->n_levels > 0)
+            n_leidos = get_number_parts(0, sort->n_levels);
+
         /* Anidación de bucles que recorrerá cada nivel y, dentro del mismo,
            cada parte */
-        for (i = 0; i < sort->n_levels; i++) {
-            for (j = 0; j < get_number_parts(i, sort->n_levels); j++) {
-
-                /* Marcamos una tarea como enviada asegurando la exclusión mutua
-                   y la enviamos a través de la cola de mensajes */
-                message.n_level = i;
-                message.n_part = j;
-                sem_wait(sem);
-                sort->tasks[i][j].completed = SENT;
-                sem_post(sem);
-
-                if (mq_send(queue, (char*)&message, sizeof(message), 1) == -1) {
-                    perror("mq_send");
-                    freeAll();
-                    exit(EXIT_FAILURE);
-                }
-            }
+        for (i = 0; !stream && i < sort->n_levels; i++) {
+            /* Al continuar, los niveles ya completados se saltan y de los
+               demás solo se envían las tareas pendientes */
+            if (nivel_completo(i))
+                continue;
+
+            flag = 0;
+            enviar_nivel(i);
 
             /* Suspendemos el programa a la espera de la señal SIGUSR1 tras la cual
-               comprobomas que todas las tareas de un nivel hayan sido completadas*/
-            do {
-                sigsuspend(&setsuspend);
-            } while(flag != 1);
+               comprobomas que todas las tareas de un nivel hayan sido completadas,
+               reenviando las de los trabajadores que hayan muerto */
+            while (flag != 1) {
+                if (reenviar)
+                    reenviar_nivel(i);
+                esperar_senal();
+                volcar_metricas(FALSE);
+                if (especular)
+                    vigilar_rezagadas();
+            }
+
+            guardar_nivel(i);
         }
 
-        /* Imprimimos el vector ordenado y finalizamos */
-        plot_vector(sort->data, sort->n_elements);
+        /* Verificamos el resultado en los trabajadores antes de entregarlo */
+        if (verificar)
+            verificacion = verificar_resultado();
+
+        /* Imprimimos el vector ordenado, o el resultado de la consulta, y
+           finalizamos */
+        if (posicion >= 0) {
+            plot_vector(sort->data, sort->top_k);
+            printf("\nElement %d: %d\n", posicion, sort->data[posicion]);
+        }
+        else if (sort->top_k > 0) {
+            plot_vector(sort->data, sort->top_k);
+            printf("\nTop %d elements\n", sort->top_k);
+        }
+        else if (sort->aggregate || sort->operation == SET_JOIN) {
+            n_grupos = get_number_groups(sort);
+            printf("\n%10s%10s\n", "ELEMENT", (sort->operation == SET_JOIN) ? "PAIRS" : "COUNT");
+            for (j = 0; j < n_grupos; j++)
+                printf("%10d%10d\n", sort->data[j], sort->counts[j]);
+            printf("\n%d %s\n", n_grupos, (sort->operation == SET_JOIN) ? "matching elements" : "distinct elements");
+            if (salida != NULL && verificacion == OK && escribir_pares(salida, n_grupos) == ERROR)
+                fprintf(stderr, "Error writing %s\n", salida);
+        }
+        else if (sort->operation != SET_NONE) {
+            n_grupos = get_number_groups(sort);
+            plot_vector(sort->data, n_grupos);
+            printf("\n%d elements\n", n_grupos);
+            if (salida != NULL && write_vector(salida, sort->data, n_grupos) == ERROR)
+                fprintf(stderr, "Error writing %s\n", salida);
+        }
+        else if (lineas) {
+            /* Los trabajadores solo verifican los prefijos de las claves: las
+               líneas se comprueban por su clave completa antes de escribirlas */
+            if (!sort->strings && text_refine(&texto, sort->data, sort->index, sort->n_elements, \
+                                              cpus_disponibles()) == ERROR)
+                fprintf(stderr, "Error sorting the lines\n");
+            else if (verificar && verificacion == OK)
+                verificacion = text_check(&texto, sort->index, sort->n_elements);
+
+            if (verificacion == ERROR)
+                fprintf(stderr, "%s is not written\n", salida);
+            else if ((fichero_salida = fopen(salida, "w")) == NULL)
+                perror("fopen");
+            else {
+                if (text_write(&texto, sort->index, sort->n_elements, fichero_salida) == ERROR)
+                    fprintf(stderr, "Error writing the sorted lines\n");
+                fclose(fichero_salida);
+            }
+        }
+        else {
+            plot_vector(sort->data, sort->n_elements);
+        }
+        /* Lo que ya se ha escrito durante la última mezcla se elimina si el
+           resultado no supera la verificación */
+        if (escritor != NULL) {
+            if (verificacion == OK)
+                volcar_salida(TRUE);
+            estado = ferror(escritor) ? ERROR : OK;
+            if (fclose(escritor) == EOF)
+                estado = ERROR;
+            escritor = NULL;
+            if (verificacion == ERROR) {
+                unlink(salida);
+                fprintf(stderr, "%s is removed\n", salida);
+            }
+            else if (estado == ERROR)
+                fprintf(stderr, "Error writing %s\n", salida);
+        }
+        if (sort->stable && !lineas) {
+            printf("\nPositions:\n");
+            print_vector(sort->index, sort->n_elements);
+        }
         printf("\nAlgorithm completed\n");
 
+        if (metricas != NULL) {
+            metricas->end_ns = metrics_now();
+            metricas->finished = TRUE;
+            volcar_metricas(TRUE);
+        }
+
+        terminando = 1;
         for (i = 0; i < n_processes+1; i++) {
             if (kill(cpid[i], SIGTERM) == -1) {
                 perror("kill");
@@ -568,8 +2993,50 @@ int main(int argc, char **argv) {
         for (i = 0; i < n_processes+1; i++) {
             wait(NULL);
         }
+
+        /* El resultado se entrega sin copiarlo, salvo desde el punto de
+           control, que no está en memoria compartida. Se publica con los
+           hijos ya terminados, porque al sellarlo el segmento se recorta */
+        if (publicar != NULL && verificacion == ERROR) {
+            fprintf(stderr, "The result is not published in %s\n", publicar);
+        }
+        else if (publicar != NULL && (sort->aggregate || sort->operation == SET_JOIN)) {
+            estado = publicar_histograma(n_grupos);
+            if (estado == OK)
+                printf("Result published in %s\n", publicar);
+            else
+                publicado = ERROR;
+        }
+        else if (publicar != NULL && sort->stable) {
+            if (resultado != NULL)
+                estado = result_seal(publicar, resultado, RESULT_PERMUTATION, sort->index, sort->n_elements);
+            else
+                estado = result_publish(publicar, RESULT_PERMUTATION, sort->index, sort->n_elements);
+            if (estado == OK)
+                printf("Result published in %s\n", publicar);
+            else
+                publicado = ERROR;
+        }
+        else if (publicar != NULL) {
+            n_publicados = (sort->top_k > 0) ? sort->top_k : \
+                           (sort->operation != SET_NONE) ? n_grupos : sort->n_elements;
+            if (resultado != NULL)
+                estado = result_seal(publicar, resultado, RESULT_INT, sort->data, n_publicados);
+            else
+                estado = result_publish(publicar, RESULT_INT, sort->data, n_publicados);
+            if (estado == OK)
+                printf("Result published in %s\n", publicar);
+            else
+                publicado = ERROR;
+        }
+
+        /* Terminada la ordenación el punto de control ya no es necesario */
+        if (checkpoint != NULL) {
+            unlink(checkpoint);
+            unlink(journal_name);
+        }
     }
 
     freeAll();
-    exit(EXIT_SUCCESS);
+    exit((verificacion == OK && publicado == OK) ? EXIT_SUCCESS : EXIT_FAILURE);
 }
@@ -0,0 +1,349 @@
+/**
+ * @file metrics.c
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Implementación de los contadores de progreso. Las magnitudes derivadas
+ * (claves por segundo, fracción ocupada de cada trabajador y tiempo restante)
+ * se calculan al leerlos, a partir del trabajo hecho y del tiempo transcurrido.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "metrics.h"
+
+
+/* Magnitudes derivadas de los contadores en un instante */
+typedef struct {
+    double elapsed;
+    double keys_per_second;
+    double progress;
+    double eta;
+} Derived;
+
+
+long metrics_now() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+void metrics_name(pid_t ppid, char *name, size_t size) {
+    snprintf(name, size, "%s_%d", METRICS_SHM_NAME, (int)ppid);
+}
+
+/**
+ * Recorre los segmentos de contadores, que en Linux aparecen en /dev/shm, y
+ * devuelve el último trabajo en curso que encuentra. Los segmentos de trabajos
+ * que ya no existen (porque terminaron sin eliminarlos) se ignoran o, si se
+ * pide, se eliminan.
+ *
+ * @param n_found   Donde se guarda el número de trabajos en curso.
+ * @param clean     TRUE para eliminar los segmentos de trabajos terminados.
+ * @return  El pid del proceso principal del trabajo, 0 si no hay ninguno.
+ */
+static pid_t scan_jobs(int *n_found, Bool clean) {
+    DIR *dir = NULL;
+    struct dirent *entry;
+    char *end;
+    char name[METRICS_MAX_NAME];
+    size_t length = strlen(METRICS_SHM_NAME) - 1;
+    long pid;
+    pid_t found = 0;
+
+    *n_found = 0;
+    if (!(dir = opendir("/dev/shm"))) {
+        return 0;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, METRICS_SHM_NAME + 1, length) || entry->d_name[length] != '_') {
+            continue;
+        }
+        pid = strtol(entry->d_name + length + 1, &end, 10);
+        if ((*end != '\0') || (pid <= 0)) {
+            continue;
+        }
+        if ((kill(pid, 0) == -1) && (errno != EPERM)) {
+            if (clean) {
+                metrics_name(pid, name, sizeof(name));
+                shm_unlink(name);
+            }
+            continue;
+        }
+        found = pid;
+        (*n_found)++;
+    }
+    closedir(dir);
+
+    return found;
+}
+
+Metrics *metrics_create(Sort *sort) {
+    Metrics *metrics = NULL;
+    char name[METRICS_MAX_NAME];
+    int fd, level, part, n_jobs;
+
+    if (!(sort)) {
+        return NULL;
+    }
+
+    /* Los segmentos de trabajos terminados sin eliminarlos, incluido uno
+       anterior con el mismo pid, se eliminan */
+    scan_jobs(&n_jobs, TRUE);
+    metrics_name(sort->ppid, name, sizeof(name));
+    shm_unlink(name);
+    if ((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) == -1) {
+        perror("metrics_create - shm_open");
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(Metrics)) == -1) {
+        perror("metrics_create - ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    metrics = mmap(NULL, sizeof(Metrics), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (metrics == MAP_FAILED) {
+        perror("metrics_create - mmap");
+        shm_unlink(name);
+        return NULL;
+    }
+
+    /* Cada nivel recorre todos los elementos una vez */
+    memset(metrics, 0, sizeof(Metrics));
+    metrics->ppid = sort->ppid;
+    metrics->n_elements = sort->n_elements;
+    metrics->n_levels = sort->n_levels;
+    metrics->n_processes = sort->n_processes;
+    metrics->work_total = (long)sort->n_elements * sort->n_levels;
+    for (level = 0; level < sort->n_levels; level++) {
+        metrics->tasks_total[level] = get_number_parts(level, sort->n_levels);
+    }
+
+    /* Las tareas ya resueltas al empezar (al continuar un punto de control o
+       al mezclar secuencias ya ordenadas) cuentan como hechas */
+    for (level = 0; level < sort->n_levels; level++) {
+        for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+            if (sort->tasks[level][part].completed == COMPLETED) {
+                metrics->tasks_done[level]++;
+                metrics->work_done += sort->tasks[level][part].end - sort->tasks[level][part].ini;
+            }
+        }
+    }
+    metrics->start_ns = metrics_now();
+
+    /* La marca se escribe la última: quien la ve, ve también los contadores */
+    __atomic_store_n(&metrics->magic, METRICS_MAGIC, __ATOMIC_RELEASE);
+
+    return metrics;
+}
+
+/**
+ * Busca el único trabajo en curso.
+ *
+ * @return  El pid del proceso principal del trabajo, 0 en caso de error.
+ */
+static pid_t find_job() {
+    pid_t found;
+    int n_found;
+
+    found = scan_jobs(&n_found, FALSE);
+    if (n_found == 0) {
+        fprintf(stderr, "metrics_open - No sort running\n");
+        return 0;
+    }
+    if (n_found > 1) {
+        fprintf(stderr, "metrics_open - %d sorts running, choose one by its pid\n", n_found);
+        return 0;
+    }
+
+    return found;
+}
+
+Metrics *metrics_open(pid_t ppid) {
+    Metrics *metrics = NULL;
+    char name[METRICS_MAX_NAME];
+    int fd;
+
+    if ((ppid <= 0) && ((ppid = find_job()) == 0)) {
+        return NULL;
+    }
+
+    metrics_name(ppid, name, sizeof(name));
+    if ((fd = shm_open(name, O_RDONLY, 0)) == -1) {
+        perror("metrics_open - shm_open");
+        return NULL;
+    }
+    metrics = mmap(NULL, sizeof(Metrics), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (metrics == MAP_FAILED) {
+        perror("metrics_open - mmap");
+        return NULL;
+    }
+    if (__atomic_load_n(&metrics->magic, __ATOMIC_ACQUIRE) != METRICS_MAGIC) {
+        fprintf(stderr, "metrics_open - %s: invalid segment\n", name);
+        munmap(metrics, sizeof(Metrics));
+        return NULL;
+    }
+
+    return metrics;
+}
+
+void metrics_task_done(Metrics *metrics, int level, int n, int worker, long busy_ns) {
+    if ((!(metrics)) || (level < 0) || (level >= MAX_LEVELS)) {
+        return;
+    }
+
+    __atomic_add_fetch(&metrics->tasks_done[level], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&metrics->work_done, n, __ATOMIC_RELAXED);
+    if (level > 0) {
+        __atomic_add_fetch(&metrics->bytes_merged, (long)n * sizeof(int), __ATOMIC_RELAXED);
+    }
+    if ((worker >= 0) && (worker < MAX_PARTS)) {
+        __atomic_add_fetch(&metrics->busy_ns[worker], busy_ns, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Calcula las magnitudes derivadas de los contadores.
+ *
+ * @param metrics   Contadores.
+ * @param derived   Donde se guardan las magnitudes.
+ */
+static void derive(Metrics *metrics, Derived *derived) {
+    long end = metrics->finished ? metrics->end_ns : metrics_now();
+    long done = metrics->work_done;
+
+    derived->elapsed = (end - metrics->start_ns) / 1e9;
+    derived->keys_per_second = (derived->elapsed > 0) ? done / derived->elapsed : 0;
+    derived->progress = (metrics->work_total > 0) ? (double)done / metrics->work_total : 1;
+    if (derived->progress > 1) {
+        derived->progress = 1;
+    }
+
+    /* Al ritmo medio hasta ahora; -1 si todavía no se ha hecho nada */
+    if (metrics->finished || (derived->progress >= 1)) {
+        derived->eta = 0;
+    }
+    else if (done > 0) {
+        derived->eta = derived->elapsed * (metrics->work_total - done) / done;
+    }
+    else {
+        derived->eta = -1;
+    }
+}
+
+void metrics_print(FILE *file, Metrics *metrics) {
+    Derived derived;
+    int level, k;
+
+    if ((!(file)) || (!(metrics))) {
+        return;
+    }
+    derive(metrics, &derived);
+
+    fprintf(file, "Sort %d: %d elements, %d levels, %d processes%s\n", (int)metrics->ppid, \
+            metrics->n_elements, metrics->n_levels, metrics->n_processes, \
+            metrics->finished ? " (finished)" : "");
+    fprintf(file, "Progress:      %.1f %%\n", 100 * derived.progress);
+    fprintf(file, "Elapsed:       %.3f s\n", derived.elapsed);
+    if (derived.eta >= 0) {
+        fprintf(file, "ETA:           %.3f s\n", derived.eta);
+    }
+    else {
+        fprintf(file, "ETA:           unknown\n");
+    }
+    fprintf(file, "Keys/s:        %.0f\n", derived.keys_per_second);
+    fprintf(file, "Bytes merged:  %ld\n", metrics->bytes_merged);
+    fprintf(file, "Queue depth:   %d\n", metrics->queued);
+    fprintf(file, "Active:        %d\n", metrics->active);
+    fprintf(file, "Backups:       %d sent, %d won\n", metrics->backups_sent, metrics->backups_won);
+
+    fprintf(file, "\n%10s%10s%10s\n", "LEVEL", "DONE", "TASKS");
+    for (level = 0; level < metrics->n_levels; level++) {
+        fprintf(file, "%10d%10d%10d\n", level, metrics->tasks_done[level], metrics->tasks_total[level]);
+    }
+
+    fprintf(file, "\n%10s%10s\n", "WORKER", "BUSY");
+    for (k = 0; k < metrics->n_processes && k < MAX_PARTS; k++) {
+        fprintf(file, "%10d%9.1f%%\n", k, \
+                (derived.elapsed > 0) ? 100 * metrics->busy_ns[k] / 1e9 / derived.elapsed : 0);
+    }
+}
+
+void metrics_prometheus(FILE *file, Metrics *metrics) {
+    Derived derived;
+    int level, k;
+
+    if ((!(file)) || (!(metrics))) {
+        return;
+    }
+    derive(metrics, &derived);
+
+    fprintf(file, "# HELP sort_elements Number of elements being sorted.\n");
+    fprintf(file, "# TYPE sort_elements gauge\n");
+    fprintf(file, "sort_elements %d\n", metrics->n_elements);
+    fprintf(file, "# HELP sort_finished Whether the sort has finished.\n");
+    fprintf(file, "# TYPE sort_finished gauge\n");
+    fprintf(file, "sort_finished %d\n", metrics->finished ? 1 : 0);
+    fprintf(file, "# HELP sort_elapsed_seconds Time since the sort started.\n");
+    fprintf(file, "# TYPE sort_elapsed_seconds gauge\n");
+    fprintf(file, "sort_elapsed_seconds %.6f\n", derived.elapsed);
+    fprintf(file, "# HELP sort_progress_ratio Fraction of the work done.\n");
+    fprintf(file, "# TYPE sort_progress_ratio gauge\n");
+    fprintf(file, "sort_progress_ratio %.6f\n", derived.progress);
+    fprintf(file, "# HELP sort_eta_seconds Estimated time to finish, -1 if unknown.\n");
+    fprintf(file, "# TYPE sort_eta_seconds gauge\n");
+    fprintf(file, "sort_eta_seconds %.6f\n", derived.eta);
+    fprintf(file, "# HELP sort_keys_per_second Elements processed per second.\n");
+    fprintf(file, "# TYPE sort_keys_per_second gauge\n");
+    fprintf(file, "sort_keys_per_second %.0f\n", derived.keys_per_second);
+    fprintf(file, "# HELP sort_bytes_merged_total Bytes merged by the upper levels.\n");
+    fprintf(file, "# TYPE sort_bytes_merged_total counter\n");
+    fprintf(file, "sort_bytes_merged_total %ld\n", metrics->bytes_merged);
+    fprintf(file, "# HELP sort_queue_depth Tasks sent and not yet taken by a worker.\n");
+    fprintf(file, "# TYPE sort_queue_depth gauge\n");
+    fprintf(file, "sort_queue_depth %d\n", metrics->queued);
+    fprintf(file, "# HELP sort_active_workers Workers allowed to take tasks.\n");
+    fprintf(file, "# TYPE sort_active_workers gauge\n");
+    fprintf(file, "sort_active_workers %d\n", metrics->active);
+    fprintf(file, "# HELP sort_backups_sent_total Backup copies sent for straggler tasks.\n");
+    fprintf(file, "# TYPE sort_backups_sent_total counter\n");
+    fprintf(file, "sort_backups_sent_total %d\n", metrics->backups_sent);
+    fprintf(file, "# HELP sort_backups_won_total Backup copies that finished before the original.\n");
+    fprintf(file, "# TYPE sort_backups_won_total counter\n");
+    fprintf(file, "sort_backups_won_total %d\n", metrics->backups_won);
+
+    fprintf(file, "# HELP sort_tasks_done_total Tasks completed per level.\n");
+    fprintf(file, "# TYPE sort_tasks_done_total counter\n");
+    for (level = 0; level < metrics->n_levels; level++) {
+        fprintf(file, "sort_tasks_done_total{level=\"%d\"} %d\n", level, metrics->tasks_done[level]);
+    }
+    fprintf(file, "# HELP sort_tasks Tasks per level.\n");
+    fprintf(file, "# TYPE sort_tasks gauge\n");
+    for (level = 0; level < metrics->n_levels; level++) {
+        fprintf(file, "sort_tasks{level=\"%d\"} %d\n", level, metrics->tasks_total[level]);
+    }
+    fprintf(file, "# HELP sort_worker_busy_ratio Fraction of the time each worker was solving tasks.\n");
+    fprintf(file, "# TYPE sort_worker_busy_ratio gauge\n");
+    for (k = 0; k < metrics->n_processes && k < MAX_PARTS; k++) {
+        fprintf(file, "sort_worker_busy_ratio{worker=\"%d\"} %.6f\n", k, \
+                (derived.elapsed > 0) ? metrics->busy_ns[k] / 1e9 / derived.elapsed : 0);
+    }
+}
@@ -0,0 +1,122 @@
+/**
+ * @file metrics.h
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Contadores de progreso de una ordenación, en un segmento de memoria
+ * compartida propio que el programa sort_stat puede leer mientras dura el
+ * trabajo. El nombre del segmento lleva el pid del proceso principal, de forma
+ * que varias ordenaciones a la vez no comparten contadores. Los trabajadores los actualizan con operaciones atómicas al terminar
+ * cada tarea, sin coger el semáforo de la estructura compartida.
+ */
+
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "global.h"
+#include "sort.h"
+
+/* Constantes */
+#define METRICS_SHM_NAME "/shm_proyecto_metrics"
+#define METRICS_MAX_NAME 64
+#define METRICS_MAGIC 0x5254454d
+
+
+/* Contadores de un trabajo. Los tiempos son de CLOCK_MONOTONIC, común a todos
+   los procesos de la máquina */
+typedef struct {
+    unsigned int magic;
+    pid_t ppid;
+    int n_elements;
+    int n_levels;
+    int n_processes;
+    Bool finished;
+    long start_ns;
+    long end_ns;
+    long work_total;
+    long work_done;
+    long bytes_merged;
+    int queued;
+    int active;
+    int backups_sent;
+    int backups_won;
+    int tasks_total[MAX_LEVELS];
+    int tasks_done[MAX_LEVELS];
+    long busy_ns[MAX_PARTS];
+} Metrics;
+
+
+/**
+ * Devuelve el instante actual de CLOCK_MONOTONIC en nanosegundos.
+ *
+ * @return  El instante actual.
+ */
+long metrics_now();
+
+
+/**
+ * Construye el nombre del segmento de los contadores de un trabajo.
+ *
+ * @param ppid  Pid del proceso principal del trabajo.
+ * @param name  Buffer donde se guarda el nombre.
+ * @param size  Tamaño del buffer.
+ */
+void metrics_name(pid_t ppid, char *name, size_t size);
+
+
+/**
+ * Crea el segmento de los contadores para un problema ya inicializado.
+ *
+ * @param sort  Estructura de la ordenación.
+ * @return  Los contadores proyectados, NULL en caso de error.
+ */
+Metrics *metrics_create(Sort *sort);
+
+
+/**
+ * Proyecta en modo de solo lectura los contadores de un trabajo en curso. Sin
+ * pid, busca el único trabajo en curso; si hay varios hay que elegir uno.
+ *
+ * @param ppid  Pid del proceso principal del trabajo, 0 para buscarlo.
+ * @return  Los contadores proyectados, NULL en caso de error.
+ */
+Metrics *metrics_open(pid_t ppid);
+
+
+/**
+ * Anota una tarea terminada: cuenta sus elementos como trabajo hecho (y como
+ * bytes mezclados si no es del nivel 0) y el tiempo que ha estado ocupado el
+ * trabajador.
+ *
+ * @param metrics   Contadores.
+ * @param level     Nivel de la tarea.
+ * @param n         Número de elementos de la tarea.
+ * @param worker    Índice del trabajador.
+ * @param busy_ns   Tiempo que ha tardado en resolverla.
+ */
+void metrics_task_done(Metrics *metrics, int level, int n, int worker, long busy_ns);
+
+
+/**
+ * Escribe un resumen legible de los contadores.
+ *
+ * @param file      Fichero de salida.
+ * @param metrics   Contadores.
+ */
+void metrics_print(FILE *file, Metrics *metrics);
+
+
+/**
+ * Escribe los contadores en el formato de texto de Prometheus.
+ *
+ * @param file      Fichero de salida.
+ * @param metrics   Contadores.
+ */
+void metrics_prometheus(FILE *file, Metrics *metrics);
+
+#endif
@@ -0,0 +1,314 @@
+/**
+ * @file result.c
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Implementación de la publicación de resultados en memoria compartida. El
+ * número de referencias se guarda en un contador atómico en un segmento
+ * aparte, ya que el del resultado es de solo lectura para los consumidores.
+ * Una vez que el contador llega a 0 nadie puede volver a incrementarlo, por
+ * lo que quien lo deja a 0 elimina los dos segmentos sin competir con
+ * result_attach.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "result.h"
+
+/**
+ * Construye el nombre del segmento que cuenta las referencias de un
+ * resultado.
+ *
+ * @param name       Nombre del segmento.
+ * @param refs_name  Buffer donde se guarda el nombre.
+ * @param size       Tamaño del buffer.
+ */
+static void refs_name(char *name, char *refs_name, size_t size) {
+    snprintf(refs_name, size, "%s%s", name, RESULT_REFS_SUFFIX);
+}
+
+
+/**
+ * Proyecta el contador de referencias de un resultado, creándolo si se pide.
+ *
+ * @param name    Nombre del segmento del resultado.
+ * @param create  TRUE para crearlo (sin que exista antes).
+ * @return  El contador proyectado, NULL en caso de error.
+ */
+static int *refs_open(char *name, Bool create) {
+    char nombre[RESULT_MAX_NAME];
+    int *refs;
+    int fd;
+
+    refs_name(name, nombre, sizeof(nombre));
+    fd = create ? shm_open(nombre, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR) : \
+                  shm_open(nombre, O_RDWR, 0);
+    if (fd == -1) {
+        perror("result - shm_open refs");
+        return NULL;
+    }
+    if (create && (ftruncate(fd, sizeof(int)) == -1)) {
+        perror("result - ftruncate refs");
+        close(fd);
+        shm_unlink(nombre);
+        return NULL;
+    }
+    refs = mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (refs == MAP_FAILED) {
+        perror("result - mmap refs");
+        if (create) {
+            shm_unlink(nombre);
+        }
+        return NULL;
+    }
+
+    return refs;
+}
+
+unsigned long result_checksum(int *data, int n_elements) {
+    unsigned long hash = 14695981039346656037UL;
+    unsigned char *bytes = (unsigned char *)data;
+    size_t i;
+
+    if (!(data)) {
+        return 0;
+    }
+
+    for (i = 0; i < n_elements * sizeof(int); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211UL;
+    }
+
+    return hash;
+}
+
+/**
+ * Libera referencias de un resultado; quien libera la última elimina el
+ * segmento y su contador.
+ *
+ * @param name  Nombre del segmento.
+ * @param n     Número de referencias.
+ * @return  OK si se han liberado correctamente, ERROR en caso contrario.
+ */
+static Status release_refs(char *name, int n) {
+    char nombre[RESULT_MAX_NAME];
+    int *refs = NULL;
+
+    if (!(refs = refs_open(name, FALSE))) {
+        return ERROR;
+    }
+    if (__atomic_sub_fetch(refs, n, __ATOMIC_ACQ_REL) <= 0) {
+        refs_name(name, nombre, sizeof(nombre));
+        shm_unlink(name);
+        shm_unlink(nombre);
+    }
+    munmap(refs, sizeof(int));
+
+    return OK;
+}
+
+Result *result_create(char *name, size_t size) {
+    Result *result = NULL;
+    int fd;
+
+    if ((!(name)) || (name[0] != '/')) {
+        fprintf(stderr, "result_create - Incorrect arguments\n");
+        return NULL;
+    }
+
+    if ((fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR)) == -1) {
+        perror("result_create - shm_open");
+        return NULL;
+    }
+    if (ftruncate(fd, RESULT_HEADER_SIZE + size) == -1) {
+        perror("result_create - ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    result = mmap(NULL, RESULT_HEADER_SIZE + size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (result == MAP_FAILED) {
+        perror("result_create - mmap");
+        shm_unlink(name);
+        return NULL;
+    }
+
+    /* Hasta que se selle, la cabecera no es válida */
+    memset(result, 0, sizeof(Result));
+
+    return result;
+}
+
+void *result_payload(Result *result) {
+    return (char *)result + RESULT_HEADER_SIZE;
+}
+
+int *result_data(Result *result) {
+    return (int *)((char *)result + result->offset);
+}
+
+int result_width(ResultType type) {
+    return (type == RESULT_HISTOGRAM) ? 2 : 1;
+}
+
+Status result_seal(char *name, Result *result, ResultType type, int *data, int n_elements) {
+    char nombre[RESULT_MAX_NAME];
+    int *refs = NULL;
+    size_t size;
+    int fd, i, width;
+
+    if ((!(name)) || (!(result)) || (!(data)) || (n_elements < 0)) {
+        fprintf(stderr, "result_seal - Incorrect arguments\n");
+        return ERROR;
+    }
+
+    /* Solo el resultado queda en el segmento: lo que hay detrás de él, como
+       el resto de la estructura en la que se ha obtenido, se recorta */
+    width = result_width(type);
+    size = n_elements * width * sizeof(int);
+    if (data != result_payload(result)) {
+        memmove(result_payload(result), data, size);
+        data = result_payload(result);
+    }
+
+    /* La cabecera describe los datos para que los consumidores no los recorran */
+    result->type = type;
+    result->n_elements = n_elements;
+    result->offset = RESULT_HEADER_SIZE;
+    result->sorted = TRUE;
+    for (i = 1; i < n_elements; i++) {
+        if (data[(i - 1) * width] > data[i * width]) {
+            result->sorted = FALSE;
+            break;
+        }
+    }
+    result->checksum = result_checksum(data, n_elements * width);
+
+    /* A partir de aquí el segmento solo se puede leer */
+    if ((fd = shm_open(name, O_RDWR, 0)) == -1) {
+        perror("result_seal - shm_open");
+        return ERROR;
+    }
+    if (ftruncate(fd, RESULT_HEADER_SIZE + size) == -1) {
+        perror("result_seal - ftruncate");
+        close(fd);
+        return ERROR;
+    }
+    fchmod(fd, S_IRUSR | S_IRGRP | S_IROTH);
+    close(fd);
+
+    refs_name(name, nombre, sizeof(nombre));
+    shm_unlink(nombre);
+    if (!(refs = refs_open(name, TRUE))) {
+        return ERROR;
+    }
+    __atomic_store_n(refs, 1, __ATOMIC_RELEASE);
+    munmap(refs, sizeof(int));
+
+    /* Sin la marca, el segmento no está publicado y su creador lo elimina */
+    __atomic_store_n(&result->magic, RESULT_MAGIC, __ATOMIC_RELEASE);
+
+    return OK;
+}
+
+Status result_publish(char *name, ResultType type, int *data, int n_elements) {
+    Result *result = NULL;
+    size_t size;
+    Status status;
+
+    if ((!(data)) || (n_elements < 0)) {
+        fprintf(stderr, "result_publish - Incorrect arguments\n");
+        return ERROR;
+    }
+
+    size = n_elements * result_width(type) * sizeof(int);
+    if (!(result = result_create(name, size))) {
+        return ERROR;
+    }
+    memcpy(result_payload(result), data, size);
+    status = result_seal(name, result, type, result_payload(result), n_elements);
+    munmap(result, RESULT_HEADER_SIZE + size);
+    if (status == ERROR) {
+        shm_unlink(name);
+    }
+
+    return status;
+}
+
+Result *result_attach(char *name, size_t *size) {
+    Result *result = NULL;
+    int *refs = NULL;
+    struct stat st;
+    int fd, value;
+
+    if ((!(name)) || (!(size))) {
+        return NULL;
+    }
+
+    /* La referencia se toma antes de abrir el segmento, y solo si queda
+       alguna: con 0 el segmento ya se está eliminando */
+    if (!(refs = refs_open(name, FALSE))) {
+        return NULL;
+    }
+    value = __atomic_load_n(refs, __ATOMIC_ACQUIRE);
+    do {
+        if (value <= 0) {
+            fprintf(stderr, "result_attach - %s: being removed\n", name);
+            munmap(refs, sizeof(int));
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(refs, &value, value + 1, FALSE, \
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    munmap(refs, sizeof(int));
+
+    if ((fd = shm_open(name, O_RDONLY, 0)) == -1) {
+        perror("result_attach - shm_open");
+        release_refs(name, 1);
+        return NULL;
+    }
+    if ((fstat(fd, &st) == -1) || (st.st_size < RESULT_HEADER_SIZE)) {
+        fprintf(stderr, "result_attach - %s: invalid segment\n", name);
+        close(fd);
+        release_refs(name, 1);
+        return NULL;
+    }
+    result = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (result == MAP_FAILED) {
+        perror("result_attach - mmap");
+        release_refs(name, 1);
+        return NULL;
+    }
+    if ((result->magic != RESULT_MAGIC) || (result->n_elements < 0) || \
+        (result->offset < RESULT_HEADER_SIZE) || \
+        (result->offset + result->n_elements * result_width(result->type) * sizeof(int) > (size_t)st.st_size)) {
+        fprintf(stderr, "result_attach - %s: invalid segment\n", name);
+        munmap(result, st.st_size);
+        release_refs(name, 1);
+        return NULL;
+    }
+
+    *size = st.st_size;
+
+    return result;
+}
+Status result_detach(char *name, Result *result, size_t size, Bool release) {
+    if ((!(name)) || (!(result))) {
+        return ERROR;
+    }
+
+    munmap(result, size);
+
+    /* Una referencia por la proyección y otra por la publicación */
+    return release_refs(name, release ? 2 : 1);
+}
@@ -0,0 +1,155 @@
+/**
+ * @file result.h
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Publicación del resultado de una ordenación en un segmento de memoria
+ * compartida con nombre y de solo lectura, precedido de una cabecera que lo
+ * describe, para que otros procesos lo usen sin copiarlo. El segmento se
+ * elimina cuando se liberan todas sus referencias.
+ */
+
+#ifndef _RESULT_H
+#define _RESULT_H
+
+#include <stddef.h>
+#include "global.h"
+
+/* Constantes */
+#define RESULT_MAGIC 0x54524f53
+#define RESULT_REFS_SUFFIX "_refs"
+#define RESULT_MAX_NAME 64
+#define RESULT_HEADER_SIZE 64
+
+
+/* Tipo de los elementos de un resultado: enteros, pares (clave, número de
+   apariciones) o posiciones de los datos originales en el orden final */
+typedef enum {
+    RESULT_INT,
+    RESULT_HISTOGRAM,
+    RESULT_PERMUTATION
+} ResultType;
+
+
+/* Cabecera de un resultado publicado. Los elementos están a offset bytes del
+   comienzo del segmento, de forma que el resultado puede quedarse en la misma
+   estructura en la que se ha ordenado */
+typedef struct {
+    unsigned int magic;
+    ResultType type;
+    int n_elements;
+    Bool sorted;
+    unsigned long checksum;
+    long offset;
+} Result;
+
+
+/**
+ * Calcula la suma de comprobación (FNV-1a) de un vector.
+ *
+ * @param data        Vector con los datos.
+ * @param n_elements  Número de elementos del vector.
+ * @return  La suma de comprobación del vector.
+ */
+unsigned long result_checksum(int *data, int n_elements);
+
+
+/**
+ * Crea un segmento de memoria compartida con nombre con espacio para la
+ * cabecera y para size bytes a continuación, que se devuelven con
+ * result_payload. El segmento no es visible para los consumidores hasta que
+ * se llama a result_seal.
+ *
+ * @param name  Nombre del segmento, empezando por '/'.
+ * @param size  Tamaño del contenido.
+ * @return  La cabecera proyectada, NULL en caso de error.
+ */
+Result *result_create(char *name, size_t size);
+
+
+/**
+ * Devuelve el contenido de un segmento creado con result_create.
+ *
+ * @param result  Cabecera del segmento.
+ * @return  Puntero al contenido.
+ */
+void *result_payload(Result *result);
+
+
+/**
+ * Devuelve los elementos de un resultado.
+ *
+ * @param result  Cabecera del resultado.
+ * @return  Puntero a los elementos.
+ */
+int *result_data(Result *result);
+
+
+/**
+ * Devuelve el número de enteros que ocupa cada elemento de un tipo.
+ *
+ * @param type  Tipo de los elementos.
+ * @return  El número de enteros por elemento.
+ */
+int result_width(ResultType type);
+
+
+/**
+ * Completa la cabecera de un segmento creado con result_create con los datos
+ * que contiene, lo deja de solo lectura y crea su contador de referencias con
+ * una referencia, la de la propia publicación, que se libera con
+ * result_detach. Los elementos se mueven al principio del contenido si no
+ * están ya allí y el segmento se recorta para que solo contenga el resultado,
+ * por lo que lo que había detrás no se puede usar después. El segmento se
+ * sigue pudiendo desproyectar con munmap y el tamaño original.
+ *
+ * @param name        Nombre del segmento.
+ * @param result      Cabecera del segmento.
+ * @param type        Tipo de los elementos.
+ * @param data        Elementos del resultado, dentro del segmento.
+ * @param n_elements  Número de elementos.
+ * @return  OK si se ha publicado correctamente, ERROR en caso contrario.
+ */
+Status result_seal(char *name, Result *result, ResultType type, int *data, int n_elements);
+
+
+/**
+ * Publica una copia de un vector en un segmento nuevo.
+ *
+ * @param name        Nombre del segmento, empezando por '/'.
+ * @param type        Tipo de los elementos.
+ * @param data        Vector con los datos.
+ * @param n_elements  Número de elementos del vector.
+ * @return  OK si se ha publicado correctamente, ERROR en caso contrario.
+ */
+Status result_publish(char *name, ResultType type, int *data, int n_elements);
+
+
+/**
+ * Proyecta un resultado publicado en modo de solo lectura, tomando una
+ * referencia sobre él.
+ *
+ * @param name  Nombre del segmento.
+ * @param size  Donde se guarda el tamaño de la proyección.
+ * @return  El resultado proyectado, NULL en caso de error.
+ */
+Result *result_attach(char *name, size_t *size);
+
+
+/**
+ * Desproyecta un resultado y libera la referencia tomada con result_attach, y
+ * también la de la publicación si release es TRUE. El segmento se elimina al
+ * liberar la última referencia.
+ *
+ * @param name     Nombre del segmento.
+ * @param result   Resultado proyectado.
+ * @param size     Tamaño de la proyección.
+ * @param release  TRUE para liberar también la publicación.
+ * @return  OK si se ha liberado correctamente, ERROR en caso contrario.
+ */
+Status result_detach(char *name, Result *result, size_t size, Bool release);
+
+#endif
@@ -2,12 +2,14 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <math.h>
 #include <mqueue.h>
 #include <semaphore.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -17,6 +19,11 @@
 #include "sort.h"
 #include "utils.h"
 
+/* Keys of the elements in the string mode. They are registered before the
+workers are created, so every process has the same ones. */
+static StringKey string_key = NULL;
+static void *string_context = NULL;
+
 Status bubble_sort(int *vector, int n_elements, int delay) {
     int i, j;
     int temp;
@@ -40,7 +47,28 @@ Status bubble_sort(int *vector, int n_elements, int delay) {
     return OK;
 }
 
-Status merge(int *vector, int middle, int n_elements, int delay) {
+/**
+ * Publishes how many elements at the start of a merge are already in their
+ * final place, so that they can be written while the merge goes on.
+ * @param  merged    Counter of merged elements, NULL if not tracked.
+ * @param  n_merged  Number of elements in place.
+ */
+static void report_merged(int *merged, int n_merged) {
+    if (merged) {
+        __atomic_store_n(merged, n_merged, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * Merges two ordered parts of an array, publishing its progress.
+ * @param  vector     Array with the data.
+ * @param  middle     Division between the first and second parts.
+ * @param  n_elements Number of elements in the array.
+ * @param  merged     Counter of merged elements, NULL if not tracked.
+ * @param  delay      Delay for the algorithm.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+static Status merge_tracked(int *vector, int middle, int n_elements, int *merged, int delay) {
     int *aux = NULL;
     int i, j, k, l, m;
 
@@ -56,7 +84,7 @@ Status merge(int *vector, int middle, int n_elements, int delay) {
     for (k = 0; k < n_elements; k++) {
         /* Delay. */
         fast_sleep(delay);
-        if ((i < middle) && ((j >= n_elements) || (aux[i] < aux[j]))){
+        if ((i < middle) && ((j >= n_elements) || (aux[i] <= aux[j]))){
             vector[k] = aux[i];
             i++;
         }
@@ -76,141 +104,2397 @@ Status merge(int *vector, int middle, int n_elements, int delay) {
             vector[m] = aux[l];
             m++;
         }
+        report_merged(merged, k + 1);
     }
 
     free((void *)aux);
     return OK;
 }
 
-int get_number_parts(int level, int n_levels) {
-    /* The number of parts is 2^(n_levels - 1 - level). */
-    return 1 << (n_levels - 1 - level);
+Status merge(int *vector, int middle, int n_elements, int delay) {
+    return merge_tracked(vector, middle, n_elements, NULL, delay);
 }
 
-Status init_sort(char *file_name, Sort *sort, int n_levels, int n_processes, int delay) {
-    char string[MAX_STRING];
-    FILE *file = NULL;
-    int i, j, log_data;
-    int block_size, modulus;
+Status bubble_sort_index(int *vector, int *index, int n_elements, int delay) {
+    int i, j;
+    int temp;
 
-    if ((!(file_name)) || (!(sort))) {
-        fprintf(stderr, "init_sort - Incorrect arguments\n");
+    if ((!(vector)) || (!(index)) || (n_elements <= 0)) {
         return ERROR;
     }
 
-    /* At most MAX_LEVELS levels. */
-    sort->n_levels = MAX(1, MIN(n_levels, MAX_LEVELS));
-    /* At most MAX_PARTS processes can work together. */
-    sort->n_processes = MAX(1, MIN(n_processes, MAX_PARTS));
-    /* The main process PID is stored. */
-    sort->ppid = getpid();
-    /* Delay for the algorithm in ns (less than 1s). */
-    sort->delay = MAX(1, MIN(999999999, delay));
+    /* Only strictly greater elements are swapped, so equal ones keep their
+    order. */
+    for (i = 0; i < n_elements - 1; i++) {
+        for (j = 0; j < n_elements - i - 1; j++) {
+            /* Delay. */
+            fast_sleep(delay);
+            if (vector[j] > vector[j+1]) {
+                temp = vector[j];
+                vector[j] = vector[j + 1];
+                vector[j + 1] = temp;
+                temp = index[j];
+                index[j] = index[j + 1];
+                index[j + 1] = temp;
+            }
+        }
+    }
 
-    if (!(file = fopen(file_name, "r"))) {
-        perror("init_sort - fopen");
+    return OK;
+}
+
+Status merge_index(int *vector, int *index, int middle, int n_elements, int delay) {
+    int *aux = NULL, *aux_index = NULL;
+    int i, j, k;
+
+    if ((!(vector)) || (!(index)) || (middle < 0) || (middle > n_elements)) {
         return ERROR;
     }
+    if (middle == 0) {
+        return OK;
+    }
 
-    /* The first line contains the size of the data, truncated to MAX_DATA. */
-    if (!(fgets(string, MAX_STRING, file))) {
-        fprintf(stderr, "init_sort - Error reading file\n");
-        fclose(file);
+    /* Only the first part is copied: the output never gets ahead of the
+    elements of the second part still to be read. */
+    aux = (int *)malloc(middle * sizeof(int));
+    aux_index = (int *)malloc(middle * sizeof(int));
+    if ((!(aux)) || (!(aux_index))) {
+        free((void *)aux);
+        free((void *)aux_index);
         return ERROR;
     }
-    sort->n_elements = atoi(string);
-    if (sort->n_elements > MAX_DATA) {
-        sort->n_elements = MAX_DATA;
+    memcpy(aux, vector, middle * sizeof(int));
+    memcpy(aux_index, index, middle * sizeof(int));
+
+    /* On ties the first part goes first. */
+    i = 0; j = middle;
+    for (k = 0; i < middle; k++) {
+        /* Delay. */
+        fast_sleep(delay);
+        if ((j >= n_elements) || (aux[i] <= vector[j])) {
+            vector[k] = aux[i];
+            index[k] = aux_index[i];
+            i++;
+        }
+        else {
+            vector[k] = vector[j];
+            index[k] = index[j];
+            j++;
+        }
     }
 
-    /* The remaining lines contains one integer number each. */
-    for (i = 0; i < sort->n_elements; i++) {
-        if (!(fgets(string, MAX_STRING, file))) {
-            fprintf(stderr, "init_sort - Error reading file\n");
-            fclose(file);
-            return ERROR;
+    free((void *)aux);
+    free((void *)aux_index);
+    return OK;
+}
+
+/**
+ * Compares two integers for qsort.
+ * @param  a First integer.
+ * @param  b Second integer.
+ * @return   Negative, zero or positive as in strcmp.
+ */
+static int compare_int(const void *a, const void *b) {
+    return (*(const int *)a > *(const int *)b) - (*(const int *)a < *(const int *)b);
+}
+
+Status select_k(int *vector, int n_elements, int k, int delay) {
+    int left, right, pivot, lt, gt, i;
+    int temp;
+
+    if ((!(vector)) || (n_elements < 0) || (k <= 0)) {
+        return ERROR;
+    }
+
+    /* An empty part, as the modes that split the data by runs or inputs can
+    leave, has nothing to select. */
+    if (n_elements == 0) {
+        return OK;
+    }
+    k = MIN(k, n_elements);
+
+    /* Quickselect: only the side containing position k - 1 is partitioned.
+    The partition is three-way, [left, lt) below the pivot, [lt, gt] equal
+    to it and (gt, right] above it, so repeated keys end the search at once
+    instead of making it quadratic. */
+    left = 0;
+    right = n_elements - 1;
+    while (left < right) {
+        pivot = vector[left + (right - left) / 2];
+        lt = left;
+        gt = right;
+        i = left;
+        while (i <= gt) {
+            /* Delay. */
+            fast_sleep(delay);
+            if (vector[i] < pivot) {
+                temp = vector[i];
+                vector[i] = vector[lt];
+                vector[lt] = temp;
+                lt++;
+                i++;
+            }
+            else if (vector[i] > pivot) {
+                temp = vector[i];
+                vector[i] = vector[gt];
+                vector[gt] = temp;
+                gt--;
+            }
+            else {
+                i++;
+            }
+        }
+
+        if (k - 1 < lt) {
+            right = lt - 1;
+        }
+        else if (k - 1 > gt) {
+            left = gt + 1;
+        }
+        else {
+            break;
         }
-        sort->data[i] = atoi(string);
     }
-    fclose(file);
 
-    /* Each task should have at least one element. */
-    log_data = compute_log(sort->n_elements);
-    if (n_levels > log_data) {
-        n_levels = log_data;
+    /* Only the k selected elements are sorted. */
+    qsort(vector, k, sizeof(int), compare_int);
+
+    return OK;
+}
+
+Status merge_k(int *vector, int middle, int n_elements, int k, int delay) {
+    int *aux = NULL;
+    int left, right, n_out, i, j, o;
+
+    if ((!(vector)) || (k <= 0) || (middle < 0) || (middle > n_elements)) {
+        return ERROR;
     }
-    sort->n_levels = n_levels;
 
-    /* The data is divided between the tasks, which are also initialized. */
-    block_size = sort->n_elements / get_number_parts(0, sort->n_levels);
-    modulus = sort->n_elements % get_number_parts(0, sort->n_levels);
-    sort->tasks[0][0].completed = INCOMPLETE;
-    sort->tasks[0][0].ini = 0;
-    sort->tasks[0][0].end = block_size + (modulus > 0);
-    sort->tasks[0][0].mid = NO_MID;
-    for (j = 1; j < get_number_parts(0, sort->n_levels); j++) {
-        sort->tasks[0][j].completed = INCOMPLETE;
-        sort->tasks[0][j].ini = sort->tasks[0][j - 1].end;
-        sort->tasks[0][j].end = sort->tasks[0][j].ini \
-            + block_size + (modulus > j);
-        sort->tasks[0][j].mid = NO_MID;
+    /* With an empty part, the k smallest elements of the other one are
+    already sorted at the beginning. */
+    if ((middle == 0) || (middle == n_elements)) {
+        return OK;
     }
-    for (i = 1; i < n_levels; i++) {
-        for (j = 0; j < get_number_parts(i, sort->n_levels); j++) {
-            sort->tasks[i][j].completed = INCOMPLETE;
-            sort->tasks[i][j].ini = sort->tasks[i - 1][2 * j].ini;
-            sort->tasks[i][j].mid = sort->tasks[i - 1][2 * j].end;
-            sort->tasks[i][j].end = sort->tasks[i - 1][2 * j + 1].end;
+
+    /* Only the first k elements of each part are valid, and only the first
+    k of the result are needed. The output never gets ahead of the elements
+    of the second part still to be read, so only the first part is copied. */
+    left = MIN(k, middle);
+    right = MIN(k, n_elements - middle);
+    n_out = MIN(k, left + right);
+    aux = (int *)malloc(left * sizeof(int));
+    if (!(aux)) {
+        return ERROR;
+    }
+    memcpy(aux, vector, left * sizeof(int));
+
+    i = 0; j = middle;
+    for (o = 0; o < n_out; o++) {
+        /* Delay. */
+        fast_sleep(delay);
+        if ((i < left) && ((j >= middle + right) || (aux[i] <= vector[j]))) {
+            vector[o] = aux[i];
+            i++;
+        }
+        else {
+            vector[o] = vector[j];
+            j++;
         }
     }
 
+    free((void *)aux);
     return OK;
 }
 
-Bool check_task_ready(Sort *sort, int level, int part) {
-    if (!(sort)) {
-        return FALSE;
+/**
+ * Finds, by exponential and then binary search, the first position of a
+ * sorted array whose element is greater than the key (or greater or equal if
+ * strict is FALSE).
+ * @param  key     Key to look for.
+ * @param  vector  Sorted array.
+ * @param  n       Number of elements in the array.
+ * @param  strict  TRUE to skip the elements equal to the key.
+ * @return         Number of elements before the key.
+ */
+static int gallop(int key, int *vector, int n, Bool strict) {
+    int low, high, mid;
+
+    /* Exponential search for the range containing the position. */
+    low = 0;
+    high = 1;
+    while ((high <= n) && \
+           (strict ? vector[high - 1] <= key : vector[high - 1] < key)) {
+        low = high;
+        high = 2 * high;
     }
+    high = MIN(high, n);
 
-    if ((level < 0) || (level >= sort->n_levels) \
-        || (part < 0) || (part >= get_number_parts(level, sort->n_levels))) {
-        return FALSE;
+    /* Binary search inside the range. */
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (strict ? vector[mid] <= key : vector[mid] < key) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
     }
 
-    if (sort->tasks[level][part].completed != INCOMPLETE) {
-        return FALSE;
+    return low;
+}
+
+/**
+ * Merges two ordered parts of an array galloping, publishing its progress.
+ * @param  vector     Array with the data.
+ * @param  middle     Division between the first and second parts.
+ * @param  n_elements Number of elements in the array.
+ * @param  merged     Counter of merged elements, NULL if not tracked.
+ * @param  delay      Delay for the algorithm.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+static Status merge_gallop_tracked(int *vector, int middle, int n_elements, int *merged, int delay) {
+    int *aux = NULL;
+    int ini, end, n_left, wins_left, wins_right, count;
+    int i, j, k;
+
+    if ((!(vector)) || (n_elements < 0)) {
+        return ERROR;
     }
 
-    /* The tasks of the first level are always ready. */
-    if (level == 0) {
-        return TRUE;
+    /* Parts already in order do not need to be merged. */
+    if ((middle <= 0) || (middle >= n_elements) || \
+        (vector[middle - 1] <= vector[middle])) {
+        report_merged(merged, n_elements);
+        return OK;
     }
 
-    /* Other tasks depend on the hierarchy. */
-    if ((sort->tasks[level - 1][2 * part].completed == COMPLETED) && \
-        (sort->tasks[level - 1][2 * part + 1].completed == COMPLETED)) {
-        return TRUE;
+    /* The left elements not greater than the first right one, and the right
+    elements greater than the last left one, are already in place. */
+    ini = gallop(vector[middle], vector, middle, TRUE);
+    end = middle + gallop(vector[middle - 1], vector + middle, \
+                          n_elements - middle, FALSE);
+
+    n_left = middle - ini;
+    if (!(aux = (int *)malloc(n_left * sizeof(int)))) {
+        return ERROR;
     }
+    memcpy(aux, vector + ini, n_left * sizeof(int));
+    report_merged(merged, ini);
 
-    return FALSE;
+    /* Only the left part is copied; the merge advances over the right part,
+    which is never overwritten before being read. Ties take the left part to
+    keep the merge stable. After MIN_GALLOP wins in a row, the winning part
+    copies its whole block at once. */
+    i = 0; j = middle; k = ini;
+    wins_left = wins_right = 0;
+    while ((i < n_left) && (j < end)) {
+        /* Delay. */
+        fast_sleep(delay);
+        if (aux[i] <= vector[j]) {
+            vector[k++] = aux[i++];
+            wins_left++;
+            wins_right = 0;
+        }
+        else {
+            vector[k++] = vector[j++];
+            wins_right++;
+            wins_left = 0;
+        }
+
+        if ((wins_left >= MIN_GALLOP) && (i < n_left) && (j < end)) {
+            count = gallop(vector[j], aux + i, n_left - i, TRUE);
+            memcpy(vector + k, aux + i, count * sizeof(int));
+            i += count; k += count;
+            wins_left = 0;
+        }
+        else if ((wins_right >= MIN_GALLOP) && (i < n_left) && (j < end)) {
+            count = gallop(aux[i], vector + j, end - j, FALSE);
+            memmove(vector + k, vector + j, count * sizeof(int));
+            j += count; k += count;
+            wins_right = 0;
+        }
+        report_merged(merged, k);
+    }
+    memcpy(vector + k, aux + i, (n_left - i) * sizeof(int));
+    report_merged(merged, n_elements);
+
+    free((void *)aux);
+    return OK;
 }
 
-Status solve_task(Sort *sort, int level, int part) {
-    /* In the first level, bubble-sort. */
-    if (sort->tasks[level][part].mid == NO_MID) {
-        return bubble_sort(\
-            sort->data + sort->tasks[level][part].ini, \
-            sort->tasks[level][part].end - sort->tasks[level][part].ini, \
-            sort->delay);
+Status merge_gallop(int *vector, int middle, int n_elements, int delay) {
+    return merge_gallop_tracked(vector, middle, n_elements, NULL, delay);
+}
+
+Status natural_sort(int *vector, int n_elements, int delay) {
+    int ini, mid, end;
+    Bool sorted;
+
+    if ((!(vector)) || (n_elements < 0)) {
+        return ERROR;
     }
-    /* In other levels, merge. */
-    else {
-        return merge(\
-            sort->data + sort->tasks[level][part].ini, \
-            sort->tasks[level][part].mid - sort->tasks[level][part].ini, \
-            sort->tasks[level][part].end - sort->tasks[level][part].ini, \
-            sort->delay);
+
+    /* Adjacent ascending runs are merged in pairs until only one remains. */
+    do {
+        sorted = TRUE;
+        for (ini = 0; ini < n_elements; ini = end) {
+            for (mid = ini + 1; (mid < n_elements) && \
+                 (vector[mid - 1] <= vector[mid]); mid++);
+            if (mid == n_elements) {
+                break;
+            }
+            for (end = mid + 1; (end < n_elements) && \
+                 (vector[end - 1] <= vector[end]); end++);
+            if (merge_gallop(vector + ini, mid - ini, end - ini, delay) == ERROR) {
+                return ERROR;
+            }
+            sorted = FALSE;
+        }
+    } while (!(sorted));
+
+    return OK;
+}
+
+/**
+ * Builds the key of the head of a run of a multiway merge. The run is kept in
+ * the lowest bits, so that ties are won by the first run, and exhausted runs
+ * lose against any other one.
+ * @param  aux     Array with the runs.
+ * @param  cur     Current position of the run.
+ * @param  end     End of the run.
+ * @param  run     Index of the run.
+ * @return         Key of the head of the run.
+ */
+static unsigned long long run_head(int *aux, int cur, int end, int run) {
+    if (cur >= end) {
+        return ~0ULL;
+    }
+    return ((unsigned long long)((unsigned int)aux[cur] ^ 0x80000000U) << 8) | run;
+}
+
+Status merge_runs(int *vector, int *bounds, int n_runs, int delay) {
+    return merge_runs_index(vector, NULL, bounds, n_runs, delay);
+}
+
+Status merge_runs_index(int *vector, int *index, int *bounds, int n_runs, int delay) {
+    unsigned long long head[MAX_WAYS];
+    int cur[MAX_WAYS], end[MAX_WAYS];
+    int loser[MAX_WAYS], win[2 * MAX_WAYS];
+    int *aux = NULL, *aux_index = NULL;
+    int n_elements, leaves, winner, node, temp;
+    int i, k;
+
+    if ((!(vector)) || (!(bounds)) || (n_runs <= 0) || (n_runs > MAX_WAYS)) {
+        return ERROR;
+    }
+
+    n_elements = bounds[n_runs] - bounds[0];
+    if (n_elements <= 0) {
+        return OK;
+    }
+    if (!(aux = (int *)malloc(n_elements * sizeof(int)))) {
+        return ERROR;
+    }
+    if ((index) && (!(aux_index = (int *)malloc(n_elements * sizeof(int))))) {
+        free((void *)aux);
+        return ERROR;
+    }
+
+    /* A single copy of the input replaces the copies of each binary merge. */
+    vector += bounds[0];
+    memcpy(aux, vector, n_elements * sizeof(int));
+    if (index) {
+        index += bounds[0];
+        memcpy(aux_index, index, n_elements * sizeof(int));
+    }
+
+    /* Tree of losers over the runs, padded to a power of two with empty
+    runs. Each node keeps the loser of its match and the winner goes up. */
+    for (leaves = 1; leaves < n_runs; leaves *= 2);
+    for (i = 0; i < leaves; i++) {
+        cur[i] = (i < n_runs) ? bounds[i] - bounds[0] : n_elements;
+        end[i] = (i < n_runs) ? bounds[i + 1] - bounds[0] : n_elements;
+        head[i] = run_head(aux, cur[i], end[i], i);
+        win[leaves + i] = i;
+    }
+    for (node = leaves - 1; node >= 1; node--) {
+        if (head[win[2 * node]] < head[win[2 * node + 1]]) {
+            win[node] = win[2 * node];
+            loser[node] = win[2 * node + 1];
+        }
+        else {
+            win[node] = win[2 * node + 1];
+            loser[node] = win[2 * node];
+        }
+    }
+    winner = win[1];
+
+    for (k = 0; k < n_elements; k++) {
+        /* Delay. */
+        fast_sleep(delay);
+        if (index) {
+            index[k] = aux_index[cur[winner]];
+        }
+        vector[k] = aux[cur[winner]++];
+        head[winner] = run_head(aux, cur[winner], end[winner], winner);
+
+        /* The next lines of the run are requested before they are needed,
+        so that all the runs are streamed at the same time. */
+        __builtin_prefetch(aux + cur[winner] + PREFETCH_DISTANCE);
+
+        /* Only the matches on the path of the winner are played again. */
+        for (node = (leaves + winner) / 2; node >= 1; node /= 2) {
+            if (head[loser[node]] < head[winner]) {
+                temp = loser[node];
+                loser[node] = winner;
+                winner = temp;
+            }
+        }
+    }
+
+    free((void *)aux);
+    free((void *)aux_index);
+    return OK;
+}
+
+/**
+ * Loads 8 bytes of the key of an element from a given depth, in big endian
+ * order and padded with zeros, so that they compare as the bytes.
+ * @param  position Original position of the element.
+ * @param  depth    First byte to load.
+ * @param  length   Where the length of the key is stored.
+ * @return          The 8 bytes as an integer.
+ */
+static unsigned long long string_bytes(int position, int depth, int *length) {
+    unsigned long long bytes = 0;
+    char *key;
+    int k;
+
+    key = string_key(string_context, position, length);
+    for (k = depth; k < depth + 8; k++) {
+        bytes = (bytes << 8) | ((k < *length) ? (unsigned char)key[k] : 0);
+    }
+
+    return bytes;
+}
+
+/**
+ * Sorts the elements of a range by their cached 8 bytes, keeping the order of
+ * the equal ones: insertion for small ranges, least significant digit radix
+ * otherwise, skipping the bytes in which all of them are equal.
+ * @param  index      Positions of the elements.
+ * @param  cache      Cached bytes of the elements.
+ * @param  tmp_index  Auxiliary array for the positions.
+ * @param  tmp_cache  Auxiliary array for the cached bytes.
+ * @param  n          Number of elements.
+ */
+static void string_digits(int *index, unsigned long long *cache, int *tmp_index, \
+                          unsigned long long *tmp_cache, int n) {
+    int count[256];
+    unsigned long long key, all_or = 0, all_and = ~0ULL;
+    int i, j, position, shift, digit, sum, temp;
+
+    if (n <= MIN_RADIX) {
+        for (i = 1; i < n; i++) {
+            key = cache[i];
+            position = index[i];
+            for (j = i; (j > 0) && (cache[j - 1] > key); j--) {
+                cache[j] = cache[j - 1];
+                index[j] = index[j - 1];
+            }
+            cache[j] = key;
+            index[j] = position;
+        }
+        return;
+    }
+
+    for (i = 0; i < n; i++) {
+        all_or |= cache[i];
+        all_and &= cache[i];
+    }
+    for (shift = 0; shift < 64; shift += 8) {
+        if ((((all_or ^ all_and) >> shift) & 0xff) == 0) {
+            continue;
+        }
+        memset(count, 0, sizeof(count));
+        for (i = 0; i < n; i++) {
+            count[(cache[i] >> shift) & 0xff]++;
+        }
+        for (digit = 0, sum = 0; digit < 256; digit++) {
+            temp = count[digit];
+            count[digit] = sum;
+            sum += temp;
+        }
+        for (i = 0; i < n; i++) {
+            j = count[(cache[i] >> shift) & 0xff]++;
+            tmp_cache[j] = cache[i];
+            tmp_index[j] = index[i];
+        }
+        memcpy(cache, tmp_cache, n * sizeof(unsigned long long));
+        memcpy(index, tmp_index, n * sizeof(int));
+    }
+}
+
+/**
+ * Sorts a range of elements by their keys from a given depth, all of them
+ * equal before it, with a most significant digit radix sort of 8 bytes per
+ * digit. The longest common prefix of each element with the previous one is
+ * obtained from the digit in which they differ, except for the first one.
+ * @param  index      Positions of the elements.
+ * @param  lcp        Longest common prefixes.
+ * @param  cache      Auxiliary array for the cached bytes.
+ * @param  tmp_index  Auxiliary array for the positions.
+ * @param  tmp_cache  Auxiliary array for the cached bytes.
+ * @param  n          Number of elements.
+ * @param  depth      Number of bytes already equal.
+ */
+static void string_radix(int *index, int *lcp, unsigned long long *cache, int *tmp_index, \
+                         unsigned long long *tmp_cache, int n, int depth) {
+    int ini, end, length, longest;
+
+    for (ini = 0; ini < n; ini++) {
+        cache[ini] = string_bytes(index[ini], depth, &length);
+    }
+    string_digits(index, cache, tmp_index, tmp_cache, n);
+
+    /* The common prefixes between groups are taken before the cache is
+    reused for the next digit of each group. */
+    for (ini = 1; ini < n; ini++) {
+        if (cache[ini] != cache[ini - 1]) {
+            lcp[ini] = depth + __builtin_clzll(cache[ini] ^ cache[ini - 1]) / 8;
+        }
     }
+
+    for (ini = 0; ini < n; ini = end) {
+        string_key(string_context, index[ini], &longest);
+        for (end = ini + 1; (end < n) && (cache[end] == cache[ini]); end++) {
+            string_key(string_context, index[end], &length);
+            longest = MAX(longest, length);
+        }
+        if (end - ini == 1) {
+            continue;
+        }
+
+        /* Only the keys that go on past this digit need another one. */
+        if (longest > depth + 8) {
+            string_radix(index + ini, lcp + ini, cache + ini, tmp_index, \
+                         tmp_cache, end - ini, depth + 8);
+        }
+        else {
+            for (length = ini + 1; length < end; length++) {
+                lcp[length] = longest;
+            }
+        }
+    }
+}
+
+Status string_sort(int *vector, int *index, int *lcp, int n_elements, int delay) {
+    unsigned long long *cache = NULL, *tmp_cache = NULL;
+    int *tmp_index = NULL;
+    int k, length;
+
+    if ((!(vector)) || (!(index)) || (!(lcp)) || (!(string_key)) || (n_elements < 0)) {
+        return ERROR;
+    }
+    if (n_elements == 0) {
+        return OK;
+    }
+
+    cache = (unsigned long long *)malloc(n_elements * sizeof(unsigned long long));
+    tmp_cache = (unsigned long long *)malloc(n_elements * sizeof(unsigned long long));
+    tmp_index = (int *)malloc(n_elements * sizeof(int));
+    if ((!(cache)) || (!(tmp_cache)) || (!(tmp_index))) {
+        free((void *)cache);
+        free((void *)tmp_cache);
+        free((void *)tmp_index);
+        return ERROR;
+    }
+
+    lcp[0] = 0;
+    string_radix(index, lcp, cache, tmp_index, tmp_cache, n_elements, 0);
+
+    /* The prefixes of the data follow their positions. */
+    for (k = 0; k < n_elements; k++) {
+        /* Delay. */
+        fast_sleep(delay);
+        vector[k] = (int)((string_bytes(index[k], 0, &length) >> 32) ^ 0x80000000U);
+    }
+
+    free((void *)cache);
+    free((void *)tmp_cache);
+    free((void *)tmp_index);
+    return OK;
+}
+
+/**
+ * Compares the keys of two elements from a number of bytes known to be equal.
+ * @param  a        Original position of the first element.
+ * @param  b        Original position of the second element.
+ * @param  depth    Number of bytes known to be equal.
+ * @param  lcp      Where the longest common prefix of both keys is stored.
+ * @return          Negative, zero or positive as in strcmp.
+ */
+static int string_compare(int a, int b, int depth, int *lcp) {
+    char *key_a, *key_b;
+    int length_a, length_b;
+
+    key_a = string_key(string_context, a, &length_a);
+    key_b = string_key(string_context, b, &length_b);
+    while ((depth < length_a) && (depth < length_b) && (key_a[depth] == key_b[depth])) {
+        depth++;
+    }
+    *lcp = depth;
+
+    if ((depth < length_a) && (depth < length_b)) {
+        return (unsigned char)key_a[depth] - (unsigned char)key_b[depth];
+    }
+    return (length_a > depth) - (length_b > depth);
+}
+
+Status merge_strings(int *vector, int *index, int *lcp, int middle, int n_elements, int delay) {
+    int *aux = NULL, *aux_index = NULL, *aux_lcp = NULL;
+    int i, j, k, lcp_a, lcp_b, h;
+    Bool first;
+
+    if ((!(vector)) || (!(index)) || (!(lcp)) || (!(string_key)) || \
+        (middle < 0) || (middle > n_elements)) {
+        return ERROR;
+    }
+    if ((middle == 0) || (middle == n_elements)) {
+        return OK;
+    }
+
+    /* Parts whose keys do not overlap, as those of the radix partition, are
+    already merged. */
+    if (string_compare(index[middle - 1], index[middle], 0, &h) <= 0) {
+        lcp[middle] = h;
+        return OK;
+    }
+
+    /* Only the first part is copied: the output never gets ahead of the
+    elements of the second part still to be read. */
+    aux = (int *)malloc(middle * sizeof(int));
+    aux_index = (int *)malloc(middle * sizeof(int));
+    aux_lcp = (int *)malloc(middle * sizeof(int));
+    if ((!(aux)) || (!(aux_index)) || (!(aux_lcp))) {
+        free((void *)aux);
+        free((void *)aux_index);
+        free((void *)aux_lcp);
+        return ERROR;
+    }
+    memcpy(aux, vector, middle * sizeof(int));
+    memcpy(aux_index, index, middle * sizeof(int));
+    memcpy(aux_lcp, lcp, middle * sizeof(int));
+
+    /* Each head keeps its common prefix with the last element written. The
+    head that shares more with it is the smaller one, and only when both
+    share the same the keys are compared, from that byte on. On ties the
+    first part goes first. */
+    i = 0; j = middle;
+    lcp_a = 0; lcp_b = 0;
+    for (k = 0; i < middle; k++) {
+        /* Delay. */
+        fast_sleep(delay);
+        if (j >= n_elements) {
+            first = TRUE;
+        }
+        else if (lcp_a != lcp_b) {
+            first = (lcp_a > lcp_b) ? TRUE : FALSE;
+        }
+        else if (string_compare(aux_index[i], index[j], lcp_a, &h) <= 0) {
+            first = TRUE;
+            lcp_b = h;
+        }
+        else {
+            first = FALSE;
+            lcp_a = h;
+        }
+
+        if (first) {
+            vector[k] = aux[i];
+            index[k] = aux_index[i];
+            lcp[k] = lcp_a;
+            i++;
+            if (i < middle) {
+                lcp_a = aux_lcp[i];
+            }
+        }
+        else {
+            vector[k] = vector[j];
+            index[k] = index[j];
+            lcp[k] = lcp_b;
+            j++;
+            if (j < n_elements) {
+                lcp_b = lcp[j];
+            }
+        }
+    }
+
+    /* The rest of the second part is in place, but its first element now
+    follows the last one written. */
+    if (j < n_elements) {
+        lcp[j] = lcp_b;
+    }
+
+    free((void *)aux);
+    free((void *)aux_index);
+    free((void *)aux_lcp);
+    return OK;
+}
+
+Status group_count(int *vector, int *counts, int n_elements, int *n_groups, int delay) {
+    int i, g;
+
+    if ((!(vector)) || (!(counts)) || (!(n_groups)) || (n_elements < 0)) {
+        return ERROR;
+    }
+
+    /* The array is already sorted, so equal keys are together. */
+    g = 0;
+    for (i = 0; i < n_elements; i++) {
+        /* Delay. */
+        fast_sleep(delay);
+        if ((g > 0) && (vector[g - 1] == vector[i])) {
+            counts[g - 1]++;
+        }
+        else {
+            vector[g] = vector[i];
+            counts[g] = 1;
+            g++;
+        }
+    }
+    *n_groups = g;
+
+    return OK;
+}
+
+Status merge_groups(int *vector, int *counts, int middle, int n_left, int n_right, int *n_groups, int delay) {
+    int *aux = NULL, *aux_counts = NULL;
+    int i, j, g;
+
+    if ((!(vector)) || (!(counts)) || (!(n_groups)) || (n_left < 0) || \
+        (n_right < 0) || (n_left > middle)) {
+        return ERROR;
+    }
+
+    /* Only the left groups are copied: the output never gets ahead of the
+    right groups still to be read. */
+    if (n_left > 0) {
+        aux = (int *)malloc(n_left * sizeof(int));
+        aux_counts = (int *)malloc(n_left * sizeof(int));
+        if ((!(aux)) || (!(aux_counts))) {
+            free((void *)aux);
+            free((void *)aux_counts);
+            return ERROR;
+        }
+        memcpy(aux, vector, n_left * sizeof(int));
+        memcpy(aux_counts, counts, n_left * sizeof(int));
+    }
+
+    i = 0; j = middle; g = 0;
+    while ((i < n_left) || (j < middle + n_right)) {
+        /* Delay. */
+        fast_sleep(delay);
+        if ((j >= middle + n_right) || ((i < n_left) && (aux[i] < vector[j]))) {
+            vector[g] = aux[i];
+            counts[g] = aux_counts[i];
+            i++;
+        }
+        else if ((i >= n_left) || (vector[j] < aux[i])) {
+            vector[g] = vector[j];
+            counts[g] = counts[j];
+            j++;
+        }
+        /* Equal heads become a single group. */
+        else {
+            vector[g] = aux[i];
+            counts[g] = aux_counts[i] + counts[j];
+            i++;
+            j++;
+        }
+        g++;
+    }
+    *n_groups = g;
+
+    free((void *)aux);
+    free((void *)aux_counts);
+    return OK;
+}
+
+Status set_operation(int *vector, int *counts, int middle, int n_elements, SetOperation operation, int *n_results, int delay) {
+    int *aux = NULL;
+    int i, j, g, key, count_a, count_b;
+    long pairs;
+
+    if ((!(vector)) || (!(n_results)) || (middle < 0) || (middle > n_elements) || \
+        ((operation == SET_JOIN) && (!(counts)))) {
+        return ERROR;
+    }
+
+    /* Only the first part is copied: the output never gets ahead of the
+    elements of the second part still to be read. */
+    if ((middle > 0) && (!(aux = (int *)malloc(middle * sizeof(int))))) {
+        return ERROR;
+    }
+    if (middle > 0) {
+        memcpy(aux, vector, middle * sizeof(int));
+    }
+
+    /* Each step takes the smallest key of both heads with all its copies. */
+    i = 0; j = middle; g = 0;
+    while ((i < middle) || (j < n_elements)) {
+        /* Delay. */
+        fast_sleep(delay);
+        if ((j >= n_elements) || ((i < middle) && (aux[i] <= vector[j]))) {
+            key = aux[i];
+        }
+        else {
+            key = vector[j];
+        }
+        for (count_a = 0; (i < middle) && (aux[i] == key); i++, count_a++);
+        for (count_b = 0; (j < n_elements) && (vector[j] == key); j++, count_b++);
+
+        if ((operation == SET_UNION) || \
+            ((operation == SET_INTERSECT) && (count_a > 0) && (count_b > 0)) || \
+            ((operation == SET_EXCEPT) && (count_a > 0) && (count_b == 0))) {
+            vector[g++] = key;
+        }
+        /* Each copy of the key in one input joins with each one in the other. */
+        else if ((operation == SET_JOIN) && (count_a > 0) && (count_b > 0)) {
+            pairs = (long)count_a * count_b;
+            if (pairs > INT_MAX) {
+                fprintf(stderr, "set_operation - key %d has %ld pairs (at most %d)\n", key, pairs, INT_MAX);
+                free((void *)aux);
+                return ERROR;
+            }
+            vector[g] = key;
+            counts[g++] = (int)pairs;
+        }
+    }
+    *n_results = g;
+
+    free((void *)aux);
+    return OK;
+}
+
+/**
+ * Computes the number of bits of the differences of a block of sorted keys
+ * with its first key.
+ * @param  first      First key of the block.
+ * @param  last       Last key of the block.
+ * @return            The number of bits, from 0 to 32.
+ */
+static int pack_bits(int first, int last) {
+    unsigned int range = (unsigned int)last - (unsigned int)first;
+
+    return (range == 0) ? 0 : 32 - __builtin_clz(range);
+}
+
+/**
+ * Computes the positions used by a compressed block: its first key, its
+ * number of bits and the packed differences.
+ * @param  n          Number of keys of the block.
+ * @param  bits       Number of bits of each difference.
+ * @return            The number of positions.
+ */
+static int pack_words(int n, int bits) {
+    return 2 + (int)(((long)n * bits + 31) / 32);
+}
+
+/**
+ * Compresses a block of sorted keys.
+ * @param  keys       Keys of the block.
+ * @param  n          Number of keys of the block.
+ * @param  out        Where the compressed block is written.
+ * @return            The number of positions written.
+ */
+static int pack_block(const int *keys, int n, int *out) {
+    unsigned int *words = (unsigned int *)(out + 2);
+    unsigned long long pending = 0;
+    int bits, filled = 0, w = 0, k;
+
+    bits = pack_bits(keys[0], keys[n - 1]);
+    out[0] = keys[0];
+    out[1] = bits;
+    if (bits == 0) {
+        return 2;
+    }
+
+    for (k = 0; k < n; k++) {
+        pending |= (unsigned long long)((unsigned int)keys[k] - (unsigned int)keys[0]) << filled;
+        filled += bits;
+        if (filled >= 32) {
+            words[w++] = (unsigned int)pending;
+            pending >>= 32;
+            filled -= 32;
+        }
+    }
+    if (filled > 0) {
+        words[w++] = (unsigned int)pending;
+    }
+
+    return 2 + w;
+}
+
+/**
+ * Decodes a compressed block. Each key only depends on its own position, so
+ * the loop has no dependencies between iterations.
+ * @param  in         Compressed block.
+ * @param  n          Number of keys of the block.
+ * @param  keys       Where the keys are written.
+ * @return            The number of positions read.
+ */
+static int unpack_block(const int *in, int n, int *keys) {
+    const unsigned int *words = (const unsigned int *)(in + 2);
+    unsigned int base = (unsigned int)in[0], mask;
+    unsigned long long value;
+    int bits = in[1], bit, k;
+
+    if (bits == 0) {
+        for (k = 0; k < n; k++) {
+            keys[k] = in[0];
+        }
+        return 2;
+    }
+
+    mask = (bits == 32) ? 0xFFFFFFFFU : ((1U << bits) - 1);
+    for (k = 0; k < n; k++) {
+        bit = k * bits;
+        value = words[bit >> 5] >> (bit & 31);
+        if ((bit & 31) + bits > 32) {
+            value |= (unsigned long long)words[(bit >> 5) + 1] << (32 - (bit & 31));
+        }
+        keys[k] = (int)(base + ((unsigned int)value & mask));
+    }
+
+    return pack_words(n, bits);
+}
+
+int pack_run(int *vector, int n_elements) {
+    int block[PACK_BLOCK];
+    int first, n, out;
+
+    if ((!(vector)) || (n_elements <= 0)) {
+        return 0;
+    }
+
+    /* Each block is written over the original keys, so it must end before
+    the next block starts. */
+    out = 0;
+    for (first = 0; first < n_elements; first += PACK_BLOCK) {
+        n = MIN(PACK_BLOCK, n_elements - first);
+        out += pack_words(n, pack_bits(vector[first], vector[first + n - 1]));
+        if (out > first + n) {
+            return 0;
+        }
+    }
+
+    out = 0;
+    for (first = 0; first < n_elements; first += PACK_BLOCK) {
+        n = MIN(PACK_BLOCK, n_elements - first);
+        memcpy(block, vector + first, n * sizeof(int));
+        out += pack_block(block, n, vector + out);
+    }
+
+    return out;
+}
+
+/* Sorted part read by merge_packed, one decoded block at a time. */
+typedef struct {
+    const int *in;
+    int left;
+    Bool packed;
+    const int *keys;
+    int pos;
+    int len;
+    int block[PACK_BLOCK];
+} PackReader;
+
+/**
+ * Starts reading a sorted part.
+ * @param  reader     Reader.
+ * @param  in         First position of the part.
+ * @param  n          Number of keys of the part.
+ * @param  packed     TRUE if the part is compressed.
+ */
+static void reader_init(PackReader *reader, const int *in, int n, Bool packed) {
+    reader->in = in;
+    reader->left = n;
+    reader->packed = packed;
+    reader->keys = NULL;
+    reader->pos = 0;
+    reader->len = 0;
+}
+
+/**
+ * Makes the next keys of a part available: the next block if it is
+ * compressed, or all of them otherwise.
+ * @param  reader     Reader, with keys left.
+ */
+static void reader_fill(PackReader *reader) {
+    int n;
+
+    if (reader->packed) {
+        n = MIN(PACK_BLOCK, reader->left);
+        reader->in += unpack_block(reader->in, n, reader->block);
+        reader->keys = reader->block;
+    }
+    else {
+        n = reader->left;
+        reader->keys = reader->in;
+        reader->in += n;
+    }
+    reader->left -= n;
+    reader->pos = 0;
+    reader->len = n;
+}
+
+Status merge_packed(int *vector, int middle, int packed_left, int packed_right, int n_elements, Bool pack, int *packed, int delay) {
+    PackReader left, right;
+    int block[PACK_BLOCK];
+    int *aux = NULL;
+    int words_left, words_right, n, out, k;
+    Bool fits;
+
+    if ((!(vector)) || (!(packed)) || (middle < 0) || (middle > n_elements)) {
+        return ERROR;
+    }
+
+    /* Only the positions used by each part are copied. */
+    words_left = (packed_left > 0) ? packed_left : middle;
+    words_right = (packed_right > 0) ? packed_right : n_elements - middle;
+    if (!(aux = (int *)malloc(MAX(1, words_left + words_right) * sizeof(int)))) {
+        return ERROR;
+    }
+    memcpy(aux, vector, words_left * sizeof(int));
+    memcpy(aux + words_left, vector + middle, words_right * sizeof(int));
+
+    /* The result is written over the parts, which are read from the copy. If
+    a compressed block does not fit, the merge starts again without
+    compressing. */
+    do {
+        reader_init(&left, aux, middle, packed_left > 0);
+        reader_init(&right, aux + words_left, n_elements - middle, packed_right > 0);
+        fits = TRUE;
+        out = 0;
+        n = 0;
+        for (k = 0; (k < n_elements) && (fits); k++) {
+            /* Delay. */
+            fast_sleep(delay);
+            if ((left.pos == left.len) && (left.left > 0)) {
+                reader_fill(&left);
+            }
+            if ((right.pos == right.len) && (right.left > 0)) {
+                reader_fill(&right);
+            }
+            if ((left.pos < left.len) && ((right.pos == right.len) || \
+                (left.keys[left.pos] <= right.keys[right.pos]))) {
+                block[n++] = left.keys[left.pos++];
+            }
+            else {
+                block[n++] = right.keys[right.pos++];
+            }
+
+            if ((n == PACK_BLOCK) || (k == n_elements - 1)) {
+                if (!(pack)) {
+                    memcpy(vector + out, block, n * sizeof(int));
+                    out += n;
+                }
+                else if (out + pack_words(n, pack_bits(block[0], block[n - 1])) > n_elements) {
+                    fits = FALSE;
+                }
+                else {
+                    out += pack_block(block, n, vector + out);
+                }
+                n = 0;
+            }
+        }
+        if (!(fits)) {
+            pack = FALSE;
+        }
+    } while (!(fits));
+    *packed = (pack) ? out : 0;
+
+    free((void *)aux);
+    return OK;
+}
+
+int get_number_parts(int level, int n_levels) {
+    /* The number of parts is 2^(n_levels - 1 - level). */
+    return 1 << (n_levels - 1 - level);
+}
+
+/**
+ * Builds the merge tasks of the upper levels from the parts of level 0.
+ * @param  sort     Pointer to the sort structure.
+ */
+static void init_upper_levels(Sort *sort) {
+    int i, j;
+
+    for (i = 1; i < sort->n_levels; i++) {
+        for (j = 0; j < get_number_parts(i, sort->n_levels); j++) {
+            sort->tasks[i][j].completed = INCOMPLETE;
+            sort->tasks[i][j].owner = 0;
+            sort->tasks[i][j].saved = FALSE;
+            sort->tasks[i][j].ini = sort->tasks[i - 1][2 * j].ini;
+            sort->tasks[i][j].mid = sort->tasks[i - 1][2 * j].end;
+            sort->tasks[i][j].end = sort->tasks[i - 1][2 * j + 1].end;
+        }
+    }
+}
+
+/**
+ * Builds the task tree over the data already stored in the structure.
+ * @param  sort     Pointer to the sort structure.
+ * @param  n_levels Requested number of levels.
+ */
+static void init_tasks(Sort *sort, int n_levels) {
+    int j, log_data;
+    int block_size, modulus;
+
+    /* Each task should have at least one element. */
+    log_data = compute_log(sort->n_elements);
+    n_levels = MAX(1, MIN(n_levels, MAX_LEVELS));
+    if (n_levels > log_data) {
+        n_levels = log_data;
+    }
+    sort->n_levels = n_levels;
+    if (n_levels == 0) {
+        return;
+    }
+
+    /* The data is divided between the tasks, which are also initialized. */
+    block_size = sort->n_elements / get_number_parts(0, sort->n_levels);
+    modulus = sort->n_elements % get_number_parts(0, sort->n_levels);
+    sort->tasks[0][0].completed = INCOMPLETE;
+    sort->tasks[0][0].ini = 0;
+    sort->tasks[0][0].end = block_size + (modulus > 0);
+    sort->tasks[0][0].mid = NO_MID;
+    sort->tasks[0][0].owner = 0;
+    sort->tasks[0][0].saved = FALSE;
+    for (j = 1; j < get_number_parts(0, sort->n_levels); j++) {
+        sort->tasks[0][j].completed = INCOMPLETE;
+        sort->tasks[0][j].ini = sort->tasks[0][j - 1].end;
+        sort->tasks[0][j].end = sort->tasks[0][j].ini \
+            + block_size + (modulus > j);
+        sort->tasks[0][j].mid = NO_MID;
+        sort->tasks[0][j].owner = 0;
+        sort->tasks[0][j].saved = FALSE;
+    }
+    init_upper_levels(sort);
+}
+
+/**
+ * Stores the common parameters of the sorting problem.
+ * @param  sort        Pointer to the sort structure.
+ * @param  n_levels    Total number of levels in the algorithm.
+ * @param  n_processes Number of processes.
+ * @param  delay       Delay for the algorithm.
+ */
+static void init_params(Sort *sort, int n_levels, int n_processes, int delay) {
+    /* At most MAX_LEVELS levels. */
+    sort->n_levels = MAX(1, MIN(n_levels, MAX_LEVELS));
+    /* At most MAX_PARTS processes can work together. */
+    sort->n_processes = MAX(1, MIN(n_processes, MAX_PARTS));
+    /* The main process PID is stored. */
+    sort->ppid = getpid();
+    /* Delay for the algorithm in ns (less than 1s), 0 disables it. */
+    sort->delay = MAX(0, MIN(999999999, delay));
+    /* Full sort unless a top-k query, natural runs or the aggregation mode
+    are set afterwards. */
+    sort->top_k = 0;
+    sort->natural = FALSE;
+    sort->aggregate = FALSE;
+    sort->fuse = 0;
+    sort->stable = FALSE;
+    sort->strings = FALSE;
+    sort->operation = SET_NONE;
+    sort->compress = FALSE;
+    sort->verify = FALSE;
+    sort->checksum = 0;
+    sort->merged = 0;
+}
+
+Status init_sort(char *file_name, Sort *sort, int n_levels, int n_processes, int delay) {
+    FILE *file = NULL;
+
+    if ((!(file_name)) || (!(sort))) {
+        fprintf(stderr, "init_sort - Incorrect arguments\n");
+        return ERROR;
+    }
+
+    if (!(file = fopen(file_name, "r"))) {
+        perror("init_sort - fopen");
+        return ERROR;
+    }
+
+    if ((init_sort_stream(file, sort, n_levels, n_processes, delay) == ERROR) \
+        || (read_sort_data(file, sort, 0, sort->n_elements) == ERROR)) {
+        fclose(file);
+        return ERROR;
+    }
+    fclose(file);
+
+    return OK;
+}
+
+Status init_sort_stream(FILE *file, Sort *sort, int n_levels, int n_processes, int delay) {
+    char string[MAX_STRING];
+
+    if ((!(file)) || (!(sort))) {
+        fprintf(stderr, "init_sort_stream - Incorrect arguments\n");
+        return ERROR;
+    }
+
+    init_params(sort, n_levels, n_processes, delay);
+
+    /* The first line contains the size of the data, truncated to MAX_DATA. */
+    if (!(fgets(string, MAX_STRING, file))) {
+        fprintf(stderr, "init_sort - Error reading file\n");
+        return ERROR;
+    }
+    sort->n_elements = MAX(0, atoi(string));
+    if (sort->n_elements > MAX_DATA) {
+        sort->n_elements = MAX_DATA;
+    }
+
+    /* The tasks only depend on the size, so they can be built before the data
+    is read. */
+    init_tasks(sort, n_levels);
+
+    return OK;
+}
+
+Status read_sort_data(FILE *file, Sort *sort, int ini, int end) {
+    char string[MAX_STRING];
+    int i;
+
+    if ((!(file)) || (!(sort)) || (ini < 0) || (end > sort->n_elements)) {
+        fprintf(stderr, "read_sort_data - Incorrect arguments\n");
+        return ERROR;
+    }
+
+    /* The remaining lines contains one integer number each. */
+    for (i = ini; i < end; i++) {
+        if (!(fgets(string, MAX_STRING, file))) {
+            fprintf(stderr, "init_sort - Error reading file\n");
+            return ERROR;
+        }
+        sort->data[i] = atoi(string);
+    }
+
+    return OK;
+}
+
+Status init_sort_data(int *data, int n_elements, Sort *sort, int n_levels, int n_processes, int delay) {
+    if ((!(data)) || (!(sort)) || (n_elements < 0)) {
+        fprintf(stderr, "init_sort_data - Incorrect arguments\n");
+        return ERROR;
+    }
+
+    init_params(sort, n_levels, n_processes, delay);
+
+    /* The data is copied, truncated to MAX_DATA. */
+    sort->n_elements = MIN(n_elements, MAX_DATA);
+    memcpy(sort->data, data, sort->n_elements * sizeof(int));
+
+    init_tasks(sort, n_levels);
+
+    return OK;
+}
+
+Status read_run(char *file_name, int *data, int max_elements, int *n_elements) {
+    struct stat st;
+    char *map, *p, *end;
+    long value;
+    int fd, n, i;
+    Bool negative;
+
+    if ((!(file_name)) || (!(data)) || (!(n_elements)) || (max_elements < 0)) {
+        fprintf(stderr, "read_run - Incorrect arguments\n");
+        return ERROR;
+    }
+
+    if ((fd = open(file_name, O_RDONLY)) == -1) {
+        perror("read_run - open");
+        return ERROR;
+    }
+    if (fstat(fd, &st) == -1) {
+        perror("read_run - fstat");
+        close(fd);
+        return ERROR;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        fprintf(stderr, "read_run - %s: empty file\n", file_name);
+        return ERROR;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("read_run - mmap");
+        return ERROR;
+    }
+    posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    /* The file is parsed in place: the size first and then the elements, as
+    many as fit. */
+    p = map;
+    end = map + st.st_size;
+    n = -1;
+    for (i = -1; (i < 0) || (i < n); i++) {
+        while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\n') || (*p == '\r'))) {
+            p++;
+        }
+        negative = ((p < end) && (*p == '-')) ? TRUE : FALSE;
+        if (negative) {
+            p++;
+        }
+        if ((p >= end) || (*p < '0') || (*p > '9')) {
+            fprintf(stderr, "read_run - %s: error reading element %d\n", file_name, i);
+            munmap(map, st.st_size);
+            return ERROR;
+        }
+        for (value = 0; (p < end) && (*p >= '0') && (*p <= '9'); p++) {
+            value = 10 * value + (*p - '0');
+        }
+        if ((i < 0) && (value > max_elements)) {
+            fprintf(stderr, "read_run - %s: more than %d elements\n", file_name, max_elements);
+            munmap(map, st.st_size);
+            return ERROR;
+        }
+        if (i < 0) {
+            n = (int)value;
+        }
+        else {
+            data[i] = negative ? (int)-value : (int)value;
+        }
+    }
+    *n_elements = MAX(n, 0);
+
+    munmap(map, st.st_size);
+    return OK;
+}
+
+Status init_sort_runs(Sort *sort, int *bounds, int n_runs, int n_processes, int delay) {
+    int n_levels, n_parts, i, j, run;
+
+    if ((!(sort)) || (!(bounds)) || (n_runs <= 0)) {
+        fprintf(stderr, "init_sort_runs - Incorrect arguments\n");
+        return ERROR;
+    }
+
+    /* Each run is a part of level 0, so there must be enough of them. */
+    for (n_levels = 1; (n_levels <= MAX_LEVELS) && \
+         (get_number_parts(0, n_levels) < n_runs); n_levels++);
+    if (n_levels > MAX_LEVELS) {
+        fprintf(stderr, "init_sort_runs - At most %d runs\n", get_number_parts(0, MAX_LEVELS));
+        return ERROR;
+    }
+
+    init_params(sort, n_levels, n_processes, delay);
+    sort->n_elements = bounds[n_runs] - bounds[0];
+    for (run = 0; run < n_runs; run++) {
+        for (i = bounds[run] + 1; i < bounds[run + 1]; i++) {
+            if (sort->data[i - 1] > sort->data[i]) {
+                fprintf(stderr, "init_sort_runs - Run %d is not sorted\n", run);
+                return ERROR;
+            }
+        }
+    }
+
+    /* Level 0 is already solved: the runs are not sorted again. The merges
+    gallop over the parts of the runs that do not overlap. */
+    n_parts = get_number_parts(0, sort->n_levels);
+    for (j = 0; j < n_parts; j++) {
+        sort->tasks[0][j].completed = COMPLETED;
+        sort->tasks[0][j].ini = bounds[MIN(j, n_runs)] - bounds[0];
+        sort->tasks[0][j].end = bounds[MIN(j + 1, n_runs)] - bounds[0];
+        sort->tasks[0][j].mid = NO_MID;
+        sort->tasks[0][j].owner = 0;
+        sort->tasks[0][j].saved = FALSE;
+    }
+    init_upper_levels(sort);
+    sort->natural = TRUE;
+
+    return OK;
+}
+
+/**
+ * Finds the element at a position of the merge of two sorted arrays, without
+ * merging them.
+ * @param  a       First array.
+ * @param  n_a     Number of elements of the first array.
+ * @param  b       Second array.
+ * @param  n_b     Number of elements of the second array.
+ * @param  rank    Position in the merge, less than n_a + n_b.
+ * @return         The element at that position.
+ */
+static int merged_rank(int *a, int n_a, int *b, int n_b, int rank) {
+    int lo, hi, i, j;
+
+    /* The first rank elements are the first i of a and the first rank - i
+    of b, for the least i whose next element of a is not before them. */
+    lo = MAX(0, rank - n_b);
+    hi = MIN(rank, n_a);
+    while (lo < hi) {
+        i = lo + (hi - lo) / 2;
+        j = rank - i;
+        if ((j > 0) && (a[i] < b[j - 1])) {
+            lo = i + 1;
+        }
+        else {
+            hi = i;
+        }
+    }
+    i = lo;
+    j = rank - i;
+
+    if ((j >= n_b) || ((i < n_a) && (a[i] <= b[j]))) {
+        return a[i];
+    }
+    return b[j];
+}
+
+/**
+ * Finds the first position of a sorted array whose element is not less than a
+ * key.
+ * @param  vector     Sorted array.
+ * @param  n_elements Number of elements of the array.
+ * @param  key        Key to look for.
+ * @return            The position, n_elements if all of them are less.
+ */
+static int lower_bound(int *vector, int n_elements, int key) {
+    int lo = 0, hi = n_elements, i;
+
+    while (lo < hi) {
+        i = lo + (hi - lo) / 2;
+        if (vector[i] < key) {
+            lo = i + 1;
+        }
+        else {
+            hi = i;
+        }
+    }
+
+    return lo;
+}
+
+Status init_set_operation(Sort *sort, int n_a, int n_b, SetOperation operation, int n_levels, int n_processes, int delay) {
+    int *a = NULL, *b = NULL;
+    int n_parts, part, pos, i;
+    int split_a[MAX_PARTS + 1], split_b[MAX_PARTS + 1];
+    int key;
+
+    if ((!(sort)) || (n_a < 0) || (n_b < 0) || (n_a + n_b > MAX_DATA) || (operation == SET_NONE)) {
+        fprintf(stderr, "init_set_operation - Incorrect arguments\n");
+        return ERROR;
+    }
+    sort->n_elements = n_a + n_b;
+
+    for (i = 1; i < sort->n_elements; i++) {
+        if ((i != n_a) && (sort->data[i - 1] > sort->data[i])) {
+            fprintf(stderr, "init_set_operation - Input %d is not sorted\n", (i < n_a) ? 0 : 1);
+            return ERROR;
+        }
+    }
+
+    a = (int *)malloc(MAX(1, n_a) * sizeof(int));
+    b = (int *)malloc(MAX(1, n_b) * sizeof(int));
+    if ((!(a)) || (!(b))) {
+        free((void *)a);
+        free((void *)b);
+        return ERROR;
+    }
+    memcpy(a, sort->data, n_a * sizeof(int));
+    memcpy(b, sort->data + n_a, n_b * sizeof(int));
+
+    init_params(sort, n_levels, n_processes, delay);
+    sort->operation = operation;
+    n_parts = get_number_parts(0, sort->n_levels);
+
+    /* The splitters are the keys at equal distances of the merge of both
+    inputs. All the copies of a key go to the same part, so the parts can
+    be solved independently. */
+    split_a[0] = 0;
+    split_b[0] = 0;
+    for (part = 1; part < n_parts; part++) {
+        if (sort->n_elements == 0) {
+            split_a[part] = 0;
+            split_b[part] = 0;
+            continue;
+        }
+        key = merged_rank(a, n_a, b, n_b, (int)((long)part * sort->n_elements / n_parts));
+        split_a[part] = MAX(split_a[part - 1], lower_bound(a, n_a, key));
+        split_b[part] = MAX(split_b[part - 1], lower_bound(b, n_b, key));
+    }
+    split_a[n_parts] = n_a;
+    split_b[n_parts] = n_b;
+
+    /* Each part of level 0 holds its range of the first input followed by
+    its range of the second one, as the two halves of a merge. */
+    pos = 0;
+    for (part = 0; part < n_parts; part++) {
+        sort->tasks[0][part].completed = INCOMPLETE;
+        sort->tasks[0][part].owner = 0;
+        sort->tasks[0][part].saved = FALSE;
+        sort->tasks[0][part].ini = pos;
+        memcpy(sort->data + pos, a + split_a[part], (split_a[part + 1] - split_a[part]) * sizeof(int));
+        pos += split_a[part + 1] - split_a[part];
+        sort->tasks[0][part].mid = pos;
+        memcpy(sort->data + pos, b + split_b[part], (split_b[part + 1] - split_b[part]) * sizeof(int));
+        pos += split_b[part + 1] - split_b[part];
+        sort->tasks[0][part].end = pos;
+    }
+    init_upper_levels(sort);
+
+    free((void *)a);
+    free((void *)b);
+    return OK;
+}
+
+Status init_natural_runs(Sort *sort, int *n_runs) {
+    int *starts = NULL;
+    int n_starts, n_parts, target;
+    int i, j, lo, hi, ini, end;
+    int temp;
+
+    if ((!(sort)) || (!(n_runs))) {
+        return ERROR;
+    }
+
+    sort->natural = TRUE;
+    *n_runs = 0;
+    if (sort->n_elements == 0) {
+        return OK;
+    }
+
+    if (!(starts = (int *)malloc((sort->n_elements + 1) * sizeof(int)))) {
+        return ERROR;
+    }
+
+    /* Detection of the runs. Strictly descending runs are reversed, which
+    keeps equal elements in their order. */
+    n_starts = 0;
+    for (ini = 0; ini < sort->n_elements; ini = end) {
+        starts[n_starts++] = ini;
+        end = ini + 1;
+        if ((end < sort->n_elements) && (sort->data[end] < sort->data[ini])) {
+            while ((end < sort->n_elements) && \
+                   (sort->data[end] < sort->data[end - 1])) {
+                end++;
+            }
+            for (i = ini, j = end - 1; i < j; i++, j--) {
+                temp = sort->data[i];
+                sort->data[i] = sort->data[j];
+                sort->data[j] = temp;
+            }
+        }
+        else {
+            while ((end < sort->n_elements) && \
+                   (sort->data[end] >= sort->data[end - 1])) {
+                end++;
+            }
+        }
+    }
+    starts[n_starts] = sort->n_elements;
+    *n_runs = n_starts;
+
+    /* Each boundary of level 0 is moved to the closest start of a run, so
+    that runs are not split between parts. Parts may become empty. */
+    if (sort->n_levels > 0) {
+        n_parts = get_number_parts(0, sort->n_levels);
+        for (j = 1; j < n_parts; j++) {
+            target = sort->tasks[0][j].ini;
+            lo = 0;
+            hi = n_starts;
+            while (lo < hi) {
+                i = lo + (hi - lo) / 2;
+                if (starts[i] < target) {
+                    lo = i + 1;
+                }
+                else {
+                    hi = i;
+                }
+            }
+            if ((lo > 0) && (target - starts[lo - 1] < starts[lo] - target)) {
+                lo--;
+            }
+            sort->tasks[0][j].ini = starts[lo];
+            sort->tasks[0][j - 1].end = starts[lo];
+        }
+        init_upper_levels(sort);
+    }
+
+    free((void *)starts);
+    return OK;
+}
+
+Status init_stable(Sort *sort) {
+    int i;
+
+    if (!(sort)) {
+        return ERROR;
+    }
+
+    /* Each element starts at its own position, which also breaks the ties
+    between equal elements. */
+    sort->stable = TRUE;
+    for (i = 0; i < sort->n_elements; i++) {
+        sort->index[i] = i;
+    }
+
+    return OK;
+}
+
+Status init_strings(Sort *sort, StringKey key, void *context) {
+    int count[RADIX_BUCKETS + 1];
+    int *aux = NULL, *aux_index = NULL;
+    int n_parts, target, bucket, i, j;
+
+    if ((!(sort)) || (!(key))) {
+        return ERROR;
+    }
+
+    string_key = key;
+    string_context = context;
+    if (init_stable(sort) == ERROR) {
+        return ERROR;
+    }
+    sort->strings = TRUE;
+    if (sort->n_elements == 0) {
+        return OK;
+    }
+
+    aux = (int *)malloc(sort->n_elements * sizeof(int));
+    aux_index = (int *)malloc(sort->n_elements * sizeof(int));
+    if ((!(aux)) || (!(aux_index))) {
+        free((void *)aux);
+        free((void *)aux_index);
+        return ERROR;
+    }
+
+    /* First digit of the radix sort: the elements are distributed by the
+    first two bytes of their keys, keeping their order inside each bucket. */
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < sort->n_elements; i++) {
+        count[RADIX_BUCKET(sort->data[i]) + 1]++;
+    }
+    for (bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+        count[bucket + 1] += count[bucket];
+    }
+    for (i = 0; i < sort->n_elements; i++) {
+        j = count[RADIX_BUCKET(sort->data[i])]++;
+        aux[j] = sort->data[i];
+        aux_index[j] = sort->index[i];
+    }
+    memcpy(sort->data, aux, sort->n_elements * sizeof(int));
+    memcpy(sort->index, aux_index, sort->n_elements * sizeof(int));
+
+    /* Each boundary of level 0 is moved to the closest start of a bucket if
+    it is not too far, so that the parts hold disjoint ranges of keys and the
+    merges only have to check that they are in order. */
+    if (sort->n_levels > 0) {
+        n_parts = get_number_parts(0, sort->n_levels);
+        for (j = 1; j < n_parts; j++) {
+            target = sort->tasks[0][j].ini;
+            for (i = target; (i > 0) && (i > target - sort->n_elements / (2 * n_parts)) && \
+                 (RADIX_BUCKET(sort->data[i - 1]) == RADIX_BUCKET(sort->data[i])); i--);
+            if ((i > 0) && (RADIX_BUCKET(sort->data[i - 1]) == RADIX_BUCKET(sort->data[i]))) {
+                continue;
+            }
+            if (i <= sort->tasks[0][j - 1].ini) {
+                continue;
+            }
+            sort->tasks[0][j].ini = i;
+            sort->tasks[0][j - 1].end = i;
+        }
+        init_upper_levels(sort);
+    }
+
+    free((void *)aux);
+    free((void *)aux_index);
+    return OK;
+}
+
+int get_number_groups(Sort *sort) {
+    int i;
+
+    if (!(sort)) {
+        return 0;
+    }
+
+    /* Without levels there is at most one element. */
+    if (sort->n_levels == 0) {
+        for (i = 0; i < sort->n_elements; i++) {
+            sort->counts[i] = 1;
+        }
+        return sort->n_elements;
+    }
+
+    return sort->tasks[sort->n_levels - 1][0].size;
+}
+
+unsigned long long multiset_hash(int *vector, int *counts, int n_elements) {
+    unsigned long long hash = 0, x;
+    int i;
+
+    if (!(vector)) {
+        return 0;
+    }
+
+    /* Each element is mixed as in splitmix64 before adding it, so that
+    different multisets with the same sum do not collide. */
+    for (i = 0; i < n_elements; i++) {
+        x = (unsigned long long)(unsigned int)vector[i] + 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        hash += (counts) ? x * (unsigned long long)counts[i] : x;
+    }
+
+    return hash;
+}
+
+Status checksum_input(Sort *sort, int ini, int end) {
+    if ((!(sort)) || (ini < 0) || (end > sort->n_elements) || (ini > end)) {
+        return ERROR;
+    }
+
+    sort->verify = TRUE;
+    sort->checksum += multiset_hash(sort->data + ini, NULL, end - ini);
+
+    return OK;
+}
+
+int get_number_checks(Sort *sort) {
+    if ((!(sort)) || (sort->n_levels == 0)) {
+        return 1;
+    }
+
+    return get_number_parts(0, sort->n_levels);
+}
+
+Status verify_part(Sort *sort, int part) {
+    Check *check;
+    int n_results, n_checks, ini, end, i;
+
+    if ((!(sort)) || (part < 0) || (part >= get_number_checks(sort))) {
+        return ERROR;
+    }
+
+    /* The groups of the aggregation mode are at the beginning of the data. */
+    n_results = (sort->aggregate) ? get_number_groups(sort) : sort->n_elements;
+    n_checks = get_number_checks(sort);
+    ini = (int)((long)part * n_results / n_checks);
+    end = (int)((long)(part + 1) * n_results / n_checks);
+
+    check = &sort->checks[part];
+    check->sorted = TRUE;
+    for (i = MAX(ini, 1); i < end; i++) {
+        if ((sort->data[i - 1] > sort->data[i]) || \
+            ((sort->aggregate) && (sort->data[i - 1] == sort->data[i]))) {
+            check->sorted = FALSE;
+            break;
+        }
+    }
+    check->hash = multiset_hash(sort->data + ini, (sort->aggregate) ? sort->counts + ini : NULL, \
+                                end - ini);
+
+    return OK;
+}
+
+/**
+ * Checks if the merge of a level is done by an upper level when several levels
+ * are fused.
+ * @param  sort       Pointer to the sort structure.
+ * @param  level      Level of the algorithm.
+ * @return            TRUE if the tasks of the level do nothing, FALSE otherwise.
+ */
+static Bool fused_level(Sort *sort, int level) {
+    if ((sort->fuse <= 1) || (level == 0) || (level == sort->n_levels - 1)) {
+        return FALSE;
+    }
+    return (level % sort->fuse != 0) ? TRUE : FALSE;
+}
+
+/**
+ * Estimates the cost of a task from the number of elements it processes and
+ * the algorithm used to solve it.
+ * @param  sort       Pointer to the sort structure.
+ * @param  level      Level of the algorithm.
+ * @param  part       Part inside the level.
+ * @return            Estimated cost of the task.
+ */
+static double task_cost(Sort *sort, int level, int part) {
+    double n = sort->tasks[level][part].end - sort->tasks[level][part].ini;
+
+    /* Top-k merges only keep k elements of each part. */
+    if (sort->top_k > 0) {
+        return (level == 0) ? n : 2.0 * MIN(n, sort->top_k);
+    }
+
+    /* Strings are sorted by radix, and their merges compare each byte once.
+    Set operations go once over their parts, and then only join results. */
+    if ((sort->strings) || (sort->operation != SET_NONE)) {
+        return n;
+    }
+
+    if (level == 0) {
+        /* Natural runs are merged; otherwise, bubble-sort. */
+        return sort->natural ? n * MAX(1, compute_log((int)n)) : n * n / 2;
+    }
+
+    /* Fused levels do nothing, and the others merge all the runs below. */
+    if ((sort->fuse > 1) && (!(sort->aggregate))) {
+        if (fused_level(sort, level)) {
+            return 0;
+        }
+        return n * (level - ((level - 1) / sort->fuse) * sort->fuse);
+    }
+
+    return n;
+}
+
+Status init_priorities(Sort *sort) {
+    double blevel[MAX_LEVELS][MAX_PARTS];
+    double max = 0;
+    long range;
+    int level, part;
+
+    if (!(sort)) {
+        return ERROR;
+    }
+
+    /* The priority of a task is the cost of the longest path from it to the
+    end of the algorithm, which in a tree is its own cost plus the cost of
+    all the merges above it. */
+    for (level = sort->n_levels - 1; level >= 0; level--) {
+        for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+            blevel[level][part] = task_cost(sort, level, part);
+            if (level < sort->n_levels - 1) {
+                blevel[level][part] += blevel[level + 1][part / 2];
+            }
+            max = MAX(max, blevel[level][part]);
+        }
+    }
+
+    /* The costs are scaled to the priorities of the message queues, leaving
+    out 0. */
+    range = sysconf(_SC_MQ_PRIO_MAX);
+    if (range < 32) {
+        range = 32;
+    }
+    for (level = 0; level < sort->n_levels; level++) {
+        for (part = 0; part < get_number_parts(level, sort->n_levels); part++) {
+            sort->tasks[level][part].priority = (max > 0) ? \
+                1 + (int)((range - 2) * (blevel[level][part] / max)) : 1;
+        }
+    }
+
+    return OK;
+}
+
+Bool check_task_ready(Sort *sort, int level, int part) {
+    if (!(sort)) {
+        return FALSE;
+    }
+
+    if ((level < 0) || (level >= sort->n_levels) \
+        || (part < 0) || (part >= get_number_parts(level, sort->n_levels))) {
+        return FALSE;
+    }
+
+    if (sort->tasks[level][part].completed != INCOMPLETE) {
+        return FALSE;
+    }
+
+    /* The tasks of the first level are always ready. */
+    if (level == 0) {
+        return TRUE;
+    }
+
+    /* Other tasks depend on the hierarchy. */
+    if ((sort->tasks[level - 1][2 * part].completed == COMPLETED) && \
+        (sort->tasks[level - 1][2 * part + 1].completed == COMPLETED)) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ * Solves a task of the aggregation mode, leaving at the beginning of its range
+ * the (key, count) groups of its elements.
+ * @param  sort       Pointer to the sort structure.
+ * @param  level      Level of the algorithm.
+ * @param  part       Part inside the level.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+static Status solve_group_task(Sort *sort, int level, int part) {
+    Task *task = &sort->tasks[level][part];
+    Task *left, *right;
+    Status status;
+
+    /* In the first level the part is sorted and then collapsed. */
+    if (task->mid == NO_MID) {
+        if (task->end == task->ini) {
+            task->size = 0;
+            return OK;
+        }
+        if (sort->natural) {
+            status = natural_sort(sort->data + task->ini, task->end - task->ini, sort->delay);
+        }
+        else {
+            status = bubble_sort(sort->data + task->ini, task->end - task->ini, sort->delay);
+        }
+        if (status == ERROR) {
+            return ERROR;
+        }
+        return group_count(sort->data + task->ini, sort->counts + task->ini, \
+                           task->end - task->ini, &task->size, sort->delay);
+    }
+
+    /* In other levels only the groups of both halves are merged. */
+    left = &sort->tasks[level - 1][2 * part];
+    right = &sort->tasks[level - 1][2 * part + 1];
+    return merge_groups(sort->data + task->ini, sort->counts + task->ini, \
+                        task->mid - task->ini, left->size, right->size, \
+                        &task->size, sort->delay);
+}
+
+/**
+ * Solves a task of a set operation. In the first level the operation is
+ * applied to the ranges of both inputs of the part, and in the others the
+ * results of both halves are joined at the beginning of the range.
+ * @param  sort       Pointer to the sort structure.
+ * @param  level      Level of the algorithm.
+ * @param  part       Part inside the level.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+static Status solve_set_task(Sort *sort, int level, int part) {
+    Task *task = &sort->tasks[level][part];
+    Task *left, *right;
+
+    if (level == 0) {
+        return set_operation(sort->data + task->ini, sort->counts + task->ini, \
+                             task->mid - task->ini, task->end - task->ini, \
+                             sort->operation, &task->size, sort->delay);
+    }
+
+    /* The parts hold consecutive ranges of keys, so their results only have
+    to be put together. */
+    left = &sort->tasks[level - 1][2 * part];
+    right = &sort->tasks[level - 1][2 * part + 1];
+    memmove(sort->data + task->ini + left->size, sort->data + task->mid, \
+            right->size * sizeof(int));
+    if (sort->operation == SET_JOIN) {
+        memmove(sort->counts + task->ini + left->size, sort->counts + task->mid, \
+                right->size * sizeof(int));
+    }
+    task->size = left->size + right->size;
+
+    return OK;
+}
+
+/**
+ * Solves a task with compressed runs. Every level but the last one leaves
+ * its result compressed, and the merges decode their parts on the fly.
+ * @param  sort       Pointer to the sort structure.
+ * @param  level      Level of the algorithm.
+ * @param  part       Part inside the level.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+static Status solve_packed_task(Sort *sort, int level, int part) {
+    Task *task = &sort->tasks[level][part];
+    Bool pack = (level < sort->n_levels - 1) ? TRUE : FALSE;
+    Status status;
+
+    if (task->mid == NO_MID) {
+        status = bubble_sort(sort->data + task->ini, task->end - task->ini, sort->delay);
+        task->packed = ((status == OK) && (pack)) ? pack_run(sort->data + task->ini, task->end - task->ini) : 0;
+        return status;
+    }
+
+    return merge_packed(sort->data + task->ini, task->mid - task->ini, \
+                        sort->tasks[level - 1][2 * part].packed, \
+                        sort->tasks[level - 1][2 * part + 1].packed, \
+                        task->end - task->ini, pack, &task->packed, sort->delay);
+}
+
+/**
+ * Solves a merge task when several levels are fused, merging at once all the
+ * parts of the last level actually merged below it.
+ * @param  sort       Pointer to the sort structure.
+ * @param  level      Level of the algorithm.
+ * @param  part       Part inside the level.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+static Status solve_fused_task(Sort *sort, int level, int part) {
+    Task *task = &sort->tasks[level][part];
+    int bounds[MAX_WAYS + 1];
+    int first, n_runs, r;
+
+    if (fused_level(sort, level)) {
+        return OK;
+    }
+
+    first = ((level - 1) / sort->fuse) * sort->fuse;
+    n_runs = 1 << (level - first);
+    for (r = 0; r < n_runs; r++) {
+        bounds[r] = sort->tasks[first][part * n_runs + r].ini - task->ini;
+    }
+    bounds[n_runs] = task->end - task->ini;
+
+    return merge_runs_index(sort->data + task->ini, \
+                            sort->stable ? sort->index + task->ini : NULL, \
+                            bounds, n_runs, sort->delay);
+}
+
+/**
+ * Returns where the merge of a level publishes its progress: only the last
+ * level, whose only task covers the whole data, does it.
+ * @param  sort   Pointer to the sort structure.
+ * @param  level  Level of the algorithm.
+ * @return        Counter of merged elements, NULL for other levels.
+ */
+static int *final_merge(Sort *sort, int level) {
+    return (level == sort->n_levels - 1) ? &sort->merged : NULL;
+}
+
+Status solve_task(Sort *sort, int level, int part) {
+    /* Set operations do not sort: their inputs are already sorted. */
+    if (sort->operation != SET_NONE) {
+        return solve_set_task(sort, level, part);
+    }
+
+    /* In the aggregation mode the data shrinks as it goes up the tree. */
+    if (sort->aggregate) {
+        return solve_group_task(sort, level, part);
+    }
+
+    /* In the string mode the keys are only reached through their positions. */
+    if (sort->strings) {
+        if (sort->tasks[level][part].mid == NO_MID) {
+            return string_sort(\
+                sort->data + sort->tasks[level][part].ini, \
+                sort->index + sort->tasks[level][part].ini, \
+                sort->lcp + sort->tasks[level][part].ini, \
+                sort->tasks[level][part].end - sort->tasks[level][part].ini, \
+                sort->delay);
+        }
+        return merge_strings(\
+            sort->data + sort->tasks[level][part].ini, \
+            sort->index + sort->tasks[level][part].ini, \
+            sort->lcp + sort->tasks[level][part].ini, \
+            sort->tasks[level][part].mid - sort->tasks[level][part].ini, \
+            sort->tasks[level][part].end - sort->tasks[level][part].ini, \
+            sort->delay);
+    }
+
+    /* With fused levels, only some levels merge, each one several runs. */
+    if ((sort->fuse > 1) && (sort->tasks[level][part].mid != NO_MID)) {
+        return solve_fused_task(sort, level, part);
+    }
+
+    /* In top-k queries, each part only keeps its k smallest elements. */
+    if (sort->top_k > 0) {
+        if (sort->tasks[level][part].mid == NO_MID) {
+            return select_k(\
+                sort->data + sort->tasks[level][part].ini, \
+                sort->tasks[level][part].end - sort->tasks[level][part].ini, \
+                sort->top_k, sort->delay);
+        }
+        return merge_k(\
+            sort->data + sort->tasks[level][part].ini, \
+            sort->tasks[level][part].mid - sort->tasks[level][part].ini, \
+            sort->tasks[level][part].end - sort->tasks[level][part].ini, \
+            sort->top_k, sort->delay);
+    }
+
+    /* With natural runs, level 0 merges the runs of its part and the upper
+    levels gallop over the parts already in order. */
+    if (sort->natural) {
+        if (sort->tasks[level][part].mid == NO_MID) {
+            return natural_sort(\
+                sort->data + sort->tasks[level][part].ini, \
+                sort->tasks[level][part].end - sort->tasks[level][part].ini, \
+                sort->delay);
+        }
+        return merge_gallop_tracked(\
+            sort->data + sort->tasks[level][part].ini, \
+            sort->tasks[level][part].mid - sort->tasks[level][part].ini, \
+            sort->tasks[level][part].end - sort->tasks[level][part].ini, \
+            final_merge(sort, level), sort->delay);
+    }
+
+    /* In the stable mode, the positions move along with the elements. */
+    if (sort->stable) {
+        if (sort->tasks[level][part].mid == NO_MID) {
+            return bubble_sort_index(\
+                sort->data + sort->tasks[level][part].ini, \
+                sort->index + sort->tasks[level][part].ini, \
+                sort->tasks[level][part].end - sort->tasks[level][part].ini, \
+                sort->delay);
+        }
+        return merge_index(\
+            sort->data + sort->tasks[level][part].ini, \
+            sort->index + sort->tasks[level][part].ini, \
+            sort->tasks[level][part].mid - sort->tasks[level][part].ini, \
+            sort->tasks[level][part].end - sort->tasks[level][part].ini, \
+            sort->delay);
+    }
+
+    /* With compressed runs, the parts are kept compressed between levels. */
+    if (sort->compress) {
+        return solve_packed_task(sort, level, part);
+    }
+
+    /* In the first level, bubble-sort. */
+    if (sort->tasks[level][part].mid == NO_MID) {
+        return bubble_sort(\
+            sort->data + sort->tasks[level][part].ini, \
+            sort->tasks[level][part].end - sort->tasks[level][part].ini, \
+            sort->delay);
+    }
+    /* In other levels, merge. */
+    else {
+        return merge_tracked(\
+            sort->data + sort->tasks[level][part].ini, \
+            sort->tasks[level][part].mid - sort->tasks[level][part].ini, \
+            sort->tasks[level][part].end - sort->tasks[level][part].ini, \
+            final_merge(sort, level), sort->delay);
+    }
+}
+
+/**
+ * Copies the input data of a task. With compressed runs, only the positions
+ * used by both parts of a merge are copied, unless the saved copy already
+ * holds the result of a backup copy of the task.
+ * @param  sort       Pointer to the sort structure.
+ * @param  level      Level of the algorithm.
+ * @param  part       Part inside the level.
+ * @param  to         Destination array.
+ * @param  from       Source array.
+ */
+static void copy_input(Sort *sort, int level, int part, int *to, int *from) {
+    Task *task = &sort->tasks[level][part];
+    Task *left, *right;
+
+    if ((!(sort->compress)) || (task->mid == NO_MID) || (task->backup == COMPLETED)) {
+        memcpy(to + task->ini, from + task->ini, (task->end - task->ini) * sizeof(int));
+        return;
+    }
+
+    left = &sort->tasks[level - 1][2 * part];
+    right = &sort->tasks[level - 1][2 * part + 1];
+    memcpy(to + task->ini, from + task->ini, \
+           ((left->packed > 0) ? left->packed : task->mid - task->ini) * sizeof(int));
+    memcpy(to + task->mid, from + task->mid, \
+           ((right->packed > 0) ? right->packed : task->end - task->mid) * sizeof(int));
+}
+
+/**
+ * Writes a region of a durable structure to disk, from the start of its first
+ * page.
+ * @param  sort    Pointer to the sort structure.
+ * @param  address Start of the region.
+ * @param  bytes   Size of the region.
+ * @return         ERROR in case of error, OK otherwise.
+ */
+static Status persist(Sort *sort, void *address, size_t bytes) {
+    long page;
+    char *start;
+
+    if ((!(sort->durable)) || (bytes == 0)) {
+        return OK;
+    }
+
+    page = sysconf(_SC_PAGESIZE);
+    start = (char *)address - ((size_t)address % page);
+    if (msync(start, (char *)address + bytes - start, MS_SYNC) == -1) {
+        perror("msync");
+        return ERROR;
+    }
+
+    return OK;
+}
+
+/**
+ * Writes the saved copy of the range of a task to disk, if the structure is
+ * durable.
+ * @param  sort    Pointer to the sort structure.
+ * @param  task    Task.
+ * @return         ERROR in case of error, OK otherwise.
+ */
+static Status persist_backup(Sort *sort, Task *task) {
+    size_t bytes = (task->end - task->ini) * sizeof(int);
+
+    if ((persist(sort, sort->backup + task->ini, bytes) == ERROR) || \
+        (persist(sort, sort->backup_counts + task->ini, bytes) == ERROR) || \
+        (persist(sort, sort->backup_index + task->ini, bytes) == ERROR) || \
+        (persist(sort, sort->backup_lcp + task->ini, bytes) == ERROR)) {
+        return ERROR;
+    }
+
+    return OK;
+}
+
+Status persist_task(Sort *sort, int level, int part) {
+    if ((!(sort)) || (level < 0) || (level >= sort->n_levels)) {
+        return ERROR;
+    }
+
+    return persist(sort, &sort->tasks[level][part], sizeof(Task));
+}
+
+Status snapshot_task(Sort *sort, int level, int part) {
+    Task *task;
+
+    if ((!(sort)) || (level < 0) || (level >= sort->n_levels)) {
+        return ERROR;
+    }
+
+    /* Tasks running at the same time have disjoint ranges, so each one can
+    use the same positions of the backup array. Fused levels do not modify
+    the data. */
+    task = &sort->tasks[level][part];
+    if (fused_level(sort, level)) {
+        return OK;
+    }
+    copy_input(sort, level, part, sort->backup, sort->data);
+    if ((sort->aggregate) || (sort->operation == SET_JOIN)) {
+        memcpy(sort->backup_counts + task->ini, sort->counts + task->ini, \
+               (task->end - task->ini) * sizeof(int));
+    }
+    if (sort->stable) {
+        memcpy(sort->backup_index + task->ini, sort->index + task->ini, \
+               (task->end - task->ini) * sizeof(int));
+    }
+    if (sort->strings) {
+        memcpy(sort->backup_lcp + task->ini, sort->lcp + task->ini, \
+               (task->end - task->ini) * sizeof(int));
+    }
+
+    /* After a crash, a task marked as saved must find its copy on disk, and
+    its data can only have changed once the mark is there. */
+    if (persist_backup(sort, task) == ERROR) {
+        return ERROR;
+    }
+    task->saved = TRUE;
+
+    return persist_task(sort, level, part);
+}
+
+Status restore_task(Sort *sort, int level, int part) {
+    Task *task;
+
+    if ((!(sort)) || (level < 0) || (level >= sort->n_levels)) {
+        return ERROR;
+    }
+
+    /* Without a saved copy the data was not modified yet. */
+    task = &sort->tasks[level][part];
+    if (task->saved) {
+        copy_input(sort, level, part, sort->data, sort->backup);
+        if ((sort->aggregate) || (sort->operation == SET_JOIN)) {
+            memcpy(sort->counts + task->ini, sort->backup_counts + task->ini, \
+                   (task->end - task->ini) * sizeof(int));
+        }
+        if (sort->stable) {
+            memcpy(sort->index + task->ini, sort->backup_index + task->ini, \
+                   (task->end - task->ini) * sizeof(int));
+        }
+        if (sort->strings) {
+            memcpy(sort->lcp + task->ini, sort->backup_lcp + task->ini, \
+                   (task->end - task->ini) * sizeof(int));
+        }
+    }
+    task->saved = FALSE;
+    task->owner = 0;
+    task->completed = INCOMPLETE;
+    task->start = 0;
+    task->backup = INCOMPLETE;
+    task->backup_owner = 0;
+    /* The data of a restored final merge is no longer in place. */
+    if (level == sort->n_levels - 1) {
+        sort->merged = 0;
+    }
+
+    return OK;
+}
+
+/**
+ * Copies a range of the arrays of a task between the data and its saved
+ * copy, in the structures given, in the modes that use each array.
+ * @param  sort       Pointer to the sort structure with the parameters.
+ * @param  task       Task whose range is copied.
+ * @param  data       Destination of the data.
+ * @param  index      Destination of the positions.
+ * @param  lcp        Destination of the common prefixes.
+ * @param  from_data  Source of the data.
+ * @param  from_index Source of the positions.
+ * @param  from_lcp   Source of the common prefixes.
+ */
+static void copy_range(Sort *sort, Task *task, int *data, int *index, int *lcp, \
+                       int *from_data, int *from_index, int *from_lcp) {
+    size_t n = (task->end - task->ini) * sizeof(int);
+
+    memcpy(data + task->ini, from_data + task->ini, n);
+    if (sort->stable) {
+        memcpy(index + task->ini, from_index + task->ini, n);
+    }
+    if (sort->strings) {
+        memcpy(lcp + task->ini, from_lcp + task->ini, n);
+    }
+}
+
+Status speculate_task(Sort *sort, int level, int part, Sort *copy) {
+    Task *task;
+
+    if ((!(sort)) || (!(copy)) || (level < 0) || (level >= sort->n_levels) || \
+        (sort->aggregate) || (sort->operation != SET_NONE)) {
+        return ERROR;
+    }
+
+    task = &sort->tasks[level][part];
+    if (!(task->saved)) {
+        return ERROR;
+    }
+
+    /* Only the parameters used to solve a task are copied, and the bounds of
+    the tasks do not change once the structure is initialized. */
+    copy->delay = sort->delay;
+    copy->n_elements = sort->n_elements;
+    copy->n_levels = sort->n_levels;
+    copy->n_processes = sort->n_processes;
+    copy->top_k = sort->top_k;
+    copy->natural = sort->natural;
+    copy->aggregate = sort->aggregate;
+    copy->stable = sort->stable;
+    copy->strings = sort->strings;
+    copy->operation = sort->operation;
+    copy->compress = sort->compress;
+    copy->fuse = sort->fuse;
+    copy->durable = FALSE;
+    copy->merged = 0;
+    memcpy(copy->tasks, sort->tasks, sizeof(sort->tasks));
+    copy_range(sort, task, copy->data, copy->index, copy->lcp, \
+               sort->backup, sort->backup_index, sort->backup_lcp);
+
+    return solve_task(copy, level, part);
+}
+
+Status commit_speculation(Sort *sort, int level, int part, Sort *copy) {
+    if ((!(sort)) || (!(copy)) || (level < 0) || (level >= sort->n_levels)) {
+        return ERROR;
+    }
+
+    copy_range(sort, &sort->tasks[level][part], sort->backup, sort->backup_index, \
+               sort->backup_lcp, copy->data, copy->index, copy->lcp);
+    sort->tasks[level][part].packed = copy->tasks[level][part].packed;
+
+    return persist_backup(sort, &sort->tasks[level][part]);
 }
 
 Status sort_single_process(char *file_name, int n_levels, int n_processes, int delay) {
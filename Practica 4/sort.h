@@ -3,6 +3,7 @@
 
 #include <mqueue.h>
 #include <semaphore.h>
+#include <stdio.h>
 #include <sys/types.h>
 #include "global.h"
 
@@ -14,6 +15,17 @@
 
 #define PLOT_PERIOD 1
 #define NO_MID -1
+#define MIN_GALLOP 7
+#define MAX_WAYS 64
+#define MAX_FUSE 6
+#define PREFETCH_DISTANCE 64
+#define MIN_RADIX 32
+#define RADIX_BUCKETS 65536
+#define PACK_BLOCK 128
+
+/* Bucket of the first radix digit of a string, its first two bytes, from the
+prefix of its key stored in the data. */
+#define RADIX_BUCKET(prefix) (((unsigned int)(prefix) ^ 0x80000000U) >> 16)
 
 /* Type definitions. */
 
@@ -25,22 +37,83 @@ typedef enum {
     COMPLETED
 } Completed;
 
+/* Returns the key of the element originally at a position, and its length in
+length, for the string mode. */
+typedef char *(*StringKey)(void *context, int position, int *length);
+
+/* Operation between two sorted inputs. The results are sets of keys, except
+for the join, in which each key has the number of pairs of equal elements. */
+typedef enum {
+    SET_NONE,
+    SET_UNION,
+    SET_INTERSECT,
+    SET_EXCEPT,
+    SET_JOIN
+} SetOperation;
+
 /* Task. */
 typedef struct {
     Completed completed;
     int ini;
     int mid;
     int end;
+    pid_t owner;
+    Bool saved;
+    int size;
+    int priority;
+    long start;
+    long elapsed;
+    Completed backup;
+    pid_t backup_owner;
+    int packed;
 } Task;
 
-/* Structure for the sorting problem. */
+/* Verification of a range of the result. */
+typedef struct {
+    Completed completed;
+    pid_t owner;
+    Bool sorted;
+    unsigned long long hash;
+} Check;
+
+/* Structure for the sorting problem. The data goes first, so that a result
+published from the structure itself is already at the start of it. The tasks
+sent or in progress (pending), the tasks sent and not yet taken (queued), the
+leaves not yet sent and the time of the finished ones are counted as their
+states change, so that they need not be recounted on every send. */
 typedef struct{
-    Task tasks[MAX_LEVELS][MAX_PARTS];
     int data[MAX_DATA];
+    Task tasks[MAX_LEVELS][MAX_PARTS];
+    int backup[MAX_DATA];
+    int counts[MAX_DATA];
+    int backup_counts[MAX_DATA];
+    int index[MAX_DATA];
+    int backup_index[MAX_DATA];
+    int lcp[MAX_DATA];
+    int backup_lcp[MAX_DATA];
     int delay;
     int n_elements;
     int n_levels;
     int n_processes;
+    int top_k;
+    Bool natural;
+    Bool aggregate;
+    Bool stable;
+    Bool strings;
+    SetOperation operation;
+    Bool compress;
+    Bool verify;
+    Bool durable;
+    unsigned long long checksum;
+    Check checks[MAX_PARTS];
+    int merged;
+    int fuse;
+    int active;
+    int pending;
+    int queued;
+    int leaves_left;
+    int leaves_timed;
+    long leaves_ns;
     pid_t ppid;
 } Sort;
 
@@ -59,7 +132,8 @@ typedef struct{
 Status bubble_sort(int *vector, int n_elements, int delay);
 
 /**
- * Merges two ordered parts of an array keeping the global order.
+ * Merges two ordered parts of an array keeping the global order. Equal
+ * elements keep their order.
  * @method merge
  * @date   2020-04-09
  * @author Teaching team of SOPER
@@ -71,6 +145,252 @@ Status bubble_sort(int *vector, int n_elements, int delay);
  */
 Status merge(int *vector, int middle, int n_elements, int delay);
 
+/**
+ * Sorts an array using bubble-sort, moving the original position of each
+ * element along with it. Equal elements keep their order.
+ * @method bubble_sort_index
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector      Array with the data.
+ * @param  index       Array with the positions of the data.
+ * @param  n_elements  Number of elements in the arrays.
+ * @param  delay       Delay for the algorithm.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status bubble_sort_index(int *vector, int *index, int n_elements, int delay);
+
+/**
+ * Merges two ordered parts of an array keeping the global order, moving the
+ * original position of each element along with it. Equal elements keep their
+ * order.
+ * @method merge_index
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector     Array with the data.
+ * @param  index      Array with the positions of the data.
+ * @param  middle     Division between the first and second parts.
+ * @param  n_elements Number of elements in the arrays.
+ * @param  delay      Delay for the algorithm.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status merge_index(int *vector, int *index, int middle, int n_elements, int delay);
+
+/**
+ * Merges two ordered parts of an array keeping the global order, skipping the
+ * elements already in place and copying long streaks of one part at once
+ * (galloping). Equal elements keep their order.
+ * @method merge_gallop
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector     Array with the data.
+ * @param  middle     Division between the first and second parts.
+ * @param  n_elements Number of elements in the array.
+ * @param  delay      Delay for the algorithm.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status merge_gallop(int *vector, int middle, int n_elements, int delay);
+
+/**
+ * Sorts an array merging its natural ascending runs, in linear time if the
+ * array is already sorted.
+ * @method natural_sort
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector      Array with the data.
+ * @param  n_elements  Number of elements in the array.
+ * @param  delay       Delay for the algorithm.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status natural_sort(int *vector, int n_elements, int delay);
+
+/**
+ * Leaves the k smallest elements of an array sorted at its beginning, using
+ * quickselect with a three-way partition followed by a sort of those k
+ * elements. An empty array is left as it is.
+ * @method select_k
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector      Array with the data.
+ * @param  n_elements  Number of elements in the array.
+ * @param  k           Number of elements to keep.
+ * @param  delay       Delay for the algorithm.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status select_k(int *vector, int n_elements, int k, int delay);
+
+/**
+ * Merges the k smallest elements of two parts of an array, each of them with
+ * its own k smallest elements sorted at its beginning, leaving the result at
+ * the beginning of the array. Only those k elements are merged, in linear
+ * time. If one of the parts is empty, the array is left as it is.
+ * @method merge_k
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector     Array with the data.
+ * @param  middle     Division between the first and second parts.
+ * @param  n_elements Number of elements in the array.
+ * @param  k          Number of elements to keep.
+ * @param  delay      Delay for the algorithm.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status merge_k(int *vector, int middle, int n_elements, int k, int delay);
+
+/**
+ * Merges several consecutive ordered runs of an array at once with a tree of
+ * losers, reading and writing the data a single time instead of once per
+ * level of binary merges. Equal elements keep their order.
+ * @method merge_runs
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector     Array with the data.
+ * @param  bounds     Start of each run and end of the last one (n_runs + 1
+ *                    positions, relative to vector).
+ * @param  n_runs     Number of runs, at most MAX_WAYS.
+ * @param  delay      Delay for the algorithm.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status merge_runs(int *vector, int *bounds, int n_runs, int delay);
+
+/**
+ * Merges several consecutive ordered runs of an array at once as merge_runs,
+ * moving the original position of each element along with it.
+ * @method merge_runs_index
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector     Array with the data.
+ * @param  index      Array with the positions of the data, or NULL.
+ * @param  bounds     Start of each run and end of the last one (n_runs + 1
+ *                    positions, relative to vector).
+ * @param  n_runs     Number of runs, at most MAX_WAYS.
+ * @param  delay      Delay for the algorithm.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status merge_runs_index(int *vector, int *index, int *bounds, int n_runs, int delay);
+
+/**
+ * Sorts the elements of an array by the strings registered with init_strings,
+ * with a most significant digit radix sort that reads 8 bytes of the keys per
+ * digit, and stores the longest common prefix of each element with the
+ * previous one. Equal keys keep their order.
+ * @method string_sort
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector      Array with the prefixes of the keys.
+ * @param  index       Array with the positions of the keys.
+ * @param  lcp         Array where the longest common prefixes are stored.
+ * @param  n_elements  Number of elements in the arrays.
+ * @param  delay       Delay for the algorithm.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status string_sort(int *vector, int *index, int *lcp, int n_elements, int delay);
+
+/**
+ * Merges two parts of an array sorted by the strings registered with
+ * init_strings, using the longest common prefixes of their elements so that
+ * the keys are only compared from the first byte that may differ. Equal keys
+ * keep their order.
+ * @method merge_strings
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector     Array with the prefixes of the keys.
+ * @param  index      Array with the positions of the keys.
+ * @param  lcp        Array with the longest common prefixes of each part.
+ * @param  middle     Division between the first and second parts.
+ * @param  n_elements Number of elements in the arrays.
+ * @param  delay      Delay for the algorithm.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status merge_strings(int *vector, int *index, int *lcp, int middle, int n_elements, int delay);
+
+/**
+ * Collapses the equal elements of a sorted array into (key, count) groups,
+ * leaving the keys at the beginning of the array and their counts at the
+ * beginning of counts.
+ * @method group_count
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector      Sorted array with the data.
+ * @param  counts      Array where the counts are stored.
+ * @param  n_elements  Number of elements in the array.
+ * @param  n_groups    Where the number of groups is stored.
+ * @param  delay       Delay for the algorithm.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status group_count(int *vector, int *counts, int n_elements, int *n_groups, int delay);
+
+/**
+ * Merges two sorted lists of (key, count) groups, stored at the beginning of
+ * each part of an array, adding the counts of equal keys. The result is left
+ * at the beginning of the array.
+ * @method merge_groups
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector     Array with the keys.
+ * @param  counts     Array with the counts.
+ * @param  middle     Division between the first and second parts.
+ * @param  n_left     Number of groups of the first part.
+ * @param  n_right    Number of groups of the second part.
+ * @param  n_groups   Where the number of groups of the result is stored.
+ * @param  delay      Delay for the algorithm.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status merge_groups(int *vector, int *counts, int middle, int n_left, int n_right, int *n_groups, int delay);
+
+/**
+ * Applies a set operation to two sorted parts of an array, leaving the result
+ * at the beginning of the array (and the number of pairs of each key of a
+ * join at the beginning of counts). Fails if a key of a join has more pairs
+ * than fit in an int.
+ * @method set_operation
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector     Array with the data.
+ * @param  counts     Array where the counts of a join are stored.
+ * @param  middle     Division between the first and second parts.
+ * @param  n_elements Number of elements in the array.
+ * @param  operation  Operation to apply.
+ * @param  n_results  Where the number of results is stored.
+ * @param  delay      Delay for the algorithm.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status set_operation(int *vector, int *counts, int middle, int n_elements, SetOperation operation, int *n_results, int delay);
+
+/**
+ * Compresses a sorted array in place with frame of reference: each block of
+ * PACK_BLOCK keys is stored as its first key, the number of bits of the
+ * largest difference with it and the differences packed with those bits.
+ * The array is kept as it is if a block would overwrite keys not packed yet.
+ * @method pack_run
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector      Array with the data, sorted.
+ * @param  n_elements  Number of elements in the array.
+ * @return             The number of positions of the array used by the
+ *                     compressed keys, 0 if they are not compressed.
+ */
+int pack_run(int *vector, int n_elements);
+
+/**
+ * Merges two sorted parts of an array, each of them compressed by pack_run or
+ * not, decoding their blocks as the merge reaches them. The result is
+ * compressed block by block as it is produced if requested, and left
+ * uncompressed if a block does not fit in the array.
+ * @method merge_packed
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector       Array with the data.
+ * @param  middle       Division between the first and second parts, in keys.
+ * @param  packed_left  Positions used by the first part, 0 if not compressed.
+ * @param  packed_right Positions used by the second part, 0 if not compressed.
+ * @param  n_elements   Number of elements in the array.
+ * @param  pack         TRUE to compress the result.
+ * @param  packed       Where the positions used by the result are stored, 0
+ *                      if it is not compressed.
+ * @param  delay        Delay for the algorithm.
+ * @return              ERROR in case of error, OK otherwise.
+ */
+Status merge_packed(int *vector, int middle, int packed_left, int packed_right, int n_elements, Bool pack, int *packed, int delay);
+
 /**
  * Computes the number of parts (division) for a certain level of the sorting
  * algorithm.
@@ -97,6 +417,221 @@ int get_number_parts(int level, int n_levels);
  */
 Status init_sort(char *file_name, Sort *sort, int n_levels, int n_processes, int delay);
 
+/**
+ * Initializes the sort structure reading only the header of an already open
+ * data file, so that the task tree is ready before the data arrives.
+ * @method init_sort_stream
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  file        Open data file, positioned at its first line.
+ * @param  sort        Pointer to the sort structure.
+ * @param  n_levels    Total number of levels in the algorithm.
+ * @param  n_processes Number of processes.
+ * @param  delay       Delay for the algorithm.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status init_sort_stream(FILE *file, Sort *sort, int n_levels, int n_processes, int delay);
+
+/**
+ * Reads the next elements of a data file into a range of the sort structure.
+ * @method read_sort_data
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  file        Open data file, positioned at element ini.
+ * @param  sort        Pointer to the sort structure.
+ * @param  ini         First position to read.
+ * @param  end         Position after the last one to read.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status read_sort_data(FILE *file, Sort *sort, int ini, int end);
+
+/**
+ * Initializes the sort structure from data already in memory.
+ * @method init_sort_data
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  data        Array with the data to be sorted.
+ * @param  n_elements  Number of elements in the array.
+ * @param  sort        Pointer to the sort structure.
+ * @param  n_levels    Total number of levels in the algorithm.
+ * @param  n_processes Number of processes.
+ * @param  delay       Delay for the algorithm.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status init_sort_data(int *data, int n_elements, Sort *sort, int n_levels, int n_processes, int delay);
+
+/**
+ * Reads a data file, mapping it in memory and parsing it in place. Fails if
+ * the file has more than max_elements elements.
+ * @method read_run
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  file_name    File with the data.
+ * @param  data         Array where the elements are stored.
+ * @param  max_elements Maximum number of elements to read.
+ * @param  n_elements   Where the number of elements read is stored.
+ * @return              ERROR in case of error, OK otherwise.
+ */
+Status read_run(char *file_name, int *data, int max_elements, int *n_elements);
+
+/**
+ * Initializes the sort structure to merge several sorted runs already stored
+ * one after another in the data, without sorting them: each run is a part of
+ * level 0, which is marked as completed, and the number of levels is the
+ * least with enough parts.
+ * @method init_sort_runs
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort        Pointer to the sort structure, with the data loaded.
+ * @param  bounds      Start of each run and end of the last one (n_runs + 1
+ *                     positions).
+ * @param  n_runs      Number of runs.
+ * @param  n_processes Number of processes.
+ * @param  delay       Delay for the algorithm.
+ * @return             ERROR in case of error or if a run is not sorted, OK
+ *                     otherwise.
+ */
+Status init_sort_runs(Sort *sort, int *bounds, int n_runs, int n_processes, int delay);
+
+/**
+ * Initializes the sort structure to apply a set operation to two sorted inputs
+ * stored one after the other in the data. Both inputs are split by the same
+ * keys, taken at equal distances of their merge, and each part of level 0
+ * holds its range of the first input followed by its range of the second one.
+ * The upper levels join the results of the parts.
+ * @method init_set_operation
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort        Pointer to the sort structure, with the data loaded.
+ * @param  n_a         Number of elements of the first input.
+ * @param  n_b         Number of elements of the second input.
+ * @param  operation   Operation to apply.
+ * @param  n_levels    Total number of levels in the algorithm.
+ * @param  n_processes Number of processes.
+ * @param  delay       Delay for the algorithm.
+ * @return             ERROR in case of error or if an input is not sorted,
+ *                     OK otherwise.
+ */
+Status init_set_operation(Sort *sort, int n_a, int n_b, SetOperation operation, int n_levels, int n_processes, int delay);
+
+/**
+ * Detects the natural runs of the data, reversing the descending ones, and
+ * moves the boundaries of the first level to the starts of the runs so that
+ * the task tree is built over them.
+ * @method init_natural_runs
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort        Pointer to the sort structure, with the data loaded.
+ * @param  n_runs      Where the number of runs found is stored.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status init_natural_runs(Sort *sort, int *n_runs);
+
+/**
+ * Sets the stable mode, in which the original position of each element is
+ * moved along with it, so that the positions end as the sorting permutation
+ * (argsort) of the data.
+ * @method init_stable
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort        Pointer to the sort structure.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status init_stable(Sort *sort);
+
+/**
+ * Sets the string mode, a stable mode in which the elements are sorted by byte
+ * strings obtained from their positions, with the first 4 bytes of each one as
+ * its data. The data is distributed by its first two bytes and the parts of
+ * level 0 are moved to the limits of those buckets, so that most merges find
+ * their parts already in order. The keys must be registered before the
+ * workers are created.
+ * @method init_strings
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort        Pointer to the sort structure, with the data loaded.
+ * @param  key         Function returning the key of a position.
+ * @param  context     First argument of key.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status init_strings(Sort *sort, StringKey key, void *context);
+
+/**
+ * Adds a range of the input data to the checksum of the verification. The
+ * checksum is a sum of a hash of each element, so it does not depend on the
+ * order and the input can be added in any number of ranges.
+ * @method checksum_input
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort        Pointer to the sort structure.
+ * @param  ini         First position of the range.
+ * @param  end         Position after the last one of the range.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status checksum_input(Sort *sort, int ini, int end);
+
+/**
+ * Computes the order-independent hash of a multiset of elements, each one
+ * with a number of copies.
+ * @method multiset_hash
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  vector      Array with the elements.
+ * @param  counts      Number of copies of each element, NULL for one each.
+ * @param  n_elements  Number of elements in the array.
+ * @return             The hash.
+ */
+unsigned long long multiset_hash(int *vector, int *counts, int n_elements);
+
+/**
+ * Returns the number of ranges into which the result is divided to verify
+ * it, one for each part of level 0.
+ * @method get_number_checks
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort       Pointer to the sort structure.
+ * @return            Number of ranges.
+ */
+int get_number_checks(Sort *sort);
+
+/**
+ * Verifies a range of the result of a solved problem: checks that it is
+ * sorted, also against the last element of the previous range (strictly for
+ * the groups of the aggregation mode), and computes the hash of its elements.
+ * @method verify_part
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort       Pointer to the sort structure.
+ * @param  part       Range to verify.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status verify_part(Sort *sort, int part);
+
+/**
+ * Returns the number of (key, count) groups of a solved problem in the
+ * aggregation mode, or of results of a set operation, which are at the
+ * beginning of data (and counts).
+ * @method get_number_groups
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort       Pointer to the sort structure.
+ * @return            Number of groups.
+ */
+int get_number_groups(Sort *sort);
+
+/**
+ * Computes the priority of every task as its estimated cost plus the cost of
+ * the merges that depend on it (the critical path to the end), scaled to the
+ * priorities of the message queues, so that the tasks that delay the end of
+ * the algorithm the most are solved first.
+ * @method init_priorities
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort       Pointer to the sort structure, with all its options set.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status init_priorities(Sort *sort);
+
 /**
  * Checks if a task is ready to be solved.
  * @method check_task_ready
@@ -121,6 +656,78 @@ Bool check_task_ready(Sort *sort, int level, int part);
  */
 Status solve_task(Sort *sort, int level, int part);
 
+/**
+ * Saves a copy of the input range of a task, so that it can be solved again if
+ * the process solving it dies in the middle of an in-place merge. If the
+ * structure is durable (mapped from a file), the copy reaches the disk before
+ * the task is marked as saved, and the mark before the data is modified.
+ * @method snapshot_task
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort       Pointer to the sort structure.
+ * @param  level      Level of the algorithm.
+ * @param  part       Part inside the level.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status snapshot_task(Sort *sort, int level, int part);
+
+/**
+ * Restores the input range of a task from its saved copy, if any, and marks
+ * the task as incomplete.
+ * @method restore_task
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort       Pointer to the sort structure.
+ * @param  level      Level of the algorithm.
+ * @param  part       Part inside the level.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status restore_task(Sort *sort, int level, int part);
+
+/**
+ * Solves a backup copy of a task in a private structure, from the saved copy
+ * of its input range, while the original copy goes on in the shared data.
+ * Only valid in the modes in which a task writes nothing but its range.
+ * @method speculate_task
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort       Pointer to the sort structure.
+ * @param  level      Level of the algorithm.
+ * @param  part       Part inside the level.
+ * @param  copy       Private sort structure where the copy is solved.
+ * @return            ERROR in case of error or if the task has no saved copy,
+ *                    OK otherwise.
+ */
+Status speculate_task(Sort *sort, int level, int part, Sort *copy);
+
+/**
+ * Writes the result of a backup copy over the saved copy of the task, so that
+ * restore_task puts it in the data once the original copy has been stopped.
+ * If the structure is durable, the result reaches the disk before returning.
+ * @method commit_speculation
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort       Pointer to the sort structure.
+ * @param  level      Level of the algorithm.
+ * @param  part       Part inside the level.
+ * @param  copy       Private sort structure where the copy was solved.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status commit_speculation(Sort *sort, int level, int part, Sort *copy);
+
+/**
+ * Writes the state of a task to disk if the structure is durable, after the
+ * data it refers to.
+ * @method persist_task
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  sort       Pointer to the sort structure.
+ * @param  level      Level of the algorithm.
+ * @param  part       Part inside the level.
+ * @return            ERROR in case of error, OK otherwise.
+ */
+Status persist_task(Sort *sort, int level, int part);
+
 /**
  * Solves a sorting problem using a single process.
  * @method sort_single_process
@@ -0,0 +1,170 @@
+/**
+ * @file sort_client.c
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Cliente del servicio de ordenación persistente. Envía una petición con el
+ * fichero de datos (o un segmento de memoria compartida con el prefijo "shm:")
+ * a la cola del servicio y espera en una cola propia la notificación de
+ * finalización, mostrando el tiempo que ha tardado el servicio en resolverla.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <mqueue.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "daemon.h"
+#include "global.h"
+
+
+/**
+ * Copia una ruta en destino convirtiéndola en absoluta, ya que el servicio no
+ * comparte el directorio de trabajo del cliente.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param dest  Buffer de destino de tamaño MAX_PATH.
+ * @param path  Ruta indicada por el usuario.
+ * @return  OK si la ruta cabe en el buffer, ERROR en caso contrario.
+ */
+Status ruta_absoluta(char *dest, char *path) {
+    char cwd[PATH_MAX];
+    int len;
+
+    if (path[0] == '/') {
+        len = snprintf(dest, MAX_PATH, "%s", path);
+    }
+    else {
+        if (getcwd(cwd, sizeof(cwd)) == NULL) {
+            perror("getcwd");
+            return ERROR;
+        }
+        len = snprintf(dest, MAX_PATH, "%s/%s", cwd, path);
+    }
+
+    if (len >= MAX_PATH) {
+        fprintf(stderr, "%s: path too long\n", path);
+        return ERROR;
+    }
+
+    return OK;
+}
+
+
+/**
+ * Función main. Será la rutina princpal que se ejecutará al comienzo del
+ * programa.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param argc  Número de argumentos de entrada del programa.
+ * @param argv  Puntero a los string de los correspondientes argumentos de
+ *              entrada.
+ * @return  EXIT_SUCCESS si la petición se ha resuelto correctamente.
+ *          EXIT_FAILURE en caso contrario.
+ */
+int main(int argc, char **argv) {
+
+    /* Variables locales */
+    struct mq_attr attributes = {
+        .mq_flags = 0,
+        .mq_maxmsg = 1,
+        .mq_curmsgs = 0,
+        .mq_msgsize = sizeof(Reply)
+    };
+    Request request;
+    Reply reply;
+    mqd_t server, queue;
+
+    /* Comprobamos los arguentos de entrada */
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <FILE | shm:NAME> <N_LEVELS> [<DELAY>] [<OUTPUT>] [<PRIORITY>]\n", argv[0]);
+        fprintf(stderr, "    <FILE> :        Data file\n");
+        fprintf(stderr, "    shm:NAME :      Shared memory segment, sorted in place\n");
+        fprintf(stderr, "    <N_LEVELS> :    Number of levels\n");
+        fprintf(stderr, "    [<DELAY>] :     Delay (ms), 0 by default\n");
+        fprintf(stderr, "    [<OUTPUT>] :    File where the sorted data is written, - for none\n");
+        fprintf(stderr, "    [<PRIORITY>] :  Share of the workers (1 - %d), 1 by default\n", MAX_PRIORITY);
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&request, 0, sizeof(request));
+    request.client = getpid();
+    request.n_levels = atoi(argv[2]);
+    request.delay = (argc > 3) ? 1e6 * atoi(argv[3]) : 0;
+    request.priority = (argc > 5) ? atoi(argv[5]) : 1;
+    snprintf(request.reply, MAX_MQ_NAME, REPLY_MQ_FORMAT, (long)getpid());
+
+    if (!strncmp(argv[1], SHM_PREFIX, strlen(SHM_PREFIX))) {
+        request.source = SOURCE_SHM;
+        snprintf(request.input, MAX_PATH, "%s", argv[1] + strlen(SHM_PREFIX));
+    }
+    else {
+        request.source = SOURCE_FILE;
+        if (ruta_absoluta(request.input, argv[1]) == ERROR)
+            exit(EXIT_FAILURE);
+    }
+
+    if (argc > 4 && strcmp(argv[4], "-") && ruta_absoluta(request.output, argv[4]) == ERROR)
+        exit(EXIT_FAILURE);
+
+    /* Abrimos la cola del servicio y creamos la cola de respuesta */
+    server = mq_open(DAEMON_MQ_NAME, O_WRONLY);
+    if (server == (mqd_t)-1) {
+        perror("mq_open (is sort_daemon running?)");
+        exit(EXIT_FAILURE);
+    }
+
+    queue = mq_open(request.reply, O_CREAT | O_EXCL | O_RDONLY, S_IRUSR | S_IWUSR, &attributes);
+    if (queue == (mqd_t)-1) {
+        perror("mq_open");
+        mq_close(server);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Enviamos la petición y esperamos la notificación */
+    if (mq_send(server, (char*)&request, sizeof(request), 1) == -1) {
+        perror("mq_send");
+        mq_close(server);
+        mq_close(queue);
+        mq_unlink(request.reply);
+        exit(EXIT_FAILURE);
+    }
+    mq_close(server);
+
+    while (mq_receive(queue, (char*)&reply, sizeof(reply), NULL) == -1) {
+        if (errno != EINTR) {
+            perror("mq_receive");
+            mq_close(queue);
+            mq_unlink(request.reply);
+            exit(EXIT_FAILURE);
+        }
+    }
+    mq_close(queue);
+    mq_unlink(request.reply);
+
+    if (reply.status == ERROR) {
+        fprintf(stderr, "Sort daemon could not solve %s\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Sorted %d elements with %d levels in %.3f us\n", reply.n_elements, \
+           reply.n_levels, reply.elapsed_ns / 1e3);
+
+    exit(EXIT_SUCCESS);
+}
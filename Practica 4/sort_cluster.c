@@ -0,0 +1,517 @@
+/**
+ * @file sort_cluster.c
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Coordinador de la ordenación repartida. Lee la entrada, que puede tener más
+ * de MAX_DATA elementos, toma CLUSTER_OVERSAMPLE muestras por nodo y elige
+ * como divisores las muestras que las reparten en partes iguales. Las
+ * muestras y los divisores son pares (valor, posición en la entrada), por lo
+ * que una clave muy repetida también se reparte entre varios nodos. Cada
+ * elemento se envía al nodo de su rango; todos los nodos reciben su rango
+ * antes de leer ninguna respuesta, por lo que ordenan a la vez, y después se
+ * reciben los resultados en el orden de los rangos y se escriben según llegan.
+ * Con --shared cada nodo escribe su rango en un fichero de un directorio
+ * compartido y el coordinador solo recibe la confirmación; los ficheros, en
+ * orden, son el resultado y pueden mezclarse con sort --merge.
+ * Con --local N el coordinador arranca N nodos en localhost con puertos
+ * elegidos por el sistema y los termina al acabar, para probar el protocolo
+ * completo en una sola máquina.
+ * Si un nodo no responde en --timeout segundos, el coordinador lo indica y
+ * termina con error.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <time.h>
+#include <unistd.h>
+#include "aio.h"
+#include "cluster.h"
+#include "global.h"
+#include "sort.h"
+#include "utils.h"
+
+
+/* Constantes */
+#define LOCALHOST "127.0.0.1"
+#define PROCESOS_LOCALES 2
+#define MAX_DIRECCION 64
+
+
+/* Clave de un elemento para repartirlo: su valor y, para desempatar los
+   iguales, su posición en la entrada */
+typedef struct {
+    int valor;
+    int posicion;
+} Clave;
+
+
+/* Variables globales que serán utilizadas por otras rutinas además del main */
+int n_nodos = 0;
+char *nodos[CLUSTER_MAX_NODES];
+char direcciones[CLUSTER_MAX_NODES][MAX_DIRECCION];
+pid_t locales[CLUSTER_MAX_NODES];
+int n_locales = 0;
+int conexiones[CLUSTER_MAX_NODES];
+int *datos = NULL;
+int *repartidos = NULL;
+
+
+/**
+ * Libera todos los recursos y termina los nodos locales.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void freeAll() {
+    int k;
+
+    for (k = 0; k < n_nodos; k++) {
+        if (conexiones[k] != -1)
+            close(conexiones[k]);
+    }
+    for (k = 0; k < n_locales; k++)
+        kill(locales[k], SIGTERM);
+    for (k = 0; k < n_locales; k++)
+        waitpid(locales[k], NULL, 0);
+    free(datos);
+    free(repartidos);
+}
+
+
+/**
+ * Arranca nodos en localhost. Cada uno escucha en un puerto elegido por el
+ * sistema, que se obtiene antes de crearlo, por lo que ya acepta conexiones
+ * cuando el coordinador se conecta.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param n            Número de nodos.
+ * @param n_processes  Procesos de cada nodo.
+ * @return  OK si se han arrancado todos, ERROR en caso contrario.
+ */
+Status arrancar_locales(int n, int n_processes) {
+    struct sockaddr_storage direccion;
+    socklen_t longitud;
+    int listener, puerto;
+    pid_t pid;
+
+    for (n_locales = 0; n_locales < n; n_locales++) {
+        if ((listener = cluster_listen(LOCALHOST, 0)) == -1) {
+            perror("cluster_listen");
+            return ERROR;
+        }
+        longitud = sizeof(direccion);
+        if (getsockname(listener, (struct sockaddr *)&direccion, &longitud) == -1) {
+            perror("getsockname");
+            close(listener);
+            return ERROR;
+        }
+        puerto = ntohs(((struct sockaddr_in *)&direccion)->sin_port);
+
+        if ((pid = fork()) == -1) {
+            perror("fork");
+            close(listener);
+            return ERROR;
+        }
+        if (!pid) {
+            n_locales = 0;
+            n_nodos = 0;
+            exit((cluster_serve(listener, n_processes) == OK) ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        close(listener);
+
+        locales[n_locales] = pid;
+        snprintf(direcciones[n_locales], MAX_DIRECCION, "%s:%d", LOCALHOST, puerto);
+        nodos[n_locales] = direcciones[n_locales];
+    }
+    n_nodos = n;
+
+    return OK;
+}
+
+
+/**
+ * Lee la entrada completa, con el formato de los ficheros de datos.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param fichero     Fichero de datos.
+ * @param n_elements  Donde se guarda el número de elementos.
+ * @return  OK si se ha leído, ERROR en caso contrario.
+ */
+Status leer_entrada(char *fichero, int *n_elements) {
+    char linea[MAX_STRING];
+    FILE *f;
+    int i;
+
+    if ((f = aio_fopen(fichero, "r")) == NULL) {
+        perror(fichero);
+        return ERROR;
+    }
+
+    if (!fgets(linea, MAX_STRING, f) || (*n_elements = atoi(linea)) < 0 || \
+        (datos = malloc(MAX(1, *n_elements) * sizeof(int))) == NULL) {
+        fprintf(stderr, "%s: bad header\n", fichero);
+        fclose(f);
+        return ERROR;
+    }
+    for (i = 0; i < *n_elements; i++) {
+        if (!fgets(linea, MAX_STRING, f)) {
+            fprintf(stderr, "%s: only %d of %d elements\n", fichero, i, *n_elements);
+            fclose(f);
+            return ERROR;
+        }
+        datos[i] = atoi(linea);
+    }
+    fclose(f);
+
+    return OK;
+}
+
+
+/**
+ * Comparador de claves para qsort: por valor y, si son iguales, por posición.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param a  Primera clave.
+ * @param b  Segunda clave.
+ * @return  Negativo, 0 o positivo según el orden.
+ */
+int comparar(const void *a, const void *b) {
+    const Clave *x = a, *y = b;
+
+    if (x->valor != y->valor)
+        return (x->valor > y->valor) - (x->valor < y->valor);
+    return (x->posicion > y->posicion) - (x->posicion < y->posicion);
+}
+
+
+/**
+ * Fase de muestreo: elige los n_nodos - 1 divisores de los rangos entre
+ * muestras tomadas al azar de la entrada.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param n_elements  Número de elementos de la entrada.
+ * @param divisores   Donde se guardan los divisores, en orden.
+ * @return  OK si se han elegido, ERROR en caso contrario.
+ */
+Status muestrear(int n_elements, Clave *divisores) {
+    unsigned int semilla = 1;
+    Clave *muestras;
+    int n_muestras, k;
+
+    if (n_elements == 0 || n_nodos == 1)
+        return OK;
+
+    n_muestras = n_nodos * CLUSTER_OVERSAMPLE;
+    if ((muestras = malloc(n_muestras * sizeof(Clave))) == NULL) {
+        perror("malloc");
+        return ERROR;
+    }
+    for (k = 0; k < n_muestras; k++) {
+        muestras[k].posicion = rand_r(&semilla) % n_elements;
+        muestras[k].valor = datos[muestras[k].posicion];
+    }
+    qsort(muestras, n_muestras, sizeof(Clave), comparar);
+
+    for (k = 1; k < n_nodos; k++)
+        divisores[k - 1] = muestras[k * CLUSTER_OVERSAMPLE];
+    free(muestras);
+
+    return OK;
+}
+
+
+/**
+ * Devuelve el nodo de un elemento: el número de divisores que no son mayores
+ * que su clave. Los elementos iguales se reparten según su posición, y como
+ * los rangos siguen en orden de valor, la concatenación sigue ordenada.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param divisores  Divisores, en orden.
+ * @param posicion   Posición del elemento en la entrada.
+ * @return  Índice del nodo.
+ */
+int buscar_nodo(Clave *divisores, int posicion) {
+    Clave elemento = {datos[posicion], posicion};
+    int low = 0, high = n_nodos - 1, mid;
+
+    while (low < high) {
+        mid = (low + high) / 2;
+        if (comparar(&divisores[mid], &elemento) <= 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+
+/**
+ * Muestra la forma de uso del programa.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param prog  Nombre del programa.
+ */
+void uso(char *prog) {
+    fprintf(stderr, "Usage: %s [OPTIONS] <FILE> <N_LEVELS> [<HOST:PORT>...]\n", prog);
+    fprintf(stderr, "    <FILE> :        Data file\n");
+    fprintf(stderr, "    <N_LEVELS> :    Number of levels in each node\n");
+    fprintf(stderr, "    <HOST:PORT> :   Address of a sort_node\n");
+    fprintf(stderr, "    -o, --output F : Write the sorted data to F\n");
+    fprintf(stderr, "    -s, --shared DIR : Each node writes its range to DIR/part-K.dat\n");
+    fprintf(stderr, "    -l, --local N : Start N nodes on localhost instead (1 - %d)\n", CLUSTER_MAX_NODES);
+    fprintf(stderr, "    -p, --processes N : Processes of each local node, %d by default\n", PROCESOS_LOCALES);
+    fprintf(stderr, "    -d, --delay D : Delay (ms), 0 by default\n");
+    fprintf(stderr, "    -t, --timeout S : Seconds to wait for a node, %d by default, 0 for no limit\n", CLUSTER_TIMEOUT);
+}
+
+
+/**
+ * Función main. Será la rutina princpal que se ejecutará al comienzo del
+ * programa.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param argc  Número de argumentos de entrada del programa.
+ * @param argv  Puntero a los string de los correspondientes argumentos de
+ *              entrada.
+ * @return  EXIT_SUCCESS si la ordenación ha terminado correctamente.
+ *          EXIT_FAILURE en caso contrario.
+ */
+int main(int argc, char **argv) {
+
+    /* Variables locales */
+    struct option opciones[] = {
+        {"output", required_argument, NULL, 'o'},
+        {"shared", required_argument, NULL, 's'},
+        {"local", required_argument, NULL, 'l'},
+        {"processes", required_argument, NULL, 'p'},
+        {"delay", required_argument, NULL, 'd'},
+        {"timeout", required_argument, NULL, 't'},
+        {NULL, 0, NULL, 0}
+    };
+    struct timespec ini, fin;
+    ClusterRequest request;
+    ClusterReply reply;
+    Clave divisores[CLUSTER_MAX_NODES];
+    int cuentas[CLUSTER_MAX_NODES];
+    int inicios[CLUSTER_MAX_NODES + 1];
+    char *salida = NULL, *compartido = NULL;
+    int n_procesos = PROCESOS_LOCALES, n_local = 0, delay = 0, espera = CLUSTER_TIMEOUT;
+    int n_elements, n_levels, recibidos, anterior, i, k, c;
+    FILE *f = NULL;
+    Bool ordenado = TRUE;
+
+    for (k = 0; k < CLUSTER_MAX_NODES; k++)
+        conexiones[k] = -1;
+
+    while ((c = getopt_long(argc, argv, "o:s:l:p:d:t:", opciones, NULL)) != -1) {
+        switch (c) {
+            case 'o':
+                salida = optarg;
+                break;
+            case 's':
+                compartido = optarg;
+                break;
+            case 'l':
+                n_local = atoi(optarg);
+                if (n_local < 1 || n_local > CLUSTER_MAX_NODES) {
+                    fprintf(stderr, "--local: between 1 and %d nodes\n", CLUSTER_MAX_NODES);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'p':
+                n_procesos = MAX(1, MIN(atoi(optarg), MAX_PARTS));
+                break;
+            case 'd':
+                delay = 1e6 * atoi(optarg);
+                break;
+            case 't':
+                espera = MAX(0, atoi(optarg));
+                break;
+            default:
+                uso(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    /* Comprobamos los arguentos de entrada */
+    if (argc - optind < 2 || (n_local == 0 && argc - optind < 3) || \
+        (n_local > 0 && argc - optind > 2) || argc - optind - 2 > CLUSTER_MAX_NODES) {
+        uso(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (salida != NULL && compartido != NULL) {
+        fprintf(stderr, "--output and --shared can not be used together\n");
+        exit(EXIT_FAILURE);
+    }
+    n_levels = atoi(argv[optind + 1]);
+
+    /* Los nodos locales se crean antes de leer la entrada */
+    if (n_local > 0) {
+        if (arrancar_locales(n_local, n_procesos) == ERROR) {
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+    }
+    else {
+        for (n_nodos = 0; optind + 2 + n_nodos < argc; n_nodos++)
+            nodos[n_nodos] = argv[optind + 2 + n_nodos];
+    }
+
+    if (leer_entrada(argv[optind], &n_elements) == ERROR) {
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ini);
+
+    /* Elegimos los rangos y colocamos los elementos de cada nodo seguidos */
+    if (muestrear(n_elements, divisores) == ERROR || \
+        (repartidos = malloc(MAX(1, n_elements) * sizeof(int))) == NULL) {
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+    memset(cuentas, 0, sizeof(cuentas));
+    for (i = 0; i < n_elements; i++)
+        cuentas[buscar_nodo(divisores, i)]++;
+    inicios[0] = 0;
+    for (k = 0; k < n_nodos; k++) {
+        if (cuentas[k] > MAX_DATA) {
+            fprintf(stderr, "Node %d would get %d elements (at most %d), use more nodes\n", \
+                    k, cuentas[k], MAX_DATA);
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+        inicios[k + 1] = inicios[k] + cuentas[k];
+        cuentas[k] = inicios[k];
+    }
+    for (i = 0; i < n_elements; i++)
+        repartidos[cuentas[buscar_nodo(divisores, i)]++] = datos[i];
+
+    /* Enviamos a cada nodo su rango; los nodos ordenan mientras tanto */
+    for (k = 0; k < n_nodos; k++) {
+        memset(&request, 0, sizeof(request));
+        request.magic = CLUSTER_MAGIC;
+        request.n_elements = inicios[k + 1] - inicios[k];
+        request.n_levels = n_levels;
+        request.delay = delay;
+        if (compartido != NULL)
+            snprintf(request.output, CLUSTER_MAX_PATH, "%s/part-%d.dat", compartido, k);
+
+        if ((conexiones[k] = cluster_connect(nodos[k], espera)) == -1 || \
+            cluster_send_request(conexiones[k], &request) == ERROR || \
+            cluster_send_ints(conexiones[k], repartidos + inicios[k], request.n_elements) == ERROR) {
+            fprintf(stderr, "Node %d (%s) failed: ", k, nodos[k]);
+            perror("send");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+        printf("Node %d (%s): %d elements\n", k, nodos[k], request.n_elements);
+        fflush(stdout);
+    }
+
+    if (salida != NULL && (f = aio_fopen(salida, "w")) == NULL) {
+        perror(salida);
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+    if (f != NULL)
+        fprintf(f, "%d\n", n_elements);
+
+    /* Recibimos los rangos en orden y los escribimos según llegan,
+       comprobando de paso que el resultado está ordenado */
+    recibidos = 0;
+    anterior = 0;
+    for (k = 0; k < n_nodos; k++) {
+        errno = 0;
+        if (cluster_recv_reply(conexiones[k], &reply) == ERROR || reply.status != OK || \
+            reply.n_elements != inicios[k + 1] - inicios[k] || \
+            (compartido == NULL && \
+             cluster_recv_ints(conexiones[k], repartidos + inicios[k], reply.n_elements) == ERROR)) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                fprintf(stderr, "Node %d (%s) failed: no reply in %d s\n", k, nodos[k], espera);
+            else
+                fprintf(stderr, "Node %d (%s) failed\n", k, nodos[k]);
+            if (f != NULL) {
+                fclose(f);
+                unlink(salida);
+            }
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+        close(conexiones[k]);
+        conexiones[k] = -1;
+
+        for (i = inicios[k]; compartido == NULL && i < inicios[k + 1]; i++) {
+            if (recibidos++ > 0 && repartidos[i] < anterior)
+                ordenado = FALSE;
+            anterior = repartidos[i];
+            if (f != NULL)
+                fprintf(f, "%d\n", repartidos[i]);
+        }
+        printf("Node %d (%s): sorted in %.3f ms\n", k, nodos[k], reply.elapsed_ns / 1e6);
+        fflush(stdout);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+
+    if (f != NULL && fclose(f) == EOF) {
+        perror(salida);
+        ordenado = FALSE;
+    }
+
+    if (compartido != NULL) {
+        printf("\nRanges written to");
+        for (k = 0; k < n_nodos; k++)
+            printf("%s%s/part-%d.dat", (k == 0) ? " " : ",", compartido, k);
+        printf("\n");
+    }
+    printf("\nSorted %d elements on %d nodes in %.3f ms%s\n", n_elements, n_nodos, \
+           ((fin.tv_sec - ini.tv_sec) * 1e9 + (fin.tv_nsec - ini.tv_nsec)) / 1e6, \
+           ordenado ? "" : " (NOT SORTED)");
+
+    freeAll();
+    exit(ordenado ? EXIT_SUCCESS : EXIT_FAILURE);
+}
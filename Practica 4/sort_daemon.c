@@ -0,0 +1,701 @@
+/**
+ * @file sort_daemon.c
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Servicio de ordenación persistente. A diferencia de sort, que crea y destruye
+ * los trabajadores, el semáforo, la memoria compartida y las colas en cada
+ * ejecución, este programa los crea una sola vez y los mantiene vivos mientras
+ * atiende peticiones de ordenación.
+ * Los clientes envían peticiones (fichero de datos o segmento de memoria
+ * compartida y opciones) por la cola de mensajes DAEMON_MQ_NAME y reciben la
+ * notificación de finalización en una cola propia cuyo nombre indican en la
+ * petición.
+ * Los trabajadores reciben las tareas por una cola de mensajes y notifican su
+ * finalización por otra, de modo que el padre no necesita señales para avanzar
+ * de nivel. Terminará ordenadamente si recibe la señal SIGINT o SIGTERM.
+ * Se atienden hasta MAX_JOBS peticiones a la vez, cada una en su propia
+ * estructura Sort del segmento compartido. Las tareas listas de todos los
+ * trabajos se intercalan en la misma cola siguiendo un reparto proporcional a
+ * la prioridad de cada trabajo (planificación por pasos o stride scheduling),
+ * y cada trabajo está limitado a una cuota de elementos.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <poll.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "daemon.h"
+#include "global.h"
+#include "sort.h"
+#include "utils.h"
+
+
+/* Estructura utilizada para enviar tareas y notificaciones en las colas. En
+   las notificaciones, status indica si la tarea se ha resuelto */
+typedef struct {
+    int n_job;
+    int n_level;
+    int n_part;
+    Status status;
+} Message;
+
+
+/* Estado de un trabajo en curso, privado del padre. Un trabajo con una tarea
+   fallida no envía más tareas y conserva su hueco hasta que terminan las que
+   ya estaban enviadas (in_flight) */
+typedef struct {
+    Bool active;
+    Request request;
+    ShmInput *input;
+    size_t input_size;
+    struct timespec ini;
+    double pass;
+    int in_flight;
+    Bool failed;
+} Job;
+
+
+/* Variables globales que serán utilizadas por otras rutinas además del main */
+sem_t *sem = NULL;
+pid_t ppid = 0;
+int n_processes;
+int quota = MAX_DATA;
+volatile sig_atomic_t stop = 0;
+mqd_t requests = -1;
+mqd_t tasks = -1;
+mqd_t tasks_send = -1;
+mqd_t done = -1;
+pid_t *cpid = NULL;
+Sort *sort = NULL;
+Job jobs[MAX_JOBS];
+
+
+/**
+ * Libera todos los recursos cuya memoria haya sido reservada en algún momento.
+ * Los nombres de la memoria compartida, las colas y el semáforo solo los
+ * elimina el padre: un trabajador que termina no debe dejar el servicio sin
+ * ellos mientras sigue en marcha.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void freeAll() {
+    Bool padre = (getpid() == ppid);
+
+    if (cpid != NULL)
+        free(cpid);
+    if (sort != NULL) {
+        munmap(sort, MAX_JOBS * sizeof(Sort));
+        if (padre)
+            shm_unlink(DAEMON_SHM_NAME);
+    }
+    if (requests > -1) {
+        mq_close(requests);
+        if (padre)
+            mq_unlink(DAEMON_MQ_NAME);
+    }
+    if (tasks_send > -1)
+        mq_close(tasks_send);
+    if (tasks > -1) {
+        mq_close(tasks);
+        if (padre)
+            mq_unlink(DAEMON_TASK_MQ_NAME);
+    }
+    if (done > -1) {
+        mq_close(done);
+        if (padre)
+            mq_unlink(DAEMON_DONE_MQ_NAME);
+    }
+    if (sem != NULL) {
+        sem_close(sem);
+        if (padre)
+            sem_unlink(DAEMON_SEM_NAME);
+    }
+}
+
+
+/**
+ * Rutina manejadora de la señal SIGTERM en los trabajadores. Libera todos los
+ * recursos asociados al proceso y termina correctamente.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param sig   Número de señal asociada a SIGTERM.
+ */
+void manejador_SIGTERM(int sig) {
+    freeAll();
+    exit(EXIT_SUCCESS);
+}
+
+
+/**
+ * Rutina manejadora de las señales SIGINT y SIGTERM en el padre. Marca que el
+ * servicio debe terminar; el bucle principal lo detecta al interrumpirse la
+ * espera de peticiones.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param sig   Número de señal recibida.
+ */
+void manejador_stop(int sig) {
+    stop = 1;
+}
+
+
+/**
+ * Bucle de un trabajador: recibe tareas, las resuelve sobre la memoria
+ * compartida y notifica su finalización por la cola de terminadas, indicando
+ * si se han resuelto. Una tarea fallida no se marca como completada.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ */
+void trabajador() {
+    Message message;
+
+    while (1) {
+        while (mq_receive(tasks, (char*)&message, sizeof(message), NULL) == -1) {
+            if (errno != EINTR) {
+                perror("mq_receive");
+                freeAll();
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        while(sem_wait(sem) == -1 && errno == EINTR);
+        sort[message.n_job].tasks[message.n_level][message.n_part].completed = PROCESSING;
+        sem_post(sem);
+
+        message.status = solve_task(&sort[message.n_job], message.n_level, message.n_part);
+
+        if (message.status == OK) {
+            while(sem_wait(sem) == -1 && errno == EINTR);
+            sort[message.n_job].tasks[message.n_level][message.n_part].completed = COMPLETED;
+            sem_post(sem);
+        }
+        else {
+            fprintf(stderr, "Job %d: level %d, part %d failed\n", message.n_job, \
+                    message.n_level, message.n_part);
+        }
+
+        while (mq_send(done, (char*)&message, sizeof(message), 1) == -1) {
+            if (errno != EINTR) {
+                perror("mq_send");
+                freeAll();
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+}
+
+
+/**
+ * Envía la respuesta a la cola indicada por el cliente.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param request   Petición atendida.
+ * @param reply     Respuesta a enviar.
+ */
+void responder(Request *request, Reply *reply) {
+    mqd_t queue;
+
+    request->reply[MAX_MQ_NAME - 1] = '\0';
+    queue = mq_open(request->reply, O_WRONLY | O_NONBLOCK);
+    if (queue == (mqd_t)-1) {
+        perror("mq_open reply");
+        return;
+    }
+    if (mq_send(queue, (char*)reply, sizeof(*reply), 1) == -1)
+        perror("mq_send reply");
+    mq_close(queue);
+}
+
+
+/**
+ * Termina un trabajo: deja el resultado en el fichero de salida o en el
+ * segmento de entrada, notifica al cliente y libera su hueco.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param n_job     Índice del trabajo.
+ * @param status    Resultado de la ordenación.
+ */
+void terminar_trabajo(int n_job, Status status) {
+    struct timespec fin;
+    Job *job = &jobs[n_job];
+    Reply reply;
+
+    memset(&reply, 0, sizeof(reply));
+    if (status == OK) {
+        reply.n_elements = sort[n_job].n_elements;
+        reply.n_levels = sort[n_job].n_levels;
+        if (job->input != NULL)
+            memcpy(job->input->data, sort[n_job].data, \
+                   sort[n_job].n_elements * sizeof(int));
+        else if (job->request.output[0] != '\0')
+            status = write_vector(job->request.output, sort[n_job].data, \
+                                  sort[n_job].n_elements);
+    }
+
+    if (job->input != NULL)
+        munmap(job->input, job->input_size);
+    job->input = NULL;
+    job->active = FALSE;
+
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+    reply.status = status;
+    reply.elapsed_ns = (fin.tv_sec - job->ini.tv_sec) * 1000000000L + \
+                       (fin.tv_nsec - job->ini.tv_nsec);
+    responder(&job->request, &reply);
+}
+
+
+/**
+ * Carga una petición en un hueco libre. Si la entrada es un segmento de
+ * memoria compartida se mantiene proyectado para dejar en él el resultado.
+ * Los trabajos que superan la cuota de elementos se rechazan.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param n_job     Índice del hueco libre.
+ * @param request   Petición recibida.
+ * @return  OK si el trabajo se ha cargado, ERROR en caso contrario.
+ */
+Status cargar_trabajo(int n_job, Request *request) {
+    struct stat st;
+    ShmInput *input = NULL;
+    Job *job = &jobs[n_job];
+    Status ret;
+    Bool first;
+    int fd, i;
+
+    memset(job, 0, sizeof(*job));
+    job->request = *request;
+    clock_gettime(CLOCK_MONOTONIC, &job->ini);
+
+    if (request->source == SOURCE_SHM) {
+        if ((fd = shm_open(request->input, O_RDWR, 0)) == -1) {
+            perror("shm_open");
+            return ERROR;
+        }
+        if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(ShmInput)) {
+            fprintf(stderr, "%s: invalid segment\n", request->input);
+            close(fd);
+            return ERROR;
+        }
+        input = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (input == MAP_FAILED) {
+            perror("mmap");
+            return ERROR;
+        }
+        if (input->n_elements < 0 || input->n_elements > quota || \
+            sizeof(ShmInput) + input->n_elements * sizeof(int) > (size_t)st.st_size) {
+            fprintf(stderr, "%s: invalid segment or over quota\n", request->input);
+            munmap(input, st.st_size);
+            return ERROR;
+        }
+        job->input = input;
+        job->input_size = st.st_size;
+        ret = init_sort_data(input->data, input->n_elements, &sort[n_job], \
+                             request->n_levels, n_processes, request->delay);
+    }
+    else {
+        ret = init_sort(request->input, &sort[n_job], request->n_levels, \
+                        n_processes, request->delay);
+        if (ret == OK && sort[n_job].n_elements > quota) {
+            fprintf(stderr, "%s: %d elements over quota\n", request->input, \
+                    sort[n_job].n_elements);
+            ret = ERROR;
+        }
+    }
+
+    if (ret == ERROR) {
+        if (input != NULL)
+            munmap(input, st.st_size);
+        job->input = NULL;
+        return ERROR;
+    }
+
+    /* El nuevo trabajo empieza en el paso mínimo de los activos para no
+       adelantar ni retrasar a los que ya estaban en marcha */
+    first = TRUE;
+    for (i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].active && (first || jobs[i].pass < job->pass)) {
+            job->pass = jobs[i].pass;
+            first = FALSE;
+        }
+    }
+    job->request.priority = MAX(1, MIN(request->priority, MAX_PRIORITY));
+    job->active = TRUE;
+
+    return OK;
+}
+
+
+/**
+ * Busca la siguiente tarea lista de un trabajo.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param n_job     Índice del trabajo.
+ * @param message   Mensaje donde se guardará la tarea encontrada.
+ * @return  TRUE si hay alguna tarea lista, FALSE en caso contrario.
+ */
+Bool buscar_lista(int n_job, Message *message) {
+    int level, part;
+
+    for (level = 0; level < sort[n_job].n_levels; level++) {
+        for (part = 0; part < get_number_parts(level, sort[n_job].n_levels); part++) {
+            if (check_task_ready(&sort[n_job], level, part)) {
+                message->n_job = n_job;
+                message->n_level = level;
+                message->n_part = part;
+                message->status = OK;
+                return TRUE;
+            }
+        }
+    }
+
+    return FALSE;
+}
+
+
+/**
+ * Envía tareas listas mientras quepan en la cola. En cada envío se elige el
+ * trabajo con menor paso entre los que tienen tareas listas, y su paso avanza
+ * en proporción al tamaño de la tarea dividido por su prioridad.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @return  OK si no ha habido errores, ERROR en caso contrario.
+ */
+Status despachar() {
+    Message message, best;
+    Task *task;
+    int n_job, chosen;
+
+    while (1) {
+        chosen = -1;
+        while(sem_wait(sem) == -1 && errno == EINTR);
+        for (n_job = 0; n_job < MAX_JOBS; n_job++) {
+            if (jobs[n_job].active && !jobs[n_job].failed && \
+                (chosen == -1 || jobs[n_job].pass < jobs[chosen].pass) && \
+                buscar_lista(n_job, &message)) {
+                chosen = n_job;
+                best = message;
+            }
+        }
+        sem_post(sem);
+
+        if (chosen == -1)
+            return OK;
+
+        if (mq_send(tasks_send, (char*)&best, sizeof(best), 1) == -1) {
+            if (errno == EAGAIN)
+                return OK;
+            if (errno == EINTR)
+                continue;
+            perror("mq_send");
+            return ERROR;
+        }
+
+        task = &sort[chosen].tasks[best.n_level][best.n_part];
+        while(sem_wait(sem) == -1 && errno == EINTR);
+        if (task->completed == INCOMPLETE)
+            task->completed = SENT;
+        sem_post(sem);
+        jobs[chosen].in_flight++;
+        jobs[chosen].pass += (double)(task->end - task->ini) / \
+                             jobs[chosen].request.priority;
+    }
+}
+
+
+/**
+ * Función main. Será la rutina princpal que se ejecutará al comienzo del
+ * programa.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param argc  Número de argumentos de entrada del programa.
+ * @param argv  Puntero a los string de los correspondientes argumentos de
+ *              entrada.
+ * @return  EXIT_SUCCESS si el programa ha finalizado correctamente.
+ *          EXIT_FAILURE en caso contrario.
+ */
+int main(int argc, char **argv) {
+
+    /* Variables locales */
+    struct mq_attr attributes = {
+        .mq_flags = 0,
+        .mq_maxmsg = 10,
+        .mq_curmsgs = 0,
+        .mq_msgsize = sizeof(Message)
+    };
+    struct mq_attr req_attributes = {
+        .mq_flags = 0,
+        .mq_maxmsg = 10,
+        .mq_curmsgs = 0,
+        .mq_msgsize = sizeof(Request)
+    };
+    struct sigaction act;
+    struct pollfd fds[2];
+    Message message;
+    Request request;
+    Reply reply;
+    int fd_shm, i, n_job, n_active;
+    pid_t pid;
+
+    ppid = getpid();
+
+    /* Comprobamos los arguentos de entrada */
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <N_PROCESSES> [<QUOTA>]\n", argv[0]);
+        fprintf(stderr, "    <N_PROCESSES> : Number of processes (1 - %d)\n", MAX_PARTS);
+        fprintf(stderr, "    [<QUOTA>] :     Maximum elements per job (1 - %d)\n", MAX_DATA);
+        exit(EXIT_FAILURE);
+    }
+
+    n_processes = atoi(argv[1]);
+    n_processes = MAX(1, MIN(n_processes, MAX_PARTS));
+    if (argc > 2)
+        quota = MAX(1, MIN(atoi(argv[2]), MAX_DATA));
+
+    cpid = malloc(n_processes*sizeof(pid_t));
+    if (cpid == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Los trabajadores terminan con SIGTERM; el padre con SIGINT o SIGTERM */
+    sigemptyset(&(act.sa_mask));
+    act.sa_flags = 0;
+    act.sa_handler = manejador_SIGTERM;
+    if (sigaction(SIGTERM, &act, NULL) < 0) {
+        perror("sigaction");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    /* Creamos el semáforo, la memoria compartida y las colas */
+    if ((sem = sem_open(DAEMON_SEM_NAME, O_CREAT | O_EXCL, S_IRUSR | S_IWUSR, 1)) == SEM_FAILED) {
+        perror("sem_open");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    fd_shm = shm_open(DAEMON_SHM_NAME, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd_shm == -1) {
+        perror("shm_open");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    if (ftruncate(fd_shm, MAX_JOBS * sizeof(Sort)) == -1) {
+        perror("ftruncate");
+        close(fd_shm);
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    sort = mmap(NULL, MAX_JOBS * sizeof(Sort), PROT_READ | PROT_WRITE, MAP_SHARED, fd_shm, 0);
+    close(fd_shm);
+    if (sort == MAP_FAILED) {
+        sort = NULL;
+        perror("map failed");
+        shm_unlink(DAEMON_SHM_NAME);
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    tasks = mq_open(DAEMON_TASK_MQ_NAME, O_CREAT | O_EXCL | O_RDONLY, S_IRUSR | S_IWUSR, &attributes);
+    if (tasks == (mqd_t)-1) {
+        perror("mq_open");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    /* El padre envía las tareas por un descriptor propio no bloqueante, ya
+       que el modo no bloqueante se comparte entre procesos tras fork */
+    tasks_send = mq_open(DAEMON_TASK_MQ_NAME, O_WRONLY | O_NONBLOCK);
+    if (tasks_send == (mqd_t)-1) {
+        perror("mq_open");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    done = mq_open(DAEMON_DONE_MQ_NAME, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR, &attributes);
+    if (done == (mqd_t)-1) {
+        perror("mq_open");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    requests = mq_open(DAEMON_MQ_NAME, O_CREAT | O_EXCL | O_RDONLY | O_NONBLOCK, S_IRUSR | S_IWUSR, &req_attributes);
+    if (requests == (mqd_t)-1) {
+        perror("mq_open");
+        freeAll();
+        exit(EXIT_FAILURE);
+    }
+
+    /* Creamos los trabajadores, que permanecerán vivos entre peticiones */
+    for (i = 0; i < n_processes; i++) {
+        if ((pid = fork()) == -1) {
+            perror("fork");
+            freeAll();
+            exit(EXIT_FAILURE);
+        }
+        if (!pid) {
+            act.sa_handler = SIG_IGN;
+            if (sigaction(SIGINT, &act, NULL) < 0) {
+                perror("sigaction");
+                exit(EXIT_FAILURE);
+            }
+            trabajador();
+        }
+        cpid[i] = pid;
+    }
+
+    /* Código del padre */
+    act.sa_handler = manejador_stop;
+    if (sigaction(SIGINT, &act, NULL) < 0 || sigaction(SIGTERM, &act, NULL) < 0) {
+        perror("sigaction");
+        stop = 1;
+    }
+
+    fprintf(stdout, "Sort daemon ready with %d processes on %s\n", n_processes, DAEMON_MQ_NAME);
+    fflush(stdout);
+
+    /* Los descriptores de las colas son ficheros en Linux, por lo que podemos
+       esperar a la vez peticiones nuevas y tareas terminadas */
+    fds[0].fd = done;
+    fds[0].events = POLLIN;
+    fds[1].fd = requests;
+
+    n_active = 0;
+    while (!stop || n_active > 0) {
+        if (despachar() == ERROR)
+            break;
+
+        /* Solo se aceptan peticiones si hay algún hueco libre */
+        fds[1].events = (!stop && n_active < MAX_JOBS) ? POLLIN : 0;
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+
+        /* Tareas terminadas. Un trabajo con una tarea fallida responde con
+           error en cuanto terminan las que ya tenía enviadas, para que su
+           hueco no se reutilice mientras algún trabajador lo está usando */
+        if (fds[0].revents & POLLIN) {
+            if (mq_receive(done, (char*)&message, sizeof(message), NULL) == -1) {
+                if (errno != EINTR) {
+                    perror("mq_receive");
+                    break;
+                }
+            }
+            else {
+                jobs[message.n_job].in_flight--;
+                if (message.status == ERROR)
+                    jobs[message.n_job].failed = TRUE;
+
+                if (jobs[message.n_job].failed) {
+                    if (jobs[message.n_job].in_flight == 0) {
+                        terminar_trabajo(message.n_job, ERROR);
+                        n_active--;
+                    }
+                }
+                else if (message.n_level == sort[message.n_job].n_levels - 1) {
+                    terminar_trabajo(message.n_job, OK);
+                    n_active--;
+                }
+            }
+        }
+
+        /* Peticiones nuevas */
+        if (fds[1].revents & POLLIN) {
+            if (mq_receive(requests, (char*)&request, sizeof(request), NULL) == -1) {
+                if (errno != EINTR && errno != EAGAIN) {
+                    perror("mq_receive");
+                    break;
+                }
+                continue;
+            }
+            request.input[MAX_PATH - 1] = '\0';
+            request.output[MAX_PATH - 1] = '\0';
+
+            for (n_job = 0; jobs[n_job].active; n_job++);
+            if (cargar_trabajo(n_job, &request) == ERROR) {
+                memset(&reply, 0, sizeof(reply));
+                reply.status = ERROR;
+                responder(&request, &reply);
+            }
+            else if (sort[n_job].n_levels == 0) {
+                terminar_trabajo(n_job, OK);
+            }
+            else {
+                n_active++;
+            }
+        }
+    }
+
+    /* Terminamos los trabajadores y liberamos los recursos */
+    for (i = 0; i < n_processes; i++) {
+        if (kill(cpid[i], SIGTERM) == -1)
+            perror("kill");
+    }
+
+    for (i = 0; i < n_processes; i++) {
+        wait(NULL);
+    }
+
+    freeAll();
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,69 @@
+/**
+ * @file sort_node.c
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Nodo de la ordenación repartida. Escucha en un puerto TCP las peticiones
+ * del coordinador (sort_cluster), ordena los elementos de cada una con varios
+ * procesos y devuelve el resultado o lo escribe en el fichero indicado.
+ * Termina ordenadamente si recibe la señal SIGINT o SIGTERM.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "cluster.h"
+#include "global.h"
+#include "sort.h"
+#include "utils.h"
+
+
+/**
+ * Función main. Será la rutina princpal que se ejecutará al comienzo del
+ * programa.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param argc  Número de argumentos de entrada del programa.
+ * @param argv  Puntero a los string de los correspondientes argumentos de
+ *              entrada.
+ * @return  EXIT_SUCCESS si el nodo termina correctamente.
+ *          EXIT_FAILURE en caso contrario.
+ */
+int main(int argc, char **argv) {
+
+    /* Variables locales */
+    int listener, port, n_processes;
+    Status estado;
+
+    /* Comprobamos los arguentos de entrada */
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <PORT> [<N_PROCESSES>] [<HOST>]\n", argv[0]);
+        fprintf(stderr, "    <PORT> :          TCP port, %d by default in the coordinator\n", CLUSTER_PORT);
+        fprintf(stderr, "    [<N_PROCESSES>] : Number of processes (1 - %d), 1 by default\n", MAX_PARTS);
+        fprintf(stderr, "    [<HOST>] :        Local address to listen on, all by default\n");
+        exit(EXIT_FAILURE);
+    }
+
+    port = atoi(argv[1]);
+    n_processes = (argc > 2) ? MAX(1, MIN(atoi(argv[2]), MAX_PARTS)) : 1;
+
+    if ((listener = cluster_listen((argc > 3) ? argv[3] : NULL, port)) == -1) {
+        perror("cluster_listen");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Sort node ready with %d processes on port %d\n", n_processes, port);
+    fflush(stdout);
+
+    estado = cluster_serve(listener, n_processes);
+    close(listener);
+
+    exit((estado == OK) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,94 @@
+/**
+ * @file sort_result.c
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Consumidor de los resultados publicados por sort con --publish. Proyecta el
+ * segmento en modo de solo lectura, muestra su cabecera y comprueba la suma
+ * de los datos. Con -r libera además la publicación, de forma que el segmento
+ * se elimina cuando no quedan más consumidores.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "global.h"
+#include "result.h"
+
+
+/**
+ * Función main. Será la rutina princpal que se ejecutará al comienzo del
+ * programa.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param argc  Número de argumentos de entrada del programa.
+ * @param argv  Puntero a los string de los correspondientes argumentos de
+ *              entrada.
+ * @return  EXIT_SUCCESS si el resultado es correcto.
+ *          EXIT_FAILURE en caso contrario.
+ */
+int main(int argc, char **argv) {
+
+    /* Variables locales */
+    Result *result;
+    size_t size;
+    Bool release = FALSE;
+    Bool print = FALSE;
+    Bool valid;
+    int *data;
+    int opt, k, width;
+
+    /* Comprobamos los arguentos de entrada */
+    while ((opt = getopt(argc, argv, "pr")) != -1) {
+        switch (opt) {
+            case 'p':
+                print = TRUE;
+                break;
+            case 'r':
+                release = TRUE;
+                break;
+            default:
+                argc = 0;
+        }
+    }
+    if (argc - optind != 1) {
+        fprintf(stderr, "Usage: %s [-p] [-r] <NAME>\n", argv[0]);
+        fprintf(stderr, "    <NAME> : Shared memory segment published by sort\n");
+        fprintf(stderr, "    -p :     Print the elements\n");
+        fprintf(stderr, "    -r :     Release the segment, removing it after the last consumer\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((result = result_attach(argv[optind], &size)) == NULL)
+        exit(EXIT_FAILURE);
+
+    data = result_data(result);
+    width = result_width(result->type);
+    valid = (result_checksum(data, result->n_elements * width) == result->checksum) ? TRUE : FALSE;
+    printf("%s: %d %s, %s, checksum %016lx %s\n", argv[optind], result->n_elements, \
+           (result->type == RESULT_HISTOGRAM) ? "groups" : \
+           (result->type == RESULT_PERMUTATION) ? "positions" : "elements", \
+           result->sorted ? "sorted" : "not sorted", result->checksum, valid ? "OK" : "MISMATCH");
+
+    /* Los histogramas se muestran como pares clave y número de apariciones */
+    if (print) {
+        for (k = 0; k < result->n_elements; k++) {
+            if (result->type == RESULT_HISTOGRAM)
+                printf("%d %d\n", data[2 * k], data[2 * k + 1]);
+            else
+                printf("%d\n", data[k]);
+        }
+    }
+
+    if (result_detach(argv[optind], result, size, release) == ERROR)
+        exit(EXIT_FAILURE);
+
+    exit(valid ? EXIT_SUCCESS : EXIT_FAILURE);
+}
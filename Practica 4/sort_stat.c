@@ -0,0 +1,89 @@
+/**
+ * @file sort_stat.c
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Muestra los contadores de progreso de la ordenación en curso: progreso,
+ * tiempo restante estimado, claves por segundo, bytes mezclados, tareas en la
+ * cola, tareas completadas por nivel y fracción del tiempo ocupada de cada
+ * trabajador. Puede repetirse cada cierto tiempo y escribirlos en el formato
+ * de texto de Prometheus. Si hay varias ordenaciones en curso, se elige una
+ * por el pid de su proceso principal.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "global.h"
+#include "metrics.h"
+
+
+/**
+ * Función main. Será la rutina princpal que se ejecutará al comienzo del
+ * programa.
+ *
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @param argc  Número de argumentos de entrada del programa.
+ * @param argv  Puntero a los string de los correspondientes argumentos de
+ *              entrada.
+ * @return  EXIT_SUCCESS si se han podido leer los contadores.
+ *          EXIT_FAILURE en caso contrario.
+ */
+int main(int argc, char **argv) {
+
+    /* Variables locales */
+    Metrics *metrics;
+    Bool prometheus = FALSE;
+    pid_t ppid = 0;
+    int intervalo = 0;
+    int opt;
+
+    /* Comprobamos los arguentos de entrada */
+    while ((opt = getopt(argc, argv, "w:Pp:")) != -1) {
+        switch (opt) {
+            case 'w':
+                intervalo = atoi(optarg);
+                break;
+            case 'P':
+                prometheus = TRUE;
+                break;
+            case 'p':
+                ppid = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-w SECONDS] [-P] [-p PID]\n", argv[0]);
+                fprintf(stderr, "    -w SECONDS : Repeat every SECONDS until the sort finishes\n");
+                fprintf(stderr, "    -P :         Prometheus text format\n");
+                fprintf(stderr, "    -p PID :     Sort whose main process is PID, if several are running\n");
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if ((metrics = metrics_open(ppid)) == NULL)
+        exit(EXIT_FAILURE);
+
+    while (1) {
+        if (prometheus)
+            metrics_prometheus(stdout, metrics);
+        else
+            metrics_print(stdout, metrics);
+        fflush(stdout);
+
+        if (intervalo <= 0 || metrics->finished)
+            break;
+        sleep(intervalo);
+        printf("\n");
+    }
+
+    munmap(metrics, sizeof(*metrics));
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,498 @@
+/**
+ * @file text.c
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Implementación de la ordenación por líneas. El prefijo de una clave de
+ * bytes son sus cuatro primeros bytes, y el de una clave numérica su parte
+ * entera, de forma que el orden de los prefijos nunca contradice el de las
+ * claves completas y solo hay que desempatar las líneas con el mismo prefijo.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "text.h"
+
+
+/* Trozo del fichero que recorre un hilo y primera línea que empieza en él */
+typedef struct {
+    Text *text;
+    size_t ini;
+    size_t end;
+    int first;
+    int count;
+} Chunk;
+
+
+/* Tramo del vector ordenado cuyas líneas desempata un hilo; empieza y termina
+   en el límite de un grupo de prefijos iguales */
+typedef struct {
+    int *keys;
+    int *index;
+    int ini;
+    int end;
+} Tramo;
+
+
+/* Fichero cuyas líneas se están desempatando, para el comparador de qsort */
+static Text *desempate = NULL;
+
+
+/**
+ * Devuelve la clave de una línea según el campo y el delimitador del fichero.
+ *
+ * @param text    Fichero de texto.
+ * @param line    Número de línea.
+ * @param length  Donde se guarda la longitud de la clave.
+ * @return  Puntero al comienzo de la clave dentro de la proyección.
+ */
+static char *clave(Text *text, int line, int *length) {
+    char *p = text->map + text->offsets[line];
+    char *end = text->map + text->offsets[line + 1];
+    char *key;
+    int f;
+
+    /* El salto de línea no forma parte de la clave */
+    if (end > p && end[-1] == '\n')
+        end--;
+    if (end > p && end[-1] == '\r')
+        end--;
+
+    if (text->field <= 0) {
+        *length = end - p;
+        return p;
+    }
+
+    /* Con delimitador, cada aparición separa dos campos, aunque estén vacíos */
+    if (text->delimiter != '\0') {
+        for (f = 1; f < text->field && p < end; f++) {
+            while (p < end && *p != text->delimiter)
+                p++;
+            if (p < end)
+                p++;
+        }
+        for (key = p; p < end && *p != text->delimiter; p++);
+        *length = p - key;
+        return key;
+    }
+
+    /* Sin delimitador, los campos se separan por secuencias de blancos */
+    key = end;
+    for (f = 1; f <= text->field && p < end; f++) {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        for (key = p; p < end && *p != ' ' && *p != '\t'; p++);
+    }
+    *length = (f > text->field) ? p - key : 0;
+    return (f > text->field) ? key : end;
+}
+
+
+/**
+ * Devuelve el valor de una clave numérica; las claves que no empiezan por un
+ * número valen 0.
+ *
+ * @param key     Clave.
+ * @param length  Longitud de la clave.
+ * @return  El valor de la clave.
+ */
+static double numero(char *key, int length) {
+    char buffer[TEXT_MAX_NUMBER];
+    double value;
+
+    /* La clave no termina en '\0' dentro de la proyección */
+    length = (length < TEXT_MAX_NUMBER) ? length : TEXT_MAX_NUMBER - 1;
+    memcpy(buffer, key, length);
+    buffer[length] = '\0';
+    value = strtod(buffer, NULL);
+
+    return (value == value) ? value : 0;
+}
+
+
+/**
+ * Calcula el prefijo entero de la clave de una línea.
+ *
+ * @param text  Fichero de texto.
+ * @param line  Número de línea.
+ * @return  El prefijo de la clave.
+ */
+static int prefijo(Text *text, int line) {
+    unsigned int bytes = 0;
+    double value;
+    char *key;
+    int length, k;
+
+    key = clave(text, line, &length);
+
+    if (text->numeric) {
+        value = floor(numero(key, length));
+        if (value <= INT_MIN)
+            return INT_MIN;
+        if (value >= INT_MAX)
+            return INT_MAX;
+        return (int)value;
+    }
+
+    /* Los bytes se toman sin signo y el bit alto se invierte para que el
+       orden de los enteros con signo sea el de los bytes */
+    for (k = 0; k < 4; k++)
+        bytes = (bytes << 8) | ((k < length) ? (unsigned char)key[k] : 0);
+
+    return (int)(bytes ^ 0x80000000U);
+}
+
+
+/**
+ * Cuenta las líneas que empiezan dentro de un trozo del fichero.
+ *
+ * @param arg  Trozo del fichero (Chunk).
+ * @return  NULL.
+ */
+static void *contar(void *arg) {
+    Chunk *chunk = arg;
+    char *p, *end;
+
+    chunk->count = (chunk->ini == 0 && chunk->end > 0) ? 1 : 0;
+    if (chunk->end == 0)
+        return NULL;
+
+    /* Cada salto de línea en [ini - 1, end - 1) abre una línea en [ini, end) */
+    p = chunk->text->map + ((chunk->ini > 0) ? chunk->ini - 1 : 0);
+    end = chunk->text->map + chunk->end - 1;
+    while (p < end && (p = memchr(p, '\n', end - p)) != NULL) {
+        chunk->count++;
+        p++;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Anota el comienzo de las líneas que empiezan dentro de un trozo del fichero.
+ *
+ * @param arg  Trozo del fichero (Chunk), con su primera línea calculada.
+ * @return  NULL.
+ */
+static void *indexar(void *arg) {
+    Chunk *chunk = arg;
+    Text *text = chunk->text;
+    char *p, *end;
+    int line = chunk->first;
+
+    if (chunk->end == 0)
+        return NULL;
+
+    if (chunk->ini == 0)
+        text->offsets[line++] = 0;
+    p = text->map + ((chunk->ini > 0) ? chunk->ini - 1 : 0);
+    end = text->map + chunk->end - 1;
+    while (p < end && (p = memchr(p, '\n', end - p)) != NULL) {
+        p++;
+        text->offsets[line++] = p - text->map;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Calcula el prefijo de la clave de las líneas que empiezan dentro de un
+ * trozo del fichero, una vez anotado el comienzo de todas las líneas.
+ *
+ * @param arg  Trozo del fichero (Chunk), con sus líneas anotadas.
+ * @return  NULL.
+ */
+static void *extraer(void *arg) {
+    Chunk *chunk = arg;
+    int line;
+
+    for (line = chunk->first; line < chunk->first + chunk->count; line++)
+        chunk->text->keys[line] = prefijo(chunk->text, line);
+
+    return NULL;
+}
+
+
+/**
+ * Ejecuta una pasada sobre todos los trozos, un hilo por trozo. Si no puede
+ * crearse un hilo, su trozo lo recorre el hilo principal.
+ *
+ * @param chunks     Trozos (del fichero o del vector ordenado).
+ * @param size       Tamaño de cada trozo.
+ * @param n_threads  Número de trozos.
+ * @param pasada     Función que recorre un trozo.
+ */
+static void recorrer(void *chunks, size_t size, int n_threads, void *(*pasada)(void *)) {
+    pthread_t threads[TEXT_MAX_THREADS];
+    Bool creados[TEXT_MAX_THREADS];
+    char *chunk;
+    int k;
+
+    for (k = 0; k < n_threads; k++) {
+        chunk = (char *)chunks + k * size;
+        creados[k] = (pthread_create(&threads[k], NULL, pasada, chunk) == 0) ? TRUE : FALSE;
+        if (!creados[k])
+            pasada(chunk);
+    }
+    for (k = 0; k < n_threads; k++) {
+        if (creados[k])
+            pthread_join(threads[k], NULL);
+    }
+}
+
+
+Status text_open(Text *text, char *file_name, int field, char delimiter, Bool numeric, int n_threads) {
+    Chunk chunks[TEXT_MAX_THREADS];
+    struct stat st;
+    int fd, k, n_lines;
+
+    if ((!(text)) || (!(file_name))) {
+        fprintf(stderr, "text_open - Incorrect arguments\n");
+        return ERROR;
+    }
+
+    memset(text, 0, sizeof(*text));
+    text->field = field;
+    text->delimiter = delimiter;
+    text->numeric = numeric;
+
+    if ((fd = open(file_name, O_RDONLY)) == -1) {
+        perror("text_open - open");
+        return ERROR;
+    }
+    if (fstat(fd, &st) == -1) {
+        perror("text_open - fstat");
+        close(fd);
+        return ERROR;
+    }
+    text->size = st.st_size;
+    if (text->size > 0) {
+        text->map = mmap(NULL, text->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (text->map == MAP_FAILED) {
+            perror("text_open - mmap");
+            text->map = NULL;
+            close(fd);
+            return ERROR;
+        }
+        posix_madvise(text->map, text->size, POSIX_MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    /* Primera pasada: cada hilo cuenta las líneas de su trozo, y así se sabe
+       dónde anota cada uno las suyas en la segunda. En la tercera ya se
+       conoce el final de todas las líneas y se extraen las claves */
+    n_threads = (n_threads < 1) ? 1 : (n_threads > TEXT_MAX_THREADS) ? TEXT_MAX_THREADS : n_threads;
+    for (k = 0; k < n_threads; k++) {
+        chunks[k].text = text;
+        chunks[k].ini = text->size * k / n_threads;
+        chunks[k].end = text->size * (k + 1) / n_threads;
+    }
+    recorrer(chunks, sizeof(Chunk), n_threads, contar);
+
+    n_lines = 0;
+    for (k = 0; k < n_threads; k++) {
+        chunks[k].first = n_lines;
+        n_lines += chunks[k].count;
+    }
+
+    text->n_lines = n_lines;
+    text->offsets = malloc((n_lines + 1) * sizeof(long));
+    text->keys = malloc((n_lines + 1) * sizeof(int));
+    if (text->offsets == NULL || text->keys == NULL) {
+        perror("text_open - malloc");
+        text_close(text);
+        return ERROR;
+    }
+    text->offsets[n_lines] = text->size;
+
+    recorrer(chunks, sizeof(Chunk), n_threads, indexar);
+    recorrer(chunks, sizeof(Chunk), n_threads, extraer);
+
+    return OK;
+}
+
+
+char *text_key(void *context, int line, int *length) {
+    return clave((Text *)context, line, length);
+}
+
+
+/**
+ * Compara dos líneas por su clave completa para qsort, y por su posición en
+ * el fichero si las claves son iguales.
+ *
+ * @param a  Primer número de línea.
+ * @param b  Segundo número de línea.
+ * @return  Negativo, cero o positivo como en strcmp.
+ */
+static int comparar_lineas(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    char *key_x, *key_y;
+    int length_x, length_y, c;
+    double value_x, value_y;
+
+    key_x = clave(desempate, x, &length_x);
+    key_y = clave(desempate, y, &length_y);
+
+    if (desempate->numeric) {
+        value_x = numero(key_x, length_x);
+        value_y = numero(key_y, length_y);
+        if (value_x != value_y)
+            return (value_x > value_y) - (value_x < value_y);
+    }
+    else {
+        c = memcmp(key_x, key_y, (length_x < length_y) ? length_x : length_y);
+        if (c != 0)
+            return c;
+        if (length_x != length_y)
+            return (length_x > length_y) - (length_x < length_y);
+    }
+
+    return (x > y) - (x < y);
+}
+
+
+/**
+ * Desempata los grupos de líneas con el mismo prefijo de un tramo.
+ *
+ * @param arg  Tramo del vector ordenado (Tramo).
+ * @return  NULL.
+ */
+static void *desempatar(void *arg) {
+    Tramo *tramo = arg;
+    int ini, end;
+
+    for (ini = tramo->ini; ini < tramo->end; ini = end) {
+        for (end = ini + 1; end < tramo->end && tramo->keys[end] == tramo->keys[ini]; end++);
+        if (end - ini > 1)
+            qsort(tramo->index + ini, end - ini, sizeof(int), comparar_lineas);
+    }
+
+    return NULL;
+}
+
+
+Status text_refine(Text *text, int *keys, int *index, int n_elements, int n_threads) {
+    Tramo tramos[TEXT_MAX_THREADS];
+    int k, limite;
+
+    if ((!(text)) || (!(keys)) || (!(index)) || (n_elements < 0)) {
+        fprintf(stderr, "text_refine - Incorrect arguments\n");
+        return ERROR;
+    }
+
+    /* Cada tramo se alarga hasta el final de su último grupo, por lo que un
+       grupo nunca se reparte entre dos hilos */
+    n_threads = (n_threads < 1) ? 1 : (n_threads > TEXT_MAX_THREADS) ? TEXT_MAX_THREADS : n_threads;
+    limite = 0;
+    for (k = 0; k < n_threads; k++) {
+        tramos[k].keys = keys;
+        tramos[k].index = index;
+        tramos[k].ini = limite;
+        if ((long)n_elements * (k + 1) / n_threads > limite)
+            limite = (long)n_elements * (k + 1) / n_threads;
+        while (limite > 0 && limite < n_elements && keys[limite] == keys[limite - 1])
+            limite++;
+        tramos[k].end = limite;
+    }
+
+    desempate = text;
+    recorrer(tramos, sizeof(Tramo), n_threads, desempatar);
+    desempate = NULL;
+
+    return OK;
+}
+
+
+Status text_check(Text *text, int *index, int n_elements) {
+    char *vista = NULL;
+    int k, desordenada = -1;
+
+    if ((!(text)) || (!(index)) || (n_elements != text->n_lines)) {
+        fprintf(stderr, "text_check - Incorrect arguments\n");
+        return ERROR;
+    }
+    if (!(vista = calloc(n_elements + 1, sizeof(char)))) {
+        perror("text_check - calloc");
+        return ERROR;
+    }
+
+    for (k = 0; k < n_elements; k++) {
+        if ((index[k] < 0) || (index[k] >= n_elements) || vista[index[k]]) {
+            free(vista);
+            fprintf(stderr, "Verification failed: the lines are not a permutation of the input\n");
+            return ERROR;
+        }
+        vista[index[k]] = 1;
+    }
+    free(vista);
+
+    /* Con las claves iguales, el orden es el del fichero */
+    desempate = text;
+    for (k = 1; k < n_elements && desordenada < 0; k++) {
+        if (comparar_lineas(&index[k - 1], &index[k]) > 0)
+            desordenada = k;
+    }
+    desempate = NULL;
+
+    if (desordenada >= 0) {
+        fprintf(stderr, "Verification failed: line %d of the result is not sorted\n", desordenada + 1);
+        return ERROR;
+    }
+
+    return OK;
+}
+
+
+Status text_write(Text *text, int *index, int n_elements, FILE *output) {
+    long length;
+    int k, line;
+
+    if ((!(text)) || (!(index)) || (!(output)) || (n_elements < 0)) {
+        fprintf(stderr, "text_write - Incorrect arguments\n");
+        return ERROR;
+    }
+
+    /* La última línea puede no tener salto de línea */
+    for (k = 0; k < n_elements; k++) {
+        line = index[k];
+        length = text->offsets[line + 1] - text->offsets[line];
+        if (fwrite(text->map + text->offsets[line], 1, length, output) != (size_t)length) {
+            perror("text_write - fwrite");
+            return ERROR;
+        }
+        if (length == 0 || text->map[text->offsets[line] + length - 1] != '\n')
+            fputc('\n', output);
+    }
+
+    return (fflush(output) == 0) ? OK : ERROR;
+}
+
+
+void text_close(Text *text) {
+    if (text == NULL)
+        return;
+    if (text->map != NULL)
+        munmap(text->map, text->size);
+    free(text->offsets);
+    free(text->keys);
+    text->map = NULL;
+    text->offsets = NULL;
+    text->keys = NULL;
+    text->n_lines = 0;
+}
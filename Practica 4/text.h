@@ -0,0 +1,117 @@
+/**
+ * @file text.h
+ * @author Rubén García de la Fuente, ruben.garciadelafuente@estudiante.uam.es
+ * @author Elena Cano Castillejo, elena.canoc@estudiante.uam.es
+ * @group 2202
+ * @date 19-10-2026
+ *
+ * @brief
+ * Ordenación de ficheros de texto por líneas. El fichero se proyecta en
+ * memoria y de cada línea solo se extrae un prefijo entero de su clave, que es
+ * lo que se ordena junto con el número de línea; las líneas no se copian
+ * nunca y al final se escriben directamente desde la proyección en el orden
+ * obtenido.
+ */
+
+#ifndef _TEXT_H
+#define _TEXT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "global.h"
+
+/* Constantes */
+#define TEXT_MAX_THREADS 64
+#define TEXT_MAX_NUMBER 64
+
+
+/* Fichero de texto proyectado y forma de obtener la clave de sus líneas. El
+   campo 0 es la línea completa; sin delimitador los campos se separan por
+   espacios o tabuladores */
+typedef struct {
+    char *map;
+    size_t size;
+    int n_lines;
+    long *offsets;
+    int *keys;
+    int field;
+    char delimiter;
+    Bool numeric;
+} Text;
+
+
+/**
+ * Proyecta un fichero de texto y obtiene el comienzo de cada línea y el
+ * prefijo de su clave, repartiendo el fichero entre varios hilos.
+ *
+ * @param text       Estructura que se rellena.
+ * @param file_name  Fichero de texto.
+ * @param field      Campo que contiene la clave, 0 para la línea completa.
+ * @param delimiter  Separador de los campos, '\0' para espacios y tabuladores.
+ * @param numeric    TRUE si la clave se compara como número.
+ * @param n_threads  Número de hilos.
+ * @return  OK si el fichero se ha leído correctamente, ERROR en caso
+ *          contrario.
+ */
+Status text_open(Text *text, char *file_name, int field, char delimiter, Bool numeric, int n_threads);
+
+
+/**
+ * Devuelve la clave de una línea, con la forma de las claves del modo de
+ * cadenas de la ordenación (StringKey).
+ *
+ * @param context  Fichero de texto (Text).
+ * @param line     Número de línea.
+ * @param length   Donde se guarda la longitud de la clave.
+ * @return  Puntero al comienzo de la clave dentro de la proyección.
+ */
+char *text_key(void *context, int line, int *length);
+
+
+/**
+ * Ordena por la clave completa las líneas con el mismo prefijo, que la
+ * ordenación por prefijos deja juntas y en su orden original. Los grupos se
+ * reparten entre varios hilos.
+ *
+ * @param text        Fichero de texto.
+ * @param keys        Prefijos ordenados.
+ * @param index       Números de línea en el orden de los prefijos.
+ * @param n_elements  Número de líneas ordenadas.
+ * @param n_threads   Número de hilos.
+ * @return  OK si se han ordenado correctamente, ERROR en caso contrario.
+ */
+Status text_refine(Text *text, int *keys, int *index, int n_elements, int n_threads);
+
+
+/**
+ * Comprueba que un orden de las líneas es una permutación de todas ellas y
+ * que está ordenado por la clave completa, y no solo por su prefijo.
+ *
+ * @param text        Fichero de texto.
+ * @param index       Números de línea ordenados.
+ * @param n_elements  Número de líneas ordenadas.
+ * @return  OK si están ordenadas, ERROR en caso contrario.
+ */
+Status text_check(Text *text, int *index, int n_elements);
+
+
+/**
+ * Escribe las líneas de un fichero de texto en un orden dado.
+ *
+ * @param text        Fichero de texto.
+ * @param index       Números de línea en el orden en el que se escriben.
+ * @param n_elements  Número de líneas que se escriben.
+ * @param output      Fichero de salida.
+ * @return  OK si se han escrito correctamente, ERROR en caso contrario.
+ */
+Status text_write(Text *text, int *index, int n_elements, FILE *output);
+
+
+/**
+ * Desproyecta un fichero de texto y libera sus tablas.
+ *
+ * @param text  Fichero de texto.
+ */
+void text_close(Text *text);
+
+#endif
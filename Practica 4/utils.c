@@ -3,6 +3,7 @@
 #include <errno.h>
 #include <semaphore.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 #include "utils.h"
 
@@ -37,6 +38,73 @@ Status print_vector(int *data, int n_elements) {
     return OK;
 }
 
+size_t format_lines(char *buffer, int *data, int n_elements) {
+    char digits[MAX_LINE_INT];
+    char *p = buffer;
+    unsigned int value;
+    int i, n;
+
+    for (i = 0; i < n_elements; i++) {
+        /* The magnitude is taken unsigned, so that INT_MIN does not overflow. */
+        value = (data[i] < 0) ? 0U - (unsigned int)data[i] : (unsigned int)data[i];
+        if (data[i] < 0) {
+            *p++ = '-';
+        }
+        n = 0;
+        do {
+            digits[n++] = '0' + value % 10;
+            value /= 10;
+        } while (value > 0);
+        while (n > 0) {
+            *p++ = digits[--n];
+        }
+        *p++ = '\n';
+    }
+
+    return p - buffer;
+}
+
+Status write_vector(char *file_name, int *data, int n_elements) {
+    FILE *file = NULL;
+    char *buffer;
+    size_t size;
+    int i, n;
+    Status status = OK;
+
+    if ((!(file_name)) || (!(data)) || (n_elements < 0)) {
+        return ERROR;
+    }
+
+    if (!(buffer = malloc(WRITE_BUFFER))) {
+        perror("write_vector - malloc");
+        return ERROR;
+    }
+    if (!(file = fopen(file_name, "w"))) {
+        perror("write_vector - fopen");
+        free(buffer);
+        return ERROR;
+    }
+
+    /* The file is written sequentially, formatting whole blocks at once. */
+    fprintf(file, "%d\n", n_elements);
+    for (i = 0; (i < n_elements) && (status == OK); i += n) {
+        n = MIN(WRITE_BUFFER / MAX_LINE_INT, n_elements - i);
+        size = format_lines(buffer, data + i, n);
+        if (fwrite(buffer, 1, size, file) != size) {
+            perror("write_vector - fwrite");
+            status = ERROR;
+        }
+    }
+    free(buffer);
+
+    if (fclose(file) == EOF) {
+        perror("write_vector - fclose");
+        return ERROR;
+    }
+
+    return status;
+}
+
 Status plot_vector(int *data, int n_elements) {
     int i;
 
@@ -65,8 +133,9 @@ Status plot_vector(int *data, int n_elements) {
 void fast_sleep(int nsec) {
     struct timespec time;
 
-    if (nsec < 0) {
-        nsec = 0;
+    /* A null delay does not sleep at all. */
+    if (nsec <= 0) {
+        return;
     }
 
     time.tv_sec = 0;
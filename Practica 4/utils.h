@@ -1,6 +1,7 @@
 #ifndef _UTILS_H
 #define _UTILS_H
 
+#include <stddef.h>
 #include "global.h"
 
 /* Macros. */
@@ -11,6 +12,8 @@
 /* Constants. */
 
 #define MAX_SIZE_PLOT 50
+#define WRITE_BUFFER (1 << 20)
+#define MAX_LINE_INT 12
 
 /* Prototypes. */
 
@@ -43,6 +46,33 @@ void clear_screen();
  */
 Status print_vector(int *data, int n_elements);
 
+/**
+ * Writes a vector to a file with the same format as the input data: the
+ * first line contains the number of elements and each remaining line one of
+ * the numbers.
+ * @method write_vector
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  file_name   File where the data is written.
+ * @param  data        Array with the data.
+ * @param  n_elements  Number of elements in the array.
+ * @return             ERROR in case of error, OK otherwise.
+ */
+Status write_vector(char *file_name, int *data, int n_elements);
+
+/**
+ * Formats integers as text, one per line, without going through printf.
+ * @method format_lines
+ * @date   2026-10-19
+ * @author Rubén García de la Fuente, Elena Cano Castillejo
+ * @param  buffer      Where the text is written (MAX_LINE_INT bytes per
+ *                     element are enough).
+ * @param  data        Array with the data.
+ * @param  n_elements  Number of elements in the array.
+ * @return             Number of bytes written.
+ */
+size_t format_lines(char *buffer, int *data, int n_elements);
+
 /**
  * Plots a vector, in text or graphical mode depending on its size.
  * @method plot_vector